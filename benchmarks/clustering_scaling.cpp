@@ -0,0 +1,126 @@
+// Thread scaling benchmark for VertexClustering::simplify.
+//
+// Usage: ClusteringScaling [mesh.ply] [--grid N] [--threads N] [--repeat N] [--sphere N]
+//
+// Without a PLY file a UV sphere with N x N segments is generated. Each thread
+// count from 1 to --threads is timed and its output compared bit for bit with
+// the single-threaded result.
+
+#include "mesh/mesh.hpp"
+#include "algorithms/vertex_clustering.hpp"
+#include "utils/parallel.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+Mesh makeSphere(int segments) {
+    std::vector<Vector3> vertices;
+    std::vector<Face> faces;
+    vertices.reserve(size_t(segments + 1) * segments);
+    faces.reserve(size_t(segments) * segments * 2);
+
+    for (int i = 0; i <= segments; i++) {
+        float phi = 3.14159265f * i / segments;
+        for (int j = 0; j < segments; j++) {
+            float theta = 2.0f * 3.14159265f * j / segments;
+            vertices.emplace_back(std::sin(phi) * std::cos(theta), std::cos(phi),
+                                  std::sin(phi) * std::sin(theta));
+        }
+    }
+    for (int i = 0; i < segments; i++) {
+        for (int j = 0; j < segments; j++) {
+            unsigned a = i * segments + j;
+            unsigned b = i * segments + (j + 1) % segments;
+            unsigned c = a + segments;
+            unsigned d = b + segments;
+            faces.emplace_back(a, c, b);
+            faces.emplace_back(b, c, d);
+        }
+    }
+
+    Mesh mesh;
+    mesh.setVertices(std::move(vertices));
+    mesh.setFaces(std::move(faces));
+    return mesh;
+}
+
+bool identical(const Mesh& a, const Mesh& b) {
+    if (a.getVertexCount() != b.getVertexCount() || a.getFaceCount() != b.getFaceCount()) return false;
+    const auto& va = a.getVertices();
+    const auto& vb = b.getVertices();
+    if (!va.empty() && std::memcmp(va.data(), vb.data(), va.size() * sizeof(Vector3)) != 0) return false;
+    for (size_t i = 0; i < a.getFaceCount(); i++) {
+        const Face& fa = a.getFaces()[i];
+        const Face& fb = b.getFaces()[i];
+        if (fa.v1 != fb.v1 || fa.v2 != fb.v2 || fa.v3 != fb.v3) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string path;
+    int gridSize = 128;
+    unsigned maxThreads = Parallel::resolveThreadCount(0);
+    int repeats = 5;
+    int segments = 2048;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--grid" && i + 1 < argc) gridSize = std::atoi(argv[++i]);
+        else if (arg == "--threads" && i + 1 < argc) maxThreads = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--repeat" && i + 1 < argc) repeats = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--sphere" && i + 1 < argc) segments = std::max(3, std::atoi(argv[++i]));
+        else path = arg;
+    }
+
+    Mesh input;
+    if (!path.empty()) {
+        if (!input.loadFromPLY(path)) return 1;
+    } else {
+        input = makeSphere(segments);
+    }
+
+    std::cout << "Input: " << input.getVertexCount() << " vertices, "
+              << input.getFaceCount() << " faces, grid " << gridSize << "\n";
+    std::cout << std::setw(8) << "threads" << std::setw(14) << "median ms"
+              << std::setw(10) << "speedup" << std::setw(12) << "identical" << "\n";
+
+    Mesh reference;
+    double baseline = 0.0;
+    for (unsigned threads = 1; threads <= maxThreads; threads++) {
+        VertexClustering clustering(gridSize);
+        clustering.setThreadCount(threads);
+
+        std::vector<double> times;
+        Mesh output;
+        for (int r = 0; r < repeats; r++) {
+            auto start = std::chrono::high_resolution_clock::now();
+            clustering.simplify(input, output);
+            auto end = std::chrono::high_resolution_clock::now();
+            times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        }
+        std::sort(times.begin(), times.end());
+        double median = times[times.size() / 2];
+
+        if (threads == 1) {
+            reference = output;
+            baseline = median;
+        }
+
+        std::cout << std::setw(8) << threads << std::setw(14) << std::fixed << std::setprecision(2) << median
+                  << std::setw(10) << baseline / median
+                  << std::setw(12) << (identical(reference, output) ? "yes" : "NO") << "\n";
+    }
+
+    return 0;
+}
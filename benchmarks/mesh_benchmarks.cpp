@@ -0,0 +1,437 @@
+// Timing suite for the mesh pipeline, reported as JSON for dashboards.
+//
+// Usage: MeshBenchmarks [--models DIR] [--max-triangles N] [--repeat N]
+//                       [--grids 8,16,...] [--threads N] [--layout aos|soa]
+//                       [--order file|morton] [--output FILE]
+//
+// Cases run on the four bun_zipper resolutions in --models and on synthetic
+// meshes made by repeated 1-to-4 midpoint subdivision of the full-resolution
+// bunny. Subdivision stops at the first level with at least --max-triangles
+// faces (default 10M). Synthetic meshes are written to a temporary binary
+// PLY so loading is timed from disk for every mesh.
+//
+// Each case reports the median and p95 over --repeat runs, throughput in
+// elements per second, the heap allocations and bytes of its last run
+// (AllocationCounter) and the process peak RSS once the case has finished.
+// --layout soa loads meshes with the SoA position layout, whose kernels use
+// the instruction set chosen by VertexKernels (MESH_SIMD=scalar|sse|avx2
+// lowers it). --order morton loads meshes sorted along a Morton curve
+// (Mesh::sortSpatially), so every later case runs on the sorted order.
+// Progress goes to stderr; the JSON document goes to stdout or
+// --output.
+
+#include "mesh/mesh.hpp"
+#include "algorithms/vertex_clustering.hpp"
+#include "algorithms/mesh_error.hpp"
+#include "algorithms/vertex_cache_optimizer.hpp"
+#include "mesh/mesh_connectivity.hpp"
+#include "mesh/meshlets.hpp"
+#include "mesh/vertex_kernels.hpp"
+#include "utils/allocation_counter.hpp"
+#include "utils/file_io.hpp"
+#include "utils/mesh_codec.hpp"
+#include <sys/resource.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Options {
+    std::string modelsDir = "models/bunny/reconstruction";
+    size_t maxTriangles = 10000000;
+    int repeats = 5;
+    std::vector<int> gridSizes{8, 16, 32, 64, 128, 256};
+    unsigned threads = 0;
+    Mesh::PositionLayout layout = Mesh::PositionLayout::AoS;
+    Mesh::VertexOrder order = Mesh::VertexOrder::File;
+    std::string outputPath;
+};
+
+struct Result {
+    std::string name;
+    std::string mesh;
+    size_t vertices = 0;
+    size_t faces = 0;
+    int gridSize = 0;           // Only for simplify
+    size_t outputFaces = 0;     // Only for simplify
+    double medianMs = 0.0;
+    double p95Ms = 0.0;
+    double throughput = 0.0;
+    const char* throughputUnit = "";
+    double megabytesPerSecond = 0.0;  // Only for loads and decodes
+    double peakRssMb = 0.0;
+    AllocationCounter::Counts allocations;  // Made by the last run
+};
+
+double peakRssMegabytes() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / (1024.0 * 1024.0);  // Bytes
+#else
+    return usage.ru_maxrss / 1024.0;             // Kilobytes
+#endif
+}
+
+// Times fn `repeats` times; setup runs untimed before every run
+void measure(int repeats, const std::function<void()>& setup, const std::function<void()>& fn,
+             Result& result) {
+    std::vector<double> times;
+    for (int r = 0; r < repeats; r++) {
+        if (setup) setup();
+        const AllocationCounter::Counts before = AllocationCounter::snapshot();
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto end = std::chrono::steady_clock::now();
+        result.allocations = AllocationCounter::snapshot() - before;
+        times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    result.medianMs = times[times.size() / 2];
+    // Nearest-rank percentile
+    size_t rank = static_cast<size_t>(std::ceil(0.95 * times.size()));
+    result.p95Ms = times[std::max<size_t>(rank, 1) - 1];
+    result.peakRssMb = peakRssMegabytes();
+}
+
+double perSecond(size_t count, double milliseconds) {
+    return milliseconds > 0.0 ? count / (milliseconds / 1000.0) : 0.0;
+}
+
+// Splits every triangle into four through its edge midpoints. Shared edges
+// get one midpoint, found by binary search in the sorted edge list.
+void subdivide(std::vector<Vector3>& vertices, std::vector<Face>& faces) {
+    auto edgeKey = [](uint32_t a, uint32_t b) {
+        return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+    };
+
+    std::vector<uint64_t> edges;
+    edges.reserve(faces.size() * 3);
+    for (const auto& face : faces) {
+        edges.push_back(edgeKey(face.v1, face.v2));
+        edges.push_back(edgeKey(face.v2, face.v3));
+        edges.push_back(edgeKey(face.v3, face.v1));
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    const uint32_t base = static_cast<uint32_t>(vertices.size());
+    vertices.reserve(vertices.size() + edges.size());
+    for (uint64_t key : edges) {
+        const Vector3& a = vertices[key >> 32];
+        const Vector3& b = vertices[key & 0xFFFFFFFFu];
+        vertices.emplace_back((a.x + b.x) * 0.5f, (a.y + b.y) * 0.5f, (a.z + b.z) * 0.5f);
+    }
+
+    auto midpoint = [&](uint32_t a, uint32_t b) {
+        auto it = std::lower_bound(edges.begin(), edges.end(), edgeKey(a, b));
+        return base + static_cast<uint32_t>(it - edges.begin());
+    };
+
+    std::vector<Face> refined;
+    refined.reserve(faces.size() * 4);
+    for (const auto& face : faces) {
+        uint32_t ab = midpoint(face.v1, face.v2);
+        uint32_t bc = midpoint(face.v2, face.v3);
+        uint32_t ca = midpoint(face.v3, face.v1);
+        refined.emplace_back(face.v1, ab, ca);
+        refined.emplace_back(ab, face.v2, bc);
+        refined.emplace_back(ca, bc, face.v3);
+        refined.emplace_back(ab, bc, ca);
+    }
+    faces.swap(refined);
+}
+
+void benchmarkMesh(const std::string& label, const std::string& path, const Options& options,
+                   std::vector<Result>& results) {
+    const auto fileBytes = fs::file_size(path);
+    const size_t first = results.size();
+
+    // loadFromPLY: parse plus the centering and normals it always runs, and
+    // the spatial sort for --order morton
+    Mesh loaded;
+    Result load;
+    auto reset = [&]() {
+        loaded = Mesh();
+        loaded.setPositionLayout(options.layout);
+        loaded.setVertexOrder(options.order);
+    };
+    measure(options.repeats, reset, [&]() { loaded.loadFromPLY(path); }, load);
+    if (loaded.getFaceCount() == 0) {
+        std::cerr << "Error: Could not load " << path << std::endl;
+        return;
+    }
+    load.name = "loadFromPLY";
+    load.throughput = perSecond(loaded.getVertexCount() + loaded.getFaceCount(), load.medianMs);
+    load.throughputUnit = "elements/s";
+    load.megabytesPerSecond = perSecond(fileBytes, load.medianMs) / (1024.0 * 1024.0);
+    results.push_back(load);
+
+    // loadCached reading a valid cache; an untimed first call writes it
+    const std::string cachePath = (fs::temp_directory_path() / (label + ".meshcache")).string();
+    fs::remove(cachePath);
+    reset();
+    loaded.loadCached(path, cachePath);
+    Result cached;
+    measure(options.repeats, reset, [&]() { loaded.loadCached(path, cachePath); }, cached);
+    cached.name = "loadCached";
+    cached.throughput = perSecond(loaded.getVertexCount() + loaded.getFaceCount(), cached.medianMs);
+    cached.throughputUnit = "elements/s";
+    cached.megabytesPerSecond = perSecond(fs::file_size(cachePath), cached.medianMs) / (1024.0 * 1024.0);
+    fs::remove(cachePath);
+    results.push_back(cached);
+
+    Result normals;
+    normals.name = "computeNormals";
+    measure(options.repeats, nullptr, [&]() { loaded.computeNormals(); }, normals);
+    normals.throughput = perSecond(loaded.getFaceCount(), normals.medianMs);
+    normals.throughputUnit = "faces/s";
+    results.push_back(normals);
+
+    // Centering an already centered mesh does the same work
+    Result center;
+    center.name = "centerAndScale";
+    measure(options.repeats, nullptr, [&]() { loaded.centerAndScale(); }, center);
+    center.throughput = perSecond(loaded.getVertexCount(), center.medianMs);
+    center.throughputUnit = "vertices/s";
+    results.push_back(center);
+
+    Result connectivity;
+    connectivity.name = "MeshConnectivity";
+    measure(options.repeats, nullptr, [&]() {
+        MeshConnectivity built(loaded.getVertexCount(), loaded.getFaces(), options.threads);
+    }, connectivity);
+    connectivity.throughput = perSecond(loaded.getFaceCount(), connectivity.medianMs);
+    connectivity.throughputUnit = "faces/s";
+    results.push_back(connectivity);
+
+    Mesh sorted;
+    Result spatial;
+    spatial.name = "sortSpatially";
+    measure(options.repeats, [&]() { sorted = loaded; }, [&]() { sorted.sortSpatially(); }, spatial);
+    spatial.throughput = perSecond(loaded.getVertexCount() + loaded.getFaceCount(), spatial.medianMs);
+    spatial.throughputUnit = "elements/s";
+    results.push_back(spatial);
+
+    // Each run reorders a fresh copy, including its connectivity build
+    Mesh reordered;
+    Result cache;
+    cache.name = "VertexCacheOptimizer::optimize";
+    measure(options.repeats, [&]() { reordered = loaded; },
+            [&]() { VertexCacheOptimizer().optimize(reordered); }, cache);
+    cache.throughput = perSecond(loaded.getFaceCount(), cache.medianMs);
+    cache.throughputUnit = "faces/s";
+    results.push_back(cache);
+
+    // Each run splits a fresh copy, including its connectivity build
+    Mesh split;
+    Result meshlets;
+    meshlets.name = "Meshlets::build";
+    measure(options.repeats, [&]() { split = loaded; }, [&]() { split.buildMeshlets(options.threads); }, meshlets);
+    meshlets.throughput = perSecond(loaded.getFaceCount(), meshlets.medianMs);
+    meshlets.throughputUnit = "faces/s";
+    results.push_back(meshlets);
+
+    // Close up on the front of the unit-sized mesh, as when zoomed in
+    ViewFrustum view;
+    view.eye = Vector3(0.0f, 0.0f, 0.6f);
+    view.tanHalfFovY = std::tan(22.5f * 3.14159f / 180.0f);
+    view.aspect = 4.0f / 3.0f;
+    std::vector<uint32_t> visible;
+    Result cull;
+    cull.name = "Meshlets::cull";
+    measure(options.repeats, nullptr, [&]() { split.getMeshlets()->cull(view, visible, options.threads); }, cull);
+    cull.throughput = perSecond(split.getMeshlets()->size(), cull.medianMs);
+    cull.throughputUnit = "meshlets/s";
+    results.push_back(cull);
+
+    const MeshError error(loaded, options.threads);
+    for (int gridSize : options.gridSizes) {
+        VertexClustering clustering(gridSize);
+        clustering.setThreadCount(options.threads);
+        Mesh simplified;
+        Result simplify;
+        simplify.name = "VertexClustering::simplify";
+        simplify.gridSize = gridSize;
+        measure(options.repeats, nullptr, [&]() { simplified = clustering.simplify(loaded); }, simplify);
+        simplify.outputFaces = simplified.getFaceCount();
+        simplify.throughput = perSecond(loaded.getFaceCount(), simplify.medianMs);
+        simplify.throughputUnit = "faces/s";
+        results.push_back(simplify);
+
+        // Simplifying again into the same mesh reuses its buffers and the
+        // clustering's tables; after one untimed call it should not allocate
+        Mesh reused;
+        clustering.simplify(loaded, reused);
+        Result resimplify;
+        resimplify.name = "VertexClustering::resimplify";
+        resimplify.gridSize = gridSize;
+        measure(options.repeats, nullptr, [&]() { clustering.simplify(loaded, reused); }, resimplify);
+        resimplify.outputFaces = reused.getFaceCount();
+        resimplify.throughput = perSecond(loaded.getFaceCount(), resimplify.medianMs);
+        resimplify.throughputUnit = "faces/s";
+        results.push_back(resimplify);
+
+        // Simplified levels are what gets stored packed; MB/s counts the
+        // vertex and face arrays produced
+        std::vector<uint8_t> packed;
+        MeshCodec::encode(simplified.getVertices(), simplified.getFaces(), MeshCodec::kDefaultBits, packed);
+        std::vector<Vector3> unpackedVertices;
+        std::vector<Face> unpackedFaces;
+        Result unpack;
+        unpack.name = "MeshCodec::decode";
+        unpack.gridSize = gridSize;
+        measure(options.repeats, nullptr, [&]() {
+            MeshCodec::decode(packed.data(), packed.size(), unpackedVertices, unpackedFaces);
+        }, unpack);
+        unpack.outputFaces = simplified.getFaceCount();
+        unpack.throughput = perSecond(simplified.getFaceCount(), unpack.medianMs);
+        unpack.throughputUnit = "faces/s";
+        unpack.megabytesPerSecond = perSecond(simplified.getVertexCount() * sizeof(Vector3) +
+                                              simplified.getFaceCount() * sizeof(Face), unpack.medianMs) /
+                                    (1024.0 * 1024.0);
+        results.push_back(unpack);
+
+        MeshError::Result distances;
+        Result evaluate;
+        evaluate.name = "MeshError::evaluate";
+        evaluate.gridSize = gridSize;
+        measure(options.repeats, nullptr, [&]() { error.evaluate(simplified, distances); }, evaluate);
+        evaluate.outputFaces = simplified.getFaceCount();
+        evaluate.throughput = perSecond(distances.symmetric.samples, evaluate.medianMs);
+        evaluate.throughputUnit = "samples/s";
+        results.push_back(evaluate);
+    }
+
+    for (size_t i = first; i < results.size(); i++) {
+        results[i].mesh = label;
+        results[i].vertices = loaded.getVertexCount();
+        results[i].faces = loaded.getFaceCount();
+    }
+    std::cerr << label << ": " << loaded.getFaceCount() << " faces, load "
+              << load.medianMs << " ms" << std::endl;
+}
+
+std::string jsonString(const std::string& text) {
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+void writeJson(std::ostream& out, const std::vector<Result>& results, const Options& options) {
+    out << "{\n  \"repeats\": " << options.repeats
+        << ",\n  \"layout\": " << (options.layout == Mesh::PositionLayout::SoA ? "\"soa\"" : "\"aos\"")
+        << ",\n  \"order\": " << (options.order == Mesh::VertexOrder::Morton ? "\"morton\"" : "\"file\"")
+        << ",\n  \"simd\": " << jsonString(VertexKernels::isaName(VertexKernels::activeIsa()))
+        << ",\n  \"peak_rss_mb\": " << peakRssMegabytes()
+        << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        out << "    {\"benchmark\": " << jsonString(r.name)
+            << ", \"mesh\": " << jsonString(r.mesh)
+            << ", \"vertices\": " << r.vertices
+            << ", \"faces\": " << r.faces;
+        if (r.gridSize > 0) {
+            out << ", \"grid_size\": " << r.gridSize << ", \"output_faces\": " << r.outputFaces;
+        }
+        out << ", \"median_ms\": " << r.medianMs
+            << ", \"p95_ms\": " << r.p95Ms
+            << ", \"throughput\": " << r.throughput
+            << ", \"throughput_unit\": " << jsonString(r.throughputUnit)
+            << ", \"allocations\": " << r.allocations.allocations
+            << ", \"allocated_bytes\": " << r.allocations.bytes;
+        if (r.megabytesPerSecond > 0.0) out << ", \"mb_per_s\": " << r.megabytesPerSecond;
+        out << ", \"peak_rss_mb\": " << r.peakRssMb << "}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--models" && i + 1 < argc) options.modelsDir = argv[++i];
+        else if (arg == "--max-triangles" && i + 1 < argc) options.maxTriangles = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--repeat" && i + 1 < argc) options.repeats = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--threads" && i + 1 < argc) options.threads = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--output" && i + 1 < argc) options.outputPath = argv[++i];
+        else if (arg == "--layout" && i + 1 < argc) {
+            std::string name = argv[++i];
+            options.layout = name == "soa" ? Mesh::PositionLayout::SoA : Mesh::PositionLayout::AoS;
+        }
+        else if (arg == "--order" && i + 1 < argc) {
+            std::string name = argv[++i];
+            options.order = name == "morton" ? Mesh::VertexOrder::Morton : Mesh::VertexOrder::File;
+        }
+        else if (arg == "--grids" && i + 1 < argc) {
+            options.gridSizes.clear();
+            std::stringstream list(argv[++i]);
+            std::string item;
+            while (std::getline(list, item, ',')) {
+                if (std::atoi(item.c_str()) > 0) options.gridSizes.push_back(std::atoi(item.c_str()));
+            }
+        }
+        else {
+            std::cerr << "Usage: MeshBenchmarks [--models DIR] [--max-triangles N] [--repeat N]\n"
+                      << "                      [--grids 8,16,...] [--threads N] [--layout aos|soa]\n"
+                      << "                      [--order file|morton] [--output FILE]\n";
+            return 2;
+        }
+    }
+
+    std::vector<Result> results;
+    const char* resolutions[] = {"bun_zipper_res4", "bun_zipper_res3", "bun_zipper_res2", "bun_zipper"};
+    for (const char* name : resolutions) {
+        std::string path = (fs::path(options.modelsDir) / (std::string(name) + ".ply")).string();
+        if (!fs::exists(path)) {
+            std::cerr << "Error: Missing " << path << std::endl;
+            return 1;
+        }
+        benchmarkMesh(name, path, options, results);
+    }
+
+    // Synthetic meshes: subdivide the full bunny until the face cap is reached
+    std::vector<Vector3> vertices;
+    std::vector<Face> faces;
+    if (!FileIO::loadPLY((fs::path(options.modelsDir) / "bun_zipper.ply").string(), vertices, faces)) {
+        return 1;
+    }
+    const fs::path scratch = fs::temp_directory_path() / "mesh_benchmarks.ply";
+    for (int level = 1; faces.size() < options.maxTriangles; level++) {
+        subdivide(vertices, faces);
+        if (!FileIO::savePLY(scratch.string(), vertices, faces)) return 1;
+        benchmarkMesh("bun_zipper_subdiv" + std::to_string(level), scratch.string(), options, results);
+    }
+    std::error_code ignored;
+    fs::remove(scratch, ignored);
+
+    if (options.outputPath.empty()) {
+        writeJson(std::cout, results, options);
+    } else {
+        std::ofstream out(options.outputPath);
+        if (!out) {
+            std::cerr << "Error: Could not write " << options.outputPath << std::endl;
+            return 1;
+        }
+        writeJson(out, results, options);
+    }
+    return 0;
+}
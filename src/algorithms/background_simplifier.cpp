@@ -0,0 +1,57 @@
+#include "background_simplifier.hpp"
+#include "../utils/trace.hpp"
+#include <utility>
+
+BackgroundSimplifier::BackgroundSimplifier(unsigned threadCount) : pool(threadCount) {}
+
+BackgroundSimplifier::~BackgroundSimplifier() {
+    if (latestCancel) latestCancel->store(true);
+    pool.wait();
+    delete pending.exchange(nullptr);
+}
+
+uint64_t BackgroundSimplifier::submit(Job job) {
+    if (latestCancel) latestCancel->store(true);
+    auto cancel = std::make_shared<std::atomic<bool>>(false);
+    latestCancel = cancel;
+    const uint64_t sequence = ++submitted;
+
+    outstanding++;
+    pool.submit([this, job = std::move(job), cancel, sequence]() {
+        bool published = false;
+        if (!cancel->load()) {
+            Trace::Scope trace("BackgroundSimplifier::job");
+            Mesh mesh = job(*cancel);
+            if (!cancel->load()) {
+                publish(new Result{sequence, std::move(mesh)});
+                published = true;
+            }
+        }
+        if (!published) Trace::count("jobs_cancelled", 1);
+        outstanding--;
+    });
+    return sequence;
+}
+
+void BackgroundSimplifier::publish(Result* result) {
+    Result* current = pending.load();
+    do {
+        // A newer job finished first; this result is already out of date
+        if (current && current->sequence > result->sequence) {
+            delete result;
+            return;
+        }
+    } while (!pending.compare_exchange_weak(current, result));
+
+    // The result it replaced was never taken, so never drawn
+    delete current;
+}
+
+std::unique_ptr<Mesh> BackgroundSimplifier::takeResult(uint64_t* sequence) {
+    std::unique_ptr<Result> result(pending.exchange(nullptr));
+    if (!result || result->sequence <= taken) return nullptr;
+
+    taken = result->sequence;
+    if (sequence) *sequence = taken;
+    return std::unique_ptr<Mesh>(new Mesh(std::move(result->mesh)));
+}
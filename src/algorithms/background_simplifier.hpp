@@ -0,0 +1,62 @@
+#pragma once
+#include "../mesh/mesh.hpp"
+#include "../utils/thread_pool.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+// Runs simplification jobs on worker threads so the thread that draws
+// never waits for one.
+//
+// Every submit() supersedes the jobs before it: their cancel flags are set,
+// so a queued job returns without starting and a running one stops at the
+// simplifier's next check (see setCancelFlag on the simplifiers). A
+// finished job publishes its mesh by swapping a pointer into a single
+// pending slot, and the drawing thread takes it with takeResult(), after
+// which it owns the mesh. A mesh only gets GPU buffers once it is drawn, so
+// meshes with buffers are only ever freed by the drawing thread; a result
+// replaced in the slot before it was taken was never drawn, and the worker
+// frees it. Results carry their job's sequence number and an older result
+// never replaces a newer one.
+class BackgroundSimplifier {
+public:
+    // Builds the mesh. It should hand the flag to the simplifier; whatever
+    // it returns once the flag is set is discarded.
+    using Job = std::function<Mesh(const std::atomic<bool>& cancelled)>;
+
+    // 0 threads uses one per hardware thread
+    explicit BackgroundSimplifier(unsigned threadCount = 1);
+    // Cancels outstanding jobs and waits for them to return
+    ~BackgroundSimplifier();
+
+    BackgroundSimplifier(const BackgroundSimplifier&) = delete;
+    BackgroundSimplifier& operator=(const BackgroundSimplifier&) = delete;
+
+    // Queues a job and cancels every earlier one; returns its sequence number.
+    // Call from one thread.
+    uint64_t submit(Job job);
+
+    // Newest finished mesh not taken yet, or null; sequence receives its
+    // job's number. Call from the thread that draws.
+    std::unique_ptr<Mesh> takeResult(uint64_t* sequence = nullptr);
+
+    // True while a job is queued or running
+    bool busy() const { return outstanding.load() > 0; }
+
+private:
+    struct Result {
+        uint64_t sequence;
+        Mesh mesh;
+    };
+
+    std::atomic<Result*> pending{nullptr};
+    std::atomic<size_t> outstanding{0};
+    uint64_t submitted = 0;                            // Submitting thread only
+    uint64_t taken = 0;                                // Drawing thread only
+    std::shared_ptr<std::atomic<bool>> latestCancel;   // Flag of the newest job
+    ThreadPool pool;                                   // Last, so it is joined first
+
+    void publish(Result* result);
+};
@@ -0,0 +1,186 @@
+#include "cell_accumulator.hpp"
+#include "../mesh/vertex_kernels.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Sums are stored in units of extent / 2^31 per axis; with 2^31 vertices in a
+// single cell the total still fits in an int64
+const double kFixedRange = 2147483648.0;
+
+inline uint64_t hashKey(uint64_t key, int bits) {
+    return (key * 0x9E3779B97F4A7C15ULL) >> (64 - bits);
+}
+
+} // namespace
+
+CellAccumulator::CellAccumulator(int gridSize, const Vector3& min, const Vector3& max,
+                                 size_t denseBudgetBytes) {
+    reset(gridSize, min, max, denseBudgetBytes);
+}
+
+void CellAccumulator::reset(int gridSize, const Vector3& min, const Vector3& max,
+                            size_t denseBudgetBytes) {
+    this->gridSize = std::max(gridSize, 1);
+    this->min = min;
+    this->max = max;
+    const uint64_t g = static_cast<uint64_t>(this->gridSize);
+    const uint64_t cells = g * g * g;
+    const bool wasDense = dense && denseSlots.size() == cells;
+    dense = cells <= denseBudgetBytes / sizeof(uint32_t);
+
+    // A dense table of the same size only needs the cells the last pass
+    // touched cleared, and those are exactly the slot keys
+    if (dense && wasDense) {
+        for (uint64_t key : keys) denseSlots[key] = kEmpty;
+    }
+    keys.clear();
+    sums.clear();
+    counts.clear();
+
+    const float extent[3] = {max.x - min.x, max.y - min.y, max.z - min.z};
+    for (int axis = 0; axis < 3; axis++) {
+        // A flat axis puts every vertex in cell 0
+        cellScale[axis] = extent[axis] > 0.0f ? this->gridSize / extent[axis] : 0.0f;
+        toFixed[axis] = extent[axis] > 0.0f ? kFixedRange / extent[axis] : 0.0;
+    }
+
+    if (dense) {
+        if (!wasDense) denseSlots.assign(cells, kEmpty);
+        std::vector<uint64_t>().swap(hashKeys);
+        std::vector<uint32_t>().swap(hashSlots);
+    } else {
+        std::vector<uint32_t>().swap(denseSlots);
+        hashBits = 16;
+        hashKeys.assign(size_t(1) << hashBits, 0);
+        hashSlots.assign(size_t(1) << hashBits, kEmpty);
+    }
+}
+
+uint64_t CellAccumulator::cellKey(const Vector3& pos) const {
+    // Positions on the max face land exactly on gridSize and are clamped
+    const float last = static_cast<float>(gridSize - 1);
+    const uint64_t g = static_cast<uint64_t>(gridSize);
+    return VertexKernels::cellIndex(pos.x, min.x, cellScale[0], last) +
+           g * (VertexKernels::cellIndex(pos.y, min.y, cellScale[1], last) +
+                g * VertexKernels::cellIndex(pos.z, min.z, cellScale[2], last));
+}
+
+void CellAccumulator::cellKeys(const float* x, const float* y, const float* z, size_t count,
+                               uint64_t* keys) const {
+    VertexKernels::quantize(x, y, z, count, min, cellScale, gridSize, keys);
+}
+
+uint32_t CellAccumulator::add(uint64_t key, const Vector3& pos) {
+    const uint32_t slot = slotFor(key);
+
+    int64_t* sum = &sums[size_t(slot) * 3];
+    sum[0] += static_cast<int64_t>((static_cast<double>(pos.x) - min.x) * toFixed[0] + 0.5);
+    sum[1] += static_cast<int64_t>((static_cast<double>(pos.y) - min.y) * toFixed[1] + 0.5);
+    sum[2] += static_cast<int64_t>((static_cast<double>(pos.z) - min.z) * toFixed[2] + 0.5);
+    counts[slot]++;
+
+    return slot;
+}
+
+Vector3 CellAccumulator::average(uint32_t slot) const {
+    const int64_t* sum = &sums[size_t(slot) * 3];
+    const double count = counts[slot];
+
+    Vector3 result;
+    result.x = toFixed[0] > 0.0 ? static_cast<float>(min.x + (sum[0] / count) / toFixed[0]) : min.x;
+    result.y = toFixed[1] > 0.0 ? static_cast<float>(min.y + (sum[1] / count) / toFixed[1]) : min.y;
+    result.z = toFixed[2] > 0.0 ? static_cast<float>(min.z + (sum[2] / count) / toFixed[2]) : min.z;
+    return result;
+}
+
+void CellAccumulator::merge(const CellAccumulator& other, std::vector<uint32_t>& remap) {
+    remap.resize(other.cellCount());
+    for (uint32_t otherSlot = 0; otherSlot < other.cellCount(); otherSlot++) {
+        const uint32_t slot = slotFor(other.keys[otherSlot]);
+        for (int axis = 0; axis < 3; axis++) {
+            sums[size_t(slot) * 3 + axis] += other.sums[size_t(otherSlot) * 3 + axis];
+        }
+        counts[slot] += other.counts[otherSlot];
+        remap[otherSlot] = slot;
+    }
+}
+
+CellAccumulator CellAccumulator::coarsen(std::vector<uint32_t>& remap,
+                                         size_t denseBudgetBytes) const {
+    CellAccumulator coarse(gridSize / 2, min, max, denseBudgetBytes);
+    const uint64_t g = static_cast<uint64_t>(gridSize);
+    const uint64_t cg = static_cast<uint64_t>(coarse.gridSize);
+
+    remap.resize(cellCount());
+    for (uint32_t slot = 0; slot < cellCount(); slot++) {
+        const uint64_t key = keys[slot];
+        const uint64_t x = key % g;
+        const uint64_t y = (key / g) % g;
+        const uint64_t z = key / (g * g);
+        const uint64_t coarseKey = (x >> 1) + cg * ((y >> 1) + cg * (z >> 1));
+
+        const uint32_t coarseSlot = coarse.slotFor(coarseKey);
+        for (int axis = 0; axis < 3; axis++) {
+            coarse.sums[size_t(coarseSlot) * 3 + axis] += sums[size_t(slot) * 3 + axis];
+        }
+        coarse.counts[coarseSlot] += counts[slot];
+        remap[slot] = coarseSlot;
+    }
+    return coarse;
+}
+
+size_t CellAccumulator::memoryBytes() const {
+    return denseSlots.capacity() * sizeof(uint32_t) +
+           hashKeys.capacity() * sizeof(uint64_t) +
+           hashSlots.capacity() * sizeof(uint32_t) +
+           keys.capacity() * sizeof(uint64_t) +
+           sums.capacity() * sizeof(int64_t) +
+           counts.capacity() * sizeof(uint32_t);
+}
+
+uint32_t CellAccumulator::slotFor(uint64_t key) {
+    if (dense) {
+        uint32_t& slot = denseSlots[key];
+        if (slot == kEmpty) slot = newSlot(key);
+        return slot;
+    }
+
+    const size_t mask = (size_t(1) << hashBits) - 1;
+    for (size_t i = hashKey(key, hashBits);; i = (i + 1) & mask) {
+        if (hashSlots[i] == kEmpty) {
+            const uint32_t slot = newSlot(key);
+            hashKeys[i] = key;
+            hashSlots[i] = slot;
+            // Keep the load factor at or below 1/2
+            if (keys.size() * 2 > hashSlots.size()) growHash();
+            return slot;
+        }
+        if (hashKeys[i] == key) return hashSlots[i];
+    }
+}
+
+uint32_t CellAccumulator::newSlot(uint64_t key) {
+    const uint32_t slot = static_cast<uint32_t>(keys.size());
+    keys.push_back(key);
+    sums.insert(sums.end(), 3, 0);
+    counts.push_back(0);
+    return slot;
+}
+
+void CellAccumulator::growHash() {
+    hashBits++;
+    const size_t capacity = size_t(1) << hashBits;
+    const size_t mask = capacity - 1;
+    hashKeys.assign(capacity, 0);
+    hashSlots.assign(capacity, kEmpty);
+
+    // Every key lives in the per-slot arrays, so rebuild from those
+    for (uint32_t slot = 0; slot < keys.size(); slot++) {
+        size_t i = hashKey(keys[slot], hashBits);
+        while (hashSlots[i] != kEmpty) i = (i + 1) & mask;
+        hashKeys[i] = keys[slot];
+        hashSlots[i] = slot;
+    }
+}
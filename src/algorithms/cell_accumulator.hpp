@@ -0,0 +1,88 @@
+#pragma once
+#include "../mesh/mesh.hpp"
+#include <cstdint>
+#include <vector>
+
+// Per-cell position sums for uniform-grid clustering.
+//
+// Cells are addressed by a linear key x + g*(y + g*z). When a gridSize^3
+// table of slot indices fits in the memory budget the key indexes it
+// directly; otherwise an open-addressing hash table maps keys to slots.
+// Either way a vertex costs one index computation. Slots are numbered in
+// first-touch order and hold their sums in 64-bit fixed point, so the
+// result does not depend on the order the sums were formed in.
+class CellAccumulator {
+public:
+    static constexpr size_t kDefaultDenseBudget = size_t(256) << 20;  // 256 MB
+    static constexpr uint32_t kEmpty = 0xFFFFFFFFu;
+
+    CellAccumulator(int gridSize, const Vector3& min, const Vector3& max,
+                    size_t denseBudgetBytes = kDefaultDenseBudget);
+
+    // Empties the accumulator for a new grid and bounds, keeping the memory
+    // of its tables for reuse. A dense table of unchanged size is cleared
+    // cell by cell over the cells last used, not refilled.
+    void reset(int gridSize, const Vector3& min, const Vector3& max,
+               size_t denseBudgetBytes = kDefaultDenseBudget);
+
+    // Linear key of the grid cell containing a position (clamped to the grid)
+    uint64_t cellKey(const Vector3& pos) const;
+
+    // Keys of count positions stored as separate x/y/z arrays; same values
+    // as cellKey, computed with the SIMD quantization kernel
+    void cellKeys(const float* x, const float* y, const float* z, size_t count, uint64_t* keys) const;
+
+    // Adds a position to its cell and returns the cell's slot
+    uint32_t add(const Vector3& pos) { return add(cellKey(pos), pos); }
+    // Same, with the position's key already computed
+    uint32_t add(uint64_t key, const Vector3& pos);
+
+    size_t cellCount() const { return keys.size(); }
+    bool isDense() const { return dense; }
+    size_t memoryBytes() const;
+
+    uint64_t keyOf(uint32_t slot) const { return keys[slot]; }
+    uint32_t countOf(uint32_t slot) const { return counts[slot]; }
+
+    // Mean position of the vertices in a slot
+    Vector3 average(uint32_t slot) const;
+
+    // Folds in an accumulator built over the same grid and bounds; remap[s]
+    // receives the slot here of the other's slot s. Merging partials built
+    // over consecutive input ranges, in order, gives the same slots and sums
+    // as a single pass over the whole input.
+    void merge(const CellAccumulator& other, std::vector<uint32_t>& remap);
+
+    // Accumulator for the grid with half the resolution, formed by merging
+    // each 2x2x2 block of cells; remap[s] receives the coarse slot of slot s.
+    // Requires an even grid size. Slots and sums equal those of a fresh pass
+    // at gridSize / 2, up to float rounding at cell boundaries.
+    CellAccumulator coarsen(std::vector<uint32_t>& remap,
+                            size_t denseBudgetBytes = kDefaultDenseBudget) const;
+
+    int getGridSize() const { return gridSize; }
+
+private:
+    int gridSize;
+    bool dense = false;
+    Vector3 min, max;
+    float cellScale[3];  // gridSize / extent per axis
+    double toFixed[3];   // Fixed-point units per world unit per axis
+
+    // Dense path: one slot index per grid cell
+    std::vector<uint32_t> denseSlots;
+
+    // Hashed path: power-of-two open-addressing table of (key, slot)
+    std::vector<uint64_t> hashKeys;
+    std::vector<uint32_t> hashSlots;
+    int hashBits = 0;
+
+    // Per-slot data
+    std::vector<uint64_t> keys;
+    std::vector<int64_t> sums;  // 3 per slot
+    std::vector<uint32_t> counts;
+
+    uint32_t slotFor(uint64_t key);
+    uint32_t newSlot(uint64_t key);
+    void growHash();
+};
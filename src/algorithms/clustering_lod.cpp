@@ -0,0 +1,214 @@
+#include "clustering_lod.hpp"
+#include "cell_accumulator.hpp"
+#include "face_deduplicator.hpp"
+#include "../utils/parallel.hpp"
+#include "../utils/trace.hpp"
+#include <algorithm>
+
+namespace {
+
+// Coarsest grid of each ladder besides the powers of two; the others double it
+const int kMantissas[] = {5, 6, 7};
+const int kLadderCount = 1 + sizeof(kMantissas) / sizeof(kMantissas[0]);
+
+int floorPowerOfTwo(int value) {
+    int power = 1;
+    while (power * 2 <= value) power *= 2;
+    return power;
+}
+
+} // namespace
+
+ClusteringLOD::ClusteringLOD(const Mesh& inputMesh, int minGridSize, int maxGridSize, unsigned threadCount)
+    : threadCount(threadCount) {
+    const auto& inputVertices = inputMesh.getVertices();
+    if (inputVertices.empty()) return;
+    Trace::Scope trace("ClusteringLOD::build");
+
+    minGridSize = std::max(minGridSize, 1);
+    maxGridSize = std::max(maxGridSize, 1);
+
+    // Finest and coarsest grid of each ladder. The powers of two are rounded
+    // down at both ends and always keep at least one level; the m * 2^k
+    // ladders only hold grids within range.
+    std::vector<std::pair<int, int>> spans;
+    const int finest = floorPowerOfTwo(maxGridSize);
+    spans.emplace_back(finest, std::min(floorPowerOfTwo(minGridSize), finest));
+    for (int mantissa : kMantissas) {
+        int top = mantissa;
+        while (top * 2 <= maxGridSize) top *= 2;
+        if (top > maxGridSize || top < minGridSize) continue;
+        int bottom = top;
+        while (bottom % 2 == 0 && bottom / 2 >= minGridSize) bottom /= 2;
+        spans.emplace_back(top, bottom);
+    }
+
+    Vector3 min, max;
+    inputMesh.getBoundingBox(min, max);
+    extent = std::max({max.x - min.x, max.y - min.y, max.z - min.z});
+
+    // Ladders are independent, so each runs on its own thread
+    const int ladderCount = static_cast<int>(spans.size());
+    std::vector<std::vector<Level>> ladders(ladderCount);
+    ladderFaces.resize(ladderCount);
+    const unsigned threads = Parallel::resolveThreadCount(threadCount);
+    Parallel::forChunks(ladderCount, Parallel::chunkCount(ladderCount, threads, 1),
+        [&](unsigned, size_t begin, size_t end) {
+            for (size_t ladder = begin; ladder < end; ladder++) {
+                buildLadder(inputMesh, min, max, spans[ladder].first, spans[ladder].second,
+                            static_cast<int>(ladder), ladders[ladder], ladderFaces[ladder]);
+            }
+        });
+
+    for (auto& ladder : ladders) {
+        for (auto& level : ladder) levels.push_back(std::move(level));
+    }
+    std::sort(levels.begin(), levels.end(),
+              [](const Level& a, const Level& b) { return a.gridSize < b.gridSize; });
+
+    Trace::count("lod_levels", levelCount());
+    Trace::count("lod_finest_cells", static_cast<int64_t>(levels.back().positions.size()));
+    Trace::sampleMemory();
+}
+
+void ClusteringLOD::buildLadder(const Mesh& inputMesh, const Vector3& min, const Vector3& max,
+                                int finest, int coarsest, int ladder,
+                                std::vector<Level>& levels, std::vector<uint32_t>& leafFaces) {
+    const auto& inputVertices = inputMesh.getVertices();
+    const auto& inputFaces = inputMesh.getFaces();
+
+    // Finest level: quantize every vertex once
+    const size_t budget = CellAccumulator::kDefaultDenseBudget / kLadderCount;
+    CellAccumulator cells(finest, min, max, budget);
+    std::vector<uint32_t> vertexToLeaf(inputVertices.size());
+    for (size_t i = 0; i < inputVertices.size(); i++) {
+        vertexToLeaf[i] = cells.add(inputVertices[i]);
+    }
+    const size_t leafCount = cells.cellCount();
+
+    int levelTotal = 1;
+    for (int g = finest; g > coarsest; g /= 2) levelTotal++;
+    levels.resize(levelTotal);
+
+    // Walk from the finest level to the coarsest, merging 2x2x2 blocks
+    for (int level = levelTotal - 1; level >= 0; level--) {
+        Level& current = levels[level];
+        current.ladder = ladder;
+
+        if (level == levelTotal - 1) {
+            current.leafToCell.resize(leafCount);
+            for (uint32_t leaf = 0; leaf < leafCount; leaf++) current.leafToCell[leaf] = leaf;
+        } else {
+            std::vector<uint32_t> remap;
+            cells = cells.coarsen(remap, budget);
+            current.leafToCell = levels[level + 1].leafToCell;
+            for (auto& cell : current.leafToCell) cell = remap[cell];
+        }
+
+        current.gridSize = cells.getGridSize();
+        current.positions.resize(cells.cellCount());
+        for (uint32_t slot = 0; slot < cells.cellCount(); slot++) {
+            current.positions[slot] = cells.average(slot);
+        }
+    }
+
+    // Coarsest level at which each face keeps three distinct corners; it then
+    // survives at every finer level. Faces degenerate even at the finest level
+    // are dropped.
+    std::vector<int> survivesFrom(inputFaces.size(), levelTotal);
+    std::vector<size_t> bucketSize(levelTotal + 1, 0);
+    for (size_t f = 0; f < inputFaces.size(); f++) {
+        const Face& face = inputFaces[f];
+        const uint32_t a = vertexToLeaf[face.v1];
+        const uint32_t b = vertexToLeaf[face.v2];
+        const uint32_t c = vertexToLeaf[face.v3];
+
+        int level = levelTotal;
+        for (int l = levelTotal - 1; l >= 0; l--) {
+            const auto& map = levels[l].leafToCell;
+            const uint32_t ca = map[a], cb = map[b], cc = map[c];
+            if (ca == cb || cb == cc || cc == ca) break;
+            level = l;
+        }
+        survivesFrom[f] = level;
+        bucketSize[level]++;
+    }
+
+    // Counting sort by survival level, stable in input order
+    std::vector<size_t> bucketStart(levelTotal + 1, 0);
+    for (int l = 1; l <= levelTotal; l++) bucketStart[l] = bucketStart[l - 1] + bucketSize[l - 1];
+    for (int l = 0; l < levelTotal; l++) levels[l].faceEnd = bucketStart[l] + bucketSize[l];
+
+    leafFaces.resize(bucketStart[levelTotal] * 3);
+    for (size_t f = 0; f < inputFaces.size(); f++) {
+        const int level = survivesFrom[f];
+        if (level == levelTotal) continue;
+        const size_t out = bucketStart[level]++ * 3;
+        leafFaces[out] = vertexToLeaf[inputFaces[f].v1];
+        leafFaces[out + 1] = vertexToLeaf[inputFaces[f].v2];
+        leafFaces[out + 2] = vertexToLeaf[inputFaces[f].v3];
+    }
+
+    // Faces each level keeps once repeated triangles are dropped
+    FaceDeduplicator deduplicator;
+    std::vector<Face> faces;
+    std::vector<uint64_t> keys;
+    for (Level& level : levels) {
+        levelFaces(level, leafFaces, faces, keys);
+        level.faces = faces.size() - deduplicator.removeDuplicates(faces, keys, 1);
+    }
+}
+
+int ClusteringLOD::levelForGridSize(int gridSize) const {
+    int best = 0;
+    for (int l = 0; l < levelCount(); l++) {
+        if (levels[l].gridSize <= gridSize) best = l;
+    }
+    return best;
+}
+
+int ClusteringLOD::levelForFaceCount(size_t targetFaces) const {
+    int best = 0;
+    for (int l = 0; l < levelCount(); l++) {
+        if (levels[l].faces <= targetFaces) best = l;
+    }
+    return best;
+}
+
+int ClusteringLOD::levelForScreenSize(float pixelsPerUnit, float minPixels) const {
+    int best = 0;
+    for (int l = 0; l < levelCount(); l++) {
+        const float cellPixels = extent / levels[l].gridSize * pixelsPerUnit;
+        if (cellPixels >= minPixels) best = l;
+    }
+    return best;
+}
+
+Mesh ClusteringLOD::extract(int level) const {
+    Mesh mesh;
+    if (level < 0 || level >= levelCount()) return mesh;
+    Trace::Scope trace("ClusteringLOD::extract");
+
+    std::vector<Face> faces;
+    std::vector<uint64_t> keys;
+    const Level& current = levels[level];
+    levelFaces(current, ladderFaces[current.ladder], faces, keys);
+    FaceDeduplicator().removeDuplicates(faces, keys, threadCount);
+
+    mesh.setVertices(current.positions);
+    mesh.setFaces(std::move(faces));
+    return mesh;
+}
+
+void ClusteringLOD::levelFaces(const Level& current, const std::vector<uint32_t>& leafFaces,
+                               std::vector<Face>& faces, std::vector<uint64_t>& keys) {
+    faces.resize(current.faceEnd, Face(0, 0, 0));
+    keys.resize(current.faceEnd);
+    for (size_t f = 0; f < current.faceEnd; f++) {
+        const uint32_t a = current.leafToCell[leafFaces[f * 3]];
+        const uint32_t b = current.leafToCell[leafFaces[f * 3 + 1]];
+        const uint32_t c = current.leafToCell[leafFaces[f * 3 + 2]];
+        faces[f] = Face(a, b, c);
+        keys[f] = FaceDeduplicator::key(a, b, c);
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "../mesh/mesh.hpp"
+#include <cstdint>
+#include <vector>
+
+// Multi-resolution vertex clustering built once per mesh.
+//
+// Vertices are quantized on the finest grid, and each coarser level (half
+// the resolution) merges 2x2x2 blocks of the level above, forming an octree
+// of cell representatives. A triangle that collapses at one level stays
+// collapsed at every coarser level, so with faces sorted by the coarsest
+// level they survive at, each level's faces are a prefix of that list.
+// extract() therefore runs in time proportional to the output mesh.
+//
+// Halving alone only gives power-of-two grids, so, like GridSearch, the
+// levels come from four such octrees ("ladders"): the powers of two, and
+// m * 2^k for m = 5, 6, 7. That puts about five levels in every doubling
+// of the grid size. Ladders are built in parallel, each with its own sorted
+// face list, and their levels are merged in ascending grid order: level 0
+// is the coarsest grid (minGridSize) and the last is maxGridSize, or the
+// largest ladder grid below it.
+//
+// extract() drops repeated faces with FaceDeduplicator, and faceCount() is
+// measured the same way at build time, so each level matches
+// VertexClustering at that grid size with its default settings, up to float
+// rounding at cell boundaries and face order.
+class ClusteringLOD {
+public:
+    static constexpr int kMinGridSize = 4;
+    static constexpr int kMaxGridSize = 256;
+
+    // Builds every ladder grid between the two sizes; the power-of-two
+    // ladder rounds both down and always has at least one level. 0 threads
+    // uses one per hardware thread.
+    explicit ClusteringLOD(const Mesh& inputMesh, int minGridSize = kMinGridSize,
+                           int maxGridSize = kMaxGridSize, unsigned threadCount = 0);
+
+    int levelCount() const { return static_cast<int>(levels.size()); }
+    int gridSizeOf(int level) const { return levels[level].gridSize; }
+    size_t vertexCount(int level) const { return levels[level].positions.size(); }
+    size_t faceCount(int level) const { return levels[level].faces; }
+
+    // Finest level whose grid is no larger than gridSize
+    int levelForGridSize(int gridSize) const;
+    // Finest level with at most targetFaces faces (level 0 if none qualify)
+    int levelForFaceCount(size_t targetFaces) const;
+    // Finest level whose cells project to at least minPixels on screen, for a
+    // view where one world unit covers pixelsPerUnit pixels
+    int levelForScreenSize(float pixelsPerUnit, float minPixels) const;
+
+    // Builds the simplified mesh for a level
+    Mesh extract(int level) const;
+
+private:
+    struct Level {
+        int gridSize = 0;
+        int ladder = 0;
+        std::vector<Vector3> positions;   // One representative per occupied cell
+        std::vector<uint32_t> leafToCell; // Finest cell of the ladder -> cell at this level
+        size_t faceEnd = 0;               // Ladder faces [0, faceEnd) survive at this level
+        size_t faces = 0;                 // Of those, faces left once duplicates go
+    };
+
+    std::vector<Level> levels;                      // Coarsest first, all ladders
+    std::vector<std::vector<uint32_t>> ladderFaces; // Per ladder: 3 finest cells per face, sorted by survival
+    float extent = 1.0f;                            // Largest bounding box side
+    unsigned threadCount = 0;
+
+    // Builds one ladder's levels, coarsest first, and its sorted face list
+    static void buildLadder(const Mesh& inputMesh, const Vector3& min, const Vector3& max,
+                            int finest, int coarsest, int ladder,
+                            std::vector<Level>& levels, std::vector<uint32_t>& leafFaces);
+
+    // Faces of a level before duplicates are removed, with their keys
+    static void levelFaces(const Level& level, const std::vector<uint32_t>& leafFaces,
+                           std::vector<Face>& faces, std::vector<uint64_t>& keys);
+};
@@ -0,0 +1,96 @@
+#include "face_deduplicator.hpp"
+#include "../utils/parallel.hpp"
+#include "../utils/trace.hpp"
+#include <algorithm>
+
+namespace {
+
+const uint32_t kEmpty = 0xFFFFFFFFu;
+
+// Faces per thread below which the set stays on one thread
+const size_t kMinChunk = 65536;
+
+inline void sortCorners(uint32_t& a, uint32_t& b, uint32_t& c) {
+    if (a > b) std::swap(a, b);
+    if (b > c) std::swap(b, c);
+    if (a > b) std::swap(a, b);
+}
+
+// Share of the key space a key falls in, for `parts` threads
+inline unsigned partOf(uint64_t key, unsigned parts) {
+    return static_cast<unsigned>(((key >> 32) * parts) >> 32);
+}
+
+} // namespace
+
+uint64_t FaceDeduplicator::key(uint32_t a, uint32_t b, uint32_t c) {
+    sortCorners(a, b, c);
+    uint64_t h = (static_cast<uint64_t>(a) << 32 | b) * 0x9E3779B97F4A7C15ULL;
+    h ^= (h >> 29) ^ (static_cast<uint64_t>(c) * 0xC2B2AE3D27D4EB4FULL);
+    h *= 0xBF58476D1CE4E5B9ULL;
+    return h ^ (h >> 31);
+}
+
+size_t FaceDeduplicator::removeDuplicates(std::vector<Face>& faces, std::vector<uint64_t>& keys,
+                                          unsigned threadCount) {
+    if (faces.size() < 2) return 0;
+    Trace::Scope trace("FaceDeduplicator::removeDuplicates");
+    const unsigned parts = Parallel::chunkCount(faces.size(), Parallel::resolveThreadCount(threadCount), kMinChunk);
+    if (sets.size() < parts) sets.resize(parts);
+    repeated.assign(faces.size(), 0);
+
+    // Each set starts at least half empty for an even share of the faces
+    size_t capacity = 16;
+    while (capacity < 2 * (faces.size() / parts + 1)) capacity *= 2;
+
+    Parallel::forChunks(parts, parts, [&](unsigned part, size_t, size_t) {
+        std::vector<Triple>& set = sets[part];
+        set.assign(std::max(capacity, set.size()), Triple{kEmpty, 0, 0});
+        size_t mask = set.size() - 1;
+        size_t stored = 0;
+
+        auto insert = [&](std::vector<Triple>& table, size_t tableMask, uint64_t hash, const Triple& t) {
+            for (size_t slot = hash & tableMask;; slot = (slot + 1) & tableMask) {
+                Triple& entry = table[slot];
+                if (entry.a == kEmpty) {
+                    entry = t;
+                    return true;
+                }
+                if (entry.a == t.a && entry.b == t.b && entry.c == t.c) return false;
+            }
+        };
+
+        for (size_t f = 0; f < faces.size(); f++) {
+            if (parts > 1 && partOf(keys[f], parts) != part) continue;
+            Triple t{faces[f].v1, faces[f].v2, faces[f].v3};
+            sortCorners(t.a, t.b, t.c);
+            if (!insert(set, mask, keys[f], t)) {
+                repeated[f] = 1;
+                continue;
+            }
+
+            // Past half full: double the set and reinsert what it holds
+            if (++stored * 2 > set.size()) {
+                std::vector<Triple> grown(set.size() * 2, Triple{kEmpty, 0, 0});
+                const size_t grownMask = grown.size() - 1;
+                for (const Triple& entry : set) {
+                    if (entry.a != kEmpty) insert(grown, grownMask, key(entry.a, entry.b, entry.c), entry);
+                }
+                set.swap(grown);
+                mask = grownMask;
+            }
+        }
+    });
+
+    size_t kept = 0;
+    for (size_t f = 0; f < faces.size(); f++) {
+        if (repeated[f]) continue;
+        faces[kept] = faces[f];
+        keys[kept] = keys[f];
+        kept++;
+    }
+    const size_t removed = faces.size() - kept;
+    faces.resize(kept, Face(0, 0, 0));
+    keys.resize(kept);
+    return removed;
+}
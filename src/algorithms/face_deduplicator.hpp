@@ -0,0 +1,35 @@
+#pragma once
+#include "../mesh/mesh.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Removes repeated triangles from a face list: faces over the same three
+// vertices as an earlier face, in either winding, are dropped and the first
+// occurrence is kept as it was.
+//
+// Callers hash each face with key() while they produce it (the clustering
+// remap loops do so as they write the face) and pass the hashes along. The
+// key is taken over the sorted corners, so rotations and reversed windings
+// collide. Faces are split between threads by the high bits of their key;
+// each thread walks the whole key array in order and inserts its own share
+// into an open-addressing set of sorted corner triples, so the faces kept do
+// not depend on the thread count. The sets keep their memory between calls.
+class FaceDeduplicator {
+public:
+    // Hash of a triangle's corners, the same for any rotation or winding
+    static uint64_t key(uint32_t a, uint32_t b, uint32_t c);
+
+    // Drops duplicates from faces, keeping order, and compacts keys to match.
+    // keys[i] must be key() of faces[i]. Returns how many faces were
+    // removed. 0 threads uses one per hardware thread.
+    size_t removeDuplicates(std::vector<Face>& faces, std::vector<uint64_t>& keys, unsigned threadCount = 0);
+
+private:
+    struct Triple {
+        uint32_t a, b, c;  // Sorted corners; a == kEmpty marks a free slot
+    };
+
+    std::vector<std::vector<Triple>> sets;  // One per thread
+    std::vector<uint8_t> repeated;          // Per face
+};
@@ -0,0 +1,200 @@
+#include "grid_search.hpp"
+#include "face_deduplicator.hpp"
+#include "cell_accumulator.hpp"
+#include "../utils/parallel.hpp"
+#include "../utils/trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+namespace {
+
+// Coarsest grid of each ladder; the others double it
+const int kMantissas[] = {4, 5, 6, 7};
+const int kLadderCount = sizeof(kMantissas) / sizeof(kMantissas[0]);
+
+} // namespace
+
+GridSearch::GridSearch(const Mesh& inputMesh, int minGridSize, int maxGridSize, unsigned threadCount)
+    : input(inputMesh), threadCount(threadCount) {
+    const auto& vertices = inputMesh.getVertices();
+    const auto& faces = inputMesh.getFaces();
+    if (vertices.empty()) return;
+    Trace::Scope trace("GridSearch::build");
+
+    minGridSize = std::max(minGridSize, 1);
+    maxGridSize = std::max(maxGridSize, minGridSize);
+    Vector3 min, max;
+    inputMesh.getBoundingBox(min, max);
+
+    // Ladders are independent, so each runs on its own thread
+    std::vector<std::vector<Candidate>> ladders(kLadderCount);
+    vertexToLeaf.resize(kLadderCount);
+    const unsigned threads = Parallel::resolveThreadCount(threadCount);
+    Parallel::forChunks(kLadderCount, Parallel::chunkCount(kLadderCount, threads, 1),
+        [&](unsigned, size_t begin, size_t end) {
+            for (size_t ladder = begin; ladder < end; ladder++) {
+                int finest = kMantissas[ladder];
+                while (finest * 2 <= maxGridSize) finest *= 2;
+                if (finest < minGridSize || finest > maxGridSize) continue;
+                std::vector<Candidate>& levels = ladders[ladder];
+
+                // Finest grid of the ladder: quantize every vertex once
+                const size_t budget = CellAccumulator::kDefaultDenseBudget / kLadderCount;
+                CellAccumulator cells(finest, min, max, budget);
+                std::vector<uint32_t>& toLeaf = vertexToLeaf[ladder];
+                toLeaf.resize(vertices.size());
+                for (size_t i = 0; i < vertices.size(); i++) toLeaf[i] = cells.add(vertices[i]);
+
+                // Then halve while the grid stays even and within range
+                std::vector<uint32_t> remap;
+                for (;;) {
+                    Candidate level;
+                    level.gridSize = cells.getGridSize();
+                    level.ladder = static_cast<int>(ladder);
+                    level.positions.resize(cells.cellCount());
+                    for (uint32_t slot = 0; slot < cells.cellCount(); slot++) {
+                        level.positions[slot] = cells.average(slot);
+                    }
+                    if (levels.empty()) {
+                        level.leafToCell.resize(cells.cellCount());
+                        for (uint32_t leaf = 0; leaf < cells.cellCount(); leaf++) level.leafToCell[leaf] = leaf;
+                    } else {
+                        level.leafToCell = levels.back().leafToCell;
+                        for (auto& cell : level.leafToCell) cell = remap[cell];
+                    }
+                    levels.push_back(std::move(level));
+
+                    const int gridSize = cells.getGridSize();
+                    if (gridSize % 2 != 0 || gridSize / 2 < minGridSize) break;
+                    cells = cells.coarsen(remap, budget);
+                }
+
+                // Count what extract() keeps, duplicates removed. A face that
+                // collapses on one grid stays collapsed on every coarser grid
+                // of the ladder, so each grid only walks the faces the finer
+                // one kept.
+                std::vector<uint32_t> kept(faces.size());
+                for (size_t f = 0; f < faces.size(); f++) kept[f] = static_cast<uint32_t>(f);
+                std::vector<Face> levelFaces;
+                std::vector<uint64_t> keys;
+                FaceDeduplicator deduplicator;
+                for (Candidate& level : levels) {
+                    const auto& map = level.leafToCell;
+                    levelFaces.clear();
+                    keys.clear();
+                    size_t survivors = 0;
+                    for (uint32_t f : kept) {
+                        const Face& face = faces[f];
+                        const uint32_t ca = map[toLeaf[face.v1]], cb = map[toLeaf[face.v2]], cc = map[toLeaf[face.v3]];
+                        if (ca == cb || cb == cc || cc == ca) continue;
+                        kept[survivors++] = f;
+                        levelFaces.emplace_back(ca, cb, cc);
+                        keys.push_back(FaceDeduplicator::key(ca, cb, cc));
+                    }
+                    kept.resize(survivors);
+                    level.faces = levelFaces.size() - deduplicator.removeDuplicates(levelFaces, keys, 1);
+                }
+            }
+        });
+
+    for (auto& levels : ladders) {
+        for (auto& level : levels) candidates.push_back(std::move(level));
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Candidate& a, const Candidate& b) { return a.gridSize < b.gridSize; });
+    Trace::count("grid_candidates", static_cast<int64_t>(candidates.size()));
+    Trace::sampleMemory();
+}
+
+bool GridSearch::forFaceCount(size_t targetFaces, Result& result) const {
+    if (candidates.empty()) return false;
+    auto startTime = std::chrono::steady_clock::now();
+
+    // Face counts are not strictly monotone in the grid size, so every
+    // candidate is checked
+    int best = -1;
+    for (int i = 0; i < candidateCount(); i++) {
+        if (candidates[i].faces <= targetFaces) best = i;
+    }
+
+    result = Result();
+    fill(result, best >= 0 ? best : 0);
+    result.met = best >= 0;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    return true;
+}
+
+bool GridSearch::forMaxError(double maxError, Result& result) {
+    if (candidates.empty()) return false;
+    Trace::Scope trace("GridSearch::forMaxError");
+    auto startTime = std::chrono::steady_clock::now();
+    if (!error) error.reset(new MeshError(input, threadCount));
+
+    // Error of each probed candidate; a mesh without faces never qualifies
+    std::vector<double> errors(candidates.size(), -1.0);
+    int evaluations = 0;
+    auto errorOf = [&](int candidate) {
+        if (errors[candidate] < 0.0) {
+            MeshError::Result distances;
+            const Mesh mesh = extract(candidate);
+            errors[candidate] = error->evaluate(mesh, distances)
+                ? distances.symmetric.max : std::numeric_limits<double>::infinity();
+            evaluations++;
+        }
+        return errors[candidate];
+    };
+
+    // Smallest candidate within the bound, by bisection
+    int low = 0, high = candidateCount() - 1;
+    const bool met = errorOf(high) <= maxError;
+    while (met && low < high) {
+        const int mid = low + (high - low) / 2;
+        if (errorOf(mid) <= maxError) high = mid;
+        else low = mid + 1;
+    }
+
+    result = Result();
+    fill(result, high);
+    result.error = errorOf(high);
+    result.met = met;
+    result.evaluations = evaluations;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    Trace::count("grid_search_evaluations", evaluations);
+    return true;
+}
+
+Mesh GridSearch::extract(int candidate) const {
+    Mesh mesh;
+    if (candidate < 0 || candidate >= candidateCount()) return mesh;
+    Trace::Scope trace("GridSearch::extract");
+
+    const Candidate& level = candidates[candidate];
+    const std::vector<uint32_t>& toLeaf = vertexToLeaf[level.ladder];
+    std::vector<Face> faces;
+    std::vector<uint64_t> keys;
+    faces.reserve(level.faces);
+    keys.reserve(level.faces);
+    for (const Face& face : input.getFaces()) {
+        const uint32_t v1 = level.leafToCell[toLeaf[face.v1]];
+        const uint32_t v2 = level.leafToCell[toLeaf[face.v2]];
+        const uint32_t v3 = level.leafToCell[toLeaf[face.v3]];
+        if (v1 != v2 && v2 != v3 && v3 != v1) {
+            faces.emplace_back(v1, v2, v3);
+            keys.push_back(FaceDeduplicator::key(v1, v2, v3));
+        }
+    }
+    FaceDeduplicator().removeDuplicates(faces, keys, threadCount);
+
+    mesh.setPositionLayout(input.getPositionLayout());
+    mesh.setVertices(level.positions);
+    mesh.setFaces(std::move(faces));
+    return mesh;
+}
+
+void GridSearch::fill(Result& result, int candidate) const {
+    result.candidate = candidate;
+    result.gridSize = candidates[candidate].gridSize;
+    result.vertices = candidates[candidate].positions.size();
+    result.faces = candidates[candidate].faces;
+}
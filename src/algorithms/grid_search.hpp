@@ -0,0 +1,79 @@
+#pragma once
+#include "../mesh/mesh.hpp"
+#include "mesh_error.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Picks the VertexClustering grid size that meets a face budget or an
+// error bound, without running simplify once per guess.
+//
+// Candidate grids form four ladders, m * 2^k for m = 4..7, which puts
+// about five candidates in every doubling of the grid size. Each ladder
+// quantizes the vertices once at its finest grid and derives the coarser
+// ones with CellAccumulator::coarsen, so all candidates cost four passes
+// over the vertices. Each grid's face count is then taken over the faces
+// the next finer grid kept, with degenerate and duplicate faces dropped as
+// extract does, so the counts are exact. A candidate's mesh equals
+// VertexClustering at the same grid size, up to float rounding at cell
+// boundaries.
+//
+// forFaceCount only reads the counts. forMaxError bisects the candidates
+// by symmetric Hausdorff distance (see MeshError), building and measuring
+// one mesh per probe; it assumes the error shrinks as the grid grows,
+// which holds for all but near-equal neighbours.
+class GridSearch {
+public:
+    static constexpr int kMinGridSize = 4;
+    static constexpr int kMaxGridSize = 256;
+
+    struct Result {
+        int candidate = -1;      // Index for extract()
+        int gridSize = 0;
+        size_t vertices = 0;
+        size_t faces = 0;
+        double error = -1.0;     // Symmetric Hausdorff distance; negative if not measured
+        bool met = false;        // False when no candidate meets the target
+        int evaluations = 0;     // Meshes built and measured by this search
+        double seconds = 0.0;
+    };
+
+    // Builds every candidate between the two grid sizes; the input mesh
+    // must outlive this object. 0 threads uses one per hardware thread.
+    explicit GridSearch(const Mesh& inputMesh, int minGridSize = kMinGridSize,
+                        int maxGridSize = kMaxGridSize, unsigned threadCount = 0);
+
+    // Largest grid whose mesh has at most targetFaces faces; falls back to
+    // the coarsest grid
+    bool forFaceCount(size_t targetFaces, Result& result) const;
+
+    // Smallest grid whose mesh is within maxError (in mesh units) of the
+    // input; falls back to the finest grid
+    bool forMaxError(double maxError, Result& result);
+
+    int candidateCount() const { return static_cast<int>(candidates.size()); }
+    int gridSizeOf(int candidate) const { return candidates[candidate].gridSize; }
+    size_t vertexCount(int candidate) const { return candidates[candidate].positions.size(); }
+    size_t faceCount(int candidate) const { return candidates[candidate].faces; }
+
+    // Simplified mesh of a candidate
+    Mesh extract(int candidate) const;
+
+private:
+    struct Candidate {
+        int gridSize = 0;
+        int ladder = 0;
+        std::vector<Vector3> positions;   // One representative per occupied cell
+        std::vector<uint32_t> leafToCell; // Finest cell of the ladder -> cell here
+        size_t faces = 0;
+    };
+
+    const Mesh& input;
+    unsigned threadCount;
+    std::vector<Candidate> candidates;                 // Ascending grid size
+    std::vector<std::vector<uint32_t>> vertexToLeaf;   // Per ladder
+    std::unique_ptr<MeshError> error;                  // Built on first forMaxError
+
+    void fill(Result& result, int candidate) const;
+};
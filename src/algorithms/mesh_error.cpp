@@ -0,0 +1,178 @@
+#include "mesh_error.hpp"
+#include "../utils/parallel.hpp"
+#include "../utils/trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// Faces or vertices per partial sum. Queries are much dearer than
+// clustering work, so small blocks pay off; the size is fixed so the sums,
+// and their rounding, do not depend on the thread count.
+const size_t kBlock = 4096;
+
+// Running sums for one chunk of samples
+struct Partial {
+    size_t count = 0;
+    double sum = 0.0;
+    double sumSquares = 0.0;
+    double max = 0.0;
+
+    void add(double distance) {
+        count++;
+        sum += distance;
+        sumSquares += distance * distance;
+        max = std::max(max, distance);
+    }
+};
+
+inline uint64_t mix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Uniformly distributed point of triangle abc for sample k of face f
+Vector3 samplePoint(const Vector3& a, const Vector3& b, const Vector3& c, uint32_t f, uint32_t k) {
+    const uint64_t h = mix((uint64_t(f) << 32) | k);
+    float u = static_cast<float>(h >> 40) * (1.0f / 16777216.0f);
+    float v = static_cast<float>((h >> 16) & 0xFFFFFF) * (1.0f / 16777216.0f);
+    if (u + v > 1.0f) {
+        u = 1.0f - u;
+        v = 1.0f - v;
+    }
+    return Vector3(a.x + u * (b.x - a.x) + v * (c.x - a.x),
+                   a.y + u * (b.y - a.y) + v * (c.y - a.y),
+                   a.z + u * (b.z - a.z) + v * (c.z - a.z));
+}
+
+double triangleArea(const Vector3& a, const Vector3& b, const Vector3& c) {
+    const double ux = b.x - a.x, uy = b.y - a.y, uz = b.z - a.z;
+    const double vx = c.x - a.x, vy = c.y - a.y, vz = c.z - a.z;
+    const double nx = uy * vz - uz * vy, ny = uz * vx - ux * vz, nz = ux * vy - uy * vx;
+    return 0.5 * std::sqrt(nx * nx + ny * ny + nz * nz);
+}
+
+MeshError::Distances combine(const std::vector<Partial>& partials) {
+    Partial total;
+    for (const Partial& partial : partials) {
+        total.count += partial.count;
+        total.sum += partial.sum;
+        total.sumSquares += partial.sumSquares;
+        total.max = std::max(total.max, partial.max);
+    }
+    MeshError::Distances distances;
+    distances.samples = total.count;
+    distances.max = total.max;
+    if (total.count > 0) {
+        distances.mean = total.sum / total.count;
+        distances.rms = std::sqrt(total.sumSquares / total.count);
+    }
+    return distances;
+}
+
+} // namespace
+
+MeshError::MeshError(const Mesh& reference, unsigned threadCount)
+    : reference(reference), referenceTree(reference.getVertices(), reference.getFaces()),
+      threadCount(threadCount) {}
+
+MeshError::Distances MeshError::measure(const Mesh& from, const TriangleBVH& to, size_t areaSamples) const {
+    const auto& vertices = from.getVertices();
+    const auto& faces = from.getFaces();
+    const unsigned threads = Parallel::resolveThreadCount(threadCount);
+
+    // Face f gets the samples between its area prefix and the next one
+    std::vector<double> areaPrefix(faces.size() + 1, 0.0);
+    for (size_t f = 0; f < faces.size(); f++) {
+        areaPrefix[f + 1] = areaPrefix[f] +
+            triangleArea(vertices[faces[f].v1], vertices[faces[f].v2], vertices[faces[f].v3]);
+    }
+    const double totalArea = areaPrefix.back();
+    const double samplesPerArea = totalArea > 0.0 ? areaSamples / totalArea : 0.0;
+    auto samplesBefore = [&](size_t f) {
+        return static_cast<uint64_t>(std::floor(areaPrefix[f] * samplesPerArea));
+    };
+
+    // Vertices no face uses are not part of the surface
+    std::vector<char> onSurface(vertices.size(), 0);
+    for (const Face& face : faces) {
+        onSurface[face.v1] = onSurface[face.v2] = onSurface[face.v3] = 1;
+    }
+
+    // Threads take runs of whole blocks; partials are combined in block order
+    const size_t faceBlocks = (faces.size() + kBlock - 1) / kBlock;
+    const size_t vertexBlocks = (vertices.size() + kBlock - 1) / kBlock;
+    std::vector<Partial> partials(faceBlocks + vertexBlocks);
+
+    Parallel::forChunks(faceBlocks, Parallel::chunkCount(faceBlocks, threads, 1),
+        [&](unsigned, size_t firstBlock, size_t lastBlock) {
+            uint32_t hint = TriangleBVH::kNone;
+            for (size_t block = firstBlock; block < lastBlock; block++) {
+                Partial& partial = partials[block];
+                const size_t end = std::min(faces.size(), (block + 1) * kBlock);
+                for (size_t f = block * kBlock; f < end; f++) {
+                    const uint64_t count = samplesBefore(f + 1) - samplesBefore(f);
+                    const Face& face = faces[f];
+                    for (uint64_t k = 0; k < count; k++) {
+                        const Vector3 p = samplePoint(vertices[face.v1], vertices[face.v2], vertices[face.v3],
+                                                      static_cast<uint32_t>(f), static_cast<uint32_t>(k));
+                        const TriangleBVH::Hit hit = to.closest(p, hint);
+                        hint = hit.slot;
+                        partial.add(std::sqrt(static_cast<double>(hit.distanceSquared)));
+                    }
+                }
+            }
+        });
+
+    Parallel::forChunks(vertexBlocks, Parallel::chunkCount(vertexBlocks, threads, 1),
+        [&](unsigned, size_t firstBlock, size_t lastBlock) {
+            uint32_t hint = TriangleBVH::kNone;
+            for (size_t block = firstBlock; block < lastBlock; block++) {
+                Partial& partial = partials[faceBlocks + block];
+                const size_t end = std::min(vertices.size(), (block + 1) * kBlock);
+                for (size_t i = block * kBlock; i < end; i++) {
+                    if (!onSurface[i]) continue;
+                    const TriangleBVH::Hit hit = to.closest(vertices[i], hint);
+                    hint = hit.slot;
+                    partial.add(std::sqrt(static_cast<double>(hit.distanceSquared)));
+                }
+            }
+        });
+
+    return combine(partials);
+}
+
+bool MeshError::evaluate(const Mesh& simplified, Result& result) const {
+    if (reference.getFaceCount() == 0 || simplified.getFaceCount() == 0) return false;
+    Trace::Scope trace("MeshError::evaluate");
+    auto startTime = std::chrono::steady_clock::now();
+
+    const size_t areaSamples = sampleCount > 0 ? sampleCount : reference.getFaceCount();
+    const TriangleBVH simplifiedTree(simplified.getVertices(), simplified.getFaces());
+
+    result = Result();
+    result.forward = measure(simplified, referenceTree, areaSamples);
+    result.backward = measure(reference, simplifiedTree, areaSamples);
+
+    const Distances& f = result.forward;
+    const Distances& b = result.backward;
+    Distances& both = result.symmetric;
+    both.samples = f.samples + b.samples;
+    both.max = std::max(f.max, b.max);
+    if (both.samples > 0) {
+        both.mean = (f.mean * f.samples + b.mean * b.samples) / both.samples;
+        both.rms = std::sqrt((f.rms * f.rms * f.samples + b.rms * b.rms * b.samples) / both.samples);
+    }
+
+    Vector3 min, max;
+    reference.getBoundingBox(min, max);
+    const double dx = max.x - min.x, dy = max.y - min.y, dz = max.z - min.z;
+    result.diagonal = std::sqrt(dx * dx + dy * dy + dz * dz);
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    Trace::count("error_samples", static_cast<int64_t>(both.samples));
+    return true;
+}
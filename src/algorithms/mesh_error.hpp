@@ -0,0 +1,59 @@
+#pragma once
+#include "../mesh/mesh.hpp"
+#include "triangle_bvh.hpp"
+#include <cstddef>
+#include <cstdint>
+
+// Geometric error of a simplified mesh against its reference, in the
+// spirit of Metro.
+//
+// Points are sampled on one surface and their distance to the closest
+// point of the other surface is measured through a TriangleBVH. This runs
+// in both directions: simplified to reference catches surface that moved
+// away, reference to simplified catches detail that was lost. Each side is
+// sampled at the vertices its faces use plus a fixed number of points
+// spread over its faces in proportion to their area, with positions drawn
+// from a hash of the face and sample index. Samples are visited in face
+// order and every query starts from the previous hit, so lookups stay
+// cheap. Sums are kept per fixed-size block of faces or vertices and added
+// in block order, so the figures do not depend on the thread count.
+//
+// The reference BVH is built once, so evaluating several simplifications
+// of the same mesh only builds the (small) tree of each simplified mesh.
+class MeshError {
+public:
+    // Distances from the samples of one surface to the other
+    struct Distances {
+        size_t samples = 0;
+        double max = 0.0;   // One-sided Hausdorff distance
+        double mean = 0.0;
+        double rms = 0.0;
+    };
+
+    struct Result {
+        Distances forward;    // Simplified surface to reference
+        Distances backward;   // Reference surface to simplified
+        Distances symmetric;  // Both sample sets together; max is the Hausdorff distance
+        double diagonal = 0.0;  // Reference bounding box diagonal, for relative figures
+        double seconds = 0.0;
+    };
+
+    // Builds the reference BVH; the reference mesh must outlive this object.
+    // 0 threads uses one per hardware thread.
+    explicit MeshError(const Mesh& reference, unsigned threadCount = 0);
+
+    // Area samples per direction on top of the vertices; 0 (the default)
+    // uses the reference face count
+    void setSampleCount(size_t samples) { sampleCount = samples; }
+
+    // Returns false if either mesh has no faces
+    bool evaluate(const Mesh& simplified, Result& result) const;
+
+private:
+    const Mesh& reference;
+    TriangleBVH referenceTree;
+    unsigned threadCount;
+    size_t sampleCount = 0;
+
+    Distances measure(const Mesh& from, const TriangleBVH& to, size_t areaSamples) const;
+};
@@ -0,0 +1,309 @@
+#include "point_cloud_simplifier.hpp"
+#include "point_kd_tree.hpp"
+#include "vertex_clustering.hpp"
+#include "../mesh/spatial_order.hpp"
+#include "../utils/parallel.hpp"
+#include "../utils/trace.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+// Points per thread below which a pass stays on one thread
+const size_t kMinChunk = 16384;
+
+// Largest voxel grid per axis; smaller voxels are widened to fit
+const int kMaxVoxelGrid = 1 << 20;
+
+// Surface area estimate: points sampled, and the neighbour whose distance
+// gives each one's local density
+const size_t kAreaSamples = 4096;
+const size_t kAreaNeighbour = 8;
+
+const double kPi = 3.14159265358979323846;
+
+// Falloff exponent of the sample elimination weight, from Yuksel 2015
+const int kWeightExponent = 8;
+
+// Max-heap of points by weight, for weights that only go down. Entries keep
+// the weight a point had when it was last placed, an upper bound on its
+// current one, so lowering a weight costs nothing: the top entry is checked
+// when popped and, if stale, sifted down with its current weight instead.
+class WeightHeap {
+public:
+    explicit WeightHeap(const std::vector<float>& weights) : weights(weights), heap(weights.size()) {
+        for (size_t i = 0; i < heap.size(); i++) heap[i] = {weights[i], static_cast<uint32_t>(i)};
+        for (size_t i = heap.size() / 2; i-- > 0;) siftDown(i);
+    }
+
+    size_t size() const { return heap.size(); }
+
+    // Removes and returns the point with the largest current weight
+    uint32_t pop() {
+        while (heap[0].weight != weights[heap[0].point]) {
+            heap[0].weight = weights[heap[0].point];
+            siftDown(0);
+        }
+        const uint32_t top = heap[0].point;
+        heap[0] = heap.back();
+        heap.pop_back();
+        if (!heap.empty()) siftDown(0);
+        return top;
+    }
+
+private:
+    struct Entry {
+        float weight;
+        uint32_t point;
+    };
+
+    const std::vector<float>& weights;
+    std::vector<Entry> heap;
+
+    // Heavier first; ties go to the later point so the result is deterministic
+    static bool before(const Entry& a, const Entry& b) {
+        return a.weight > b.weight || (a.weight == b.weight && a.point > b.point);
+    }
+
+    void siftDown(size_t slot) {
+        const Entry entry = heap[slot];
+        for (;;) {
+            size_t child = 2 * slot + 1;
+            if (child >= heap.size()) break;
+            if (child + 1 < heap.size() && before(heap[child + 1], heap[child])) child++;
+            if (!before(heap[child], entry)) break;
+            heap[slot] = heap[child];
+            slot = child;
+        }
+        heap[slot] = entry;
+    }
+};
+
+// Unit eigenvector for the smallest eigenvalue of a symmetric 3x3 matrix,
+// by cyclic Jacobi rotations. a is overwritten.
+Vector3 smallestEigenvector(double a[3][3]) {
+    double v[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+    const double scale = std::abs(a[0][0]) + std::abs(a[1][1]) + std::abs(a[2][2]);
+    for (int sweep = 0; sweep < 16; sweep++) {
+        const double off = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+        if (off <= 1e-24 * scale * scale) break;
+        for (int p = 0; p < 2; p++) {
+            for (int q = p + 1; q < 3; q++) {
+                if (a[p][q] == 0.0) continue;
+                const double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+                const double t = (theta >= 0.0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+                const double c = 1.0 / std::sqrt(t * t + 1.0);
+                const double s = t * c;
+                for (int k = 0; k < 3; k++) {
+                    const double kp = a[k][p], kq = a[k][q];
+                    a[k][p] = c * kp - s * kq;
+                    a[k][q] = s * kp + c * kq;
+                }
+                for (int k = 0; k < 3; k++) {
+                    const double pk = a[p][k], qk = a[q][k];
+                    a[p][k] = c * pk - s * qk;
+                    a[q][k] = s * pk + c * qk;
+                }
+                for (int k = 0; k < 3; k++) {
+                    const double kp = v[k][p], kq = v[k][q];
+                    v[k][p] = c * kp - s * kq;
+                    v[k][q] = s * kp + c * kq;
+                }
+            }
+        }
+    }
+
+    int smallest = 0;
+    if (a[1][1] < a[smallest][smallest]) smallest = 1;
+    if (a[2][2] < a[smallest][smallest]) smallest = 2;
+    return Vector3(static_cast<float>(v[0][smallest]), static_cast<float>(v[1][smallest]),
+                   static_cast<float>(v[2][smallest]));
+}
+
+} // namespace
+
+Mesh PointCloudSimplifier::voxelDownsample(const Mesh& cloud, float voxelSize) {
+    Trace::Scope trace("PointCloudSimplifier::voxelDownsample");
+    Mesh points;
+    if (cloud.getVertices().empty() || !(voxelSize > 0.0f)) {
+        points.setVertices(cloud.getVertices());
+        return points;
+    }
+
+    // Cubic cells need the same grid box extent on every axis
+    Vector3 min, max;
+    cloud.getBoundingBox(min, max);
+    const float extent = std::max({max.x - min.x, max.y - min.y, max.z - min.z});
+    const int gridSize = static_cast<int>(std::min<double>(std::floor(extent / voxelSize) + 1.0, kMaxVoxelGrid));
+    const float side = std::max(voxelSize, extent / gridSize);
+    const Vector3 boxMax(min.x + side * gridSize, min.y + side * gridSize, min.z + side * gridSize);
+
+    VertexClustering clustering(gridSize);
+    clustering.setThreadCount(threadCount);
+    clustering.setBoundingBox(min, boxMax);
+
+    // Only the positions are clustered; any faces are left behind
+    if (cloud.getFaceCount() == 0) return clustering.simplify(cloud);
+    Mesh positions;
+    positions.setVertices(cloud.getVertices());
+    return clustering.simplify(positions);
+}
+
+Mesh PointCloudSimplifier::poissonSubsample(const Mesh& cloud, size_t targetCount) {
+    Trace::Scope trace("PointCloudSimplifier::poissonSubsample");
+    const auto& points = cloud.getVertices();
+    Mesh kept;
+    poissonRadius = 0.0f;
+    if (points.size() <= targetCount) {
+        kept.setVertices(points);
+        return kept;
+    }
+    if (targetCount == 0) return kept;
+
+    // Work along a Morton curve so that a point's neighbours, and the
+    // weights they update, sit close together in memory
+    const unsigned threads = Parallel::resolveThreadCount(threadCount);
+    Vector3 min, max;
+    cloud.getBoundingBox(min, max);
+    std::vector<uint32_t> order;
+    SpatialOrder::curveOrder(points, min, max, order, threads);
+    std::vector<Vector3> sorted(points.size());
+    for (size_t i = 0; i < points.size(); i++) sorted[i] = points[order[i]];
+    PointKdTree tree(sorted, threads);
+
+    // Surface area from local densities: k neighbours within distance d
+    // cover about pi d^2 / k of surface each. The median share is used, as
+    // a few stray points far from the surface would swamp a mean.
+    Trace::Scope area("PointCloudSimplifier::estimateArea");
+    const size_t samples = std::min(kAreaSamples, points.size());
+    const size_t k = std::min(kAreaNeighbour + 1, points.size());  // Includes the point itself
+    std::vector<double> shares(samples);
+    {
+        uint32_t indices[kAreaNeighbour + 1];
+        float distances[kAreaNeighbour + 1];
+        for (size_t s = 0; s < samples; s++) {
+            const size_t found = tree.nearest(sorted[s * points.size() / samples], k, indices, distances);
+            shares[s] = kPi * distances[found - 1] / (found - 1);
+        }
+    }
+    std::nth_element(shares.begin(), shares.begin() + samples / 2, shares.end());
+    const double surfaceArea = shares[samples / 2] * points.size();
+    area.close();
+
+    // Disk radius for a hexagonal packing of the target count. The paper's
+    // weight limiting (a floor on distances, set from rmax) is left out:
+    // on noisy scans the area and so rmax come out high, the floor then
+    // reaches the final spacing and close pairs stop standing out.
+    const float rmax = static_cast<float>(std::sqrt(surfaceArea / (2.0 * std::sqrt(3.0) * targetCount)));
+    const float reach = 2.0f * rmax;
+    poissonRadius = rmax;
+    auto weightOf = [reach](float distanceSquared) {
+        const float t = 1.0f - std::sqrt(distanceSquared) / reach;
+        float w = 1.0f;
+        for (int e = 0; e < kWeightExponent; e++) w *= t;
+        return w;
+    };
+
+    Trace::Scope weigh("PointCloudSimplifier::weigh");
+    std::vector<float> weights(points.size(), 0.0f);
+    Parallel::forChunks(points.size(), Parallel::chunkCount(points.size(), threads, kMinChunk),
+        [&](unsigned, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                float w = 0.0f;
+                tree.forEachWithin(sorted[i], reach, [&](uint32_t j, float d) {
+                    if (j != i) w += weightOf(d);
+                });
+                weights[i] = w;
+            }
+        });
+    weigh.close();
+
+    // Remove the most crowded point until the target remains
+    Trace::Scope eliminate("PointCloudSimplifier::eliminate");
+    std::vector<uint8_t> alive(points.size(), 1);
+    WeightHeap heap(weights);
+    while (heap.size() > targetCount) {
+        const uint32_t removed = heap.pop();
+        alive[removed] = 0;
+        tree.forEachWithin(sorted[removed], reach, [&](uint32_t j, float d) {
+            if (alive[j]) weights[j] -= weightOf(d);
+        });
+    }
+    eliminate.close();
+
+    std::vector<uint8_t> keep(points.size(), 0);
+    for (size_t i = 0; i < points.size(); i++) keep[order[i]] = alive[i];
+    std::vector<Vector3> survivors;
+    survivors.reserve(targetCount);
+    for (size_t i = 0; i < points.size(); i++) {
+        if (keep[i]) survivors.push_back(points[i]);
+    }
+    kept.setVertices(std::move(survivors));
+
+    Trace::count("input_points", static_cast<int64_t>(points.size()));
+    Trace::count("output_points", static_cast<int64_t>(kept.getVertexCount()));
+    Trace::gauge("poisson_radius", rmax);
+    Trace::sampleMemory();
+    return kept;
+}
+
+std::vector<Vector3> PointCloudSimplifier::estimateNormals(const Mesh& cloud, int neighbours) {
+    Trace::Scope trace("PointCloudSimplifier::estimateNormals");
+    const auto& points = cloud.getVertices();
+    std::vector<Vector3> normals(points.size(), Vector3(0.0f, 0.0f, 1.0f));
+    if (points.size() < 3) return normals;
+
+    const unsigned threads = Parallel::resolveThreadCount(threadCount);
+    const unsigned chunks = Parallel::chunkCount(points.size(), threads, kMinChunk);
+    PointKdTree tree(points, threads);
+
+    double center[3] = {0.0, 0.0, 0.0};
+    for (const Vector3& p : points) {
+        center[0] += p.x;
+        center[1] += p.y;
+        center[2] += p.z;
+    }
+    for (double& c : center) c /= points.size();
+
+    const size_t k = std::min<size_t>(std::max(neighbours, 3), points.size());
+    Parallel::forChunks(points.size(), chunks,
+        [&](unsigned, size_t begin, size_t end) {
+            std::vector<uint32_t> indices(k);
+            std::vector<float> distances(k);
+            for (size_t i = begin; i < end; i++) {
+                const size_t found = tree.nearest(points[i], k, indices.data(), distances.data());
+
+                // Covariance about the neighbours' mean
+                double mean[3] = {0.0, 0.0, 0.0};
+                for (size_t n = 0; n < found; n++) {
+                    const Vector3& p = points[indices[n]];
+                    mean[0] += p.x;
+                    mean[1] += p.y;
+                    mean[2] += p.z;
+                }
+                for (double& m : mean) m /= found;
+                double covariance[3][3] = {};
+                for (size_t n = 0; n < found; n++) {
+                    const Vector3& p = points[indices[n]];
+                    const double d[3] = {p.x - mean[0], p.y - mean[1], p.z - mean[2]};
+                    for (int r = 0; r < 3; r++) {
+                        for (int c = r; c < 3; c++) covariance[r][c] += d[r] * d[c];
+                    }
+                }
+                covariance[1][0] = covariance[0][1];
+                covariance[2][0] = covariance[0][2];
+                covariance[2][1] = covariance[1][2];
+
+                Vector3 normal = smallestEigenvector(covariance);
+                const double outward = (points[i].x - center[0]) * normal.x +
+                                       (points[i].y - center[1]) * normal.y +
+                                       (points[i].z - center[2]) * normal.z;
+                if (outward < 0.0) normal = Vector3(-normal.x, -normal.y, -normal.z);
+                normals[i] = normal;
+            }
+        });
+
+    Trace::count("normals", static_cast<int64_t>(normals.size()));
+    return normals;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "../mesh/mesh.hpp"
+#include <vector>
+
+// Thinning and normal estimation for point clouds such as merged range
+// scans (see ScanSet), ahead of surface reconstruction. Inputs are meshes
+// whose faces, if any, are ignored; the meshes returned have none.
+//
+// voxelDownsample replaces the points in each cube of a given edge by their
+// mean. It runs VertexClustering over a grid of cubic cells anchored at the
+// cloud's minimum corner, so it is parallel, its output does not depend on
+// the thread count, and it needs no tree: a point finds its voxel directly.
+//
+// poissonSubsample keeps a given number of points spread as evenly as the
+// input allows, by weighted sample elimination (Yuksel 2015). Every point
+// is weighted by how crowded its neighbourhood within 2 * rmax is, and the
+// most crowded point is removed, with its neighbours' weights lowered, until
+// the target count remains. rmax is the disk radius that would pack the
+// target count onto the surface; the surface area comes from the distances
+// to the k-th nearest neighbour of a sample of points.
+//
+// estimateNormals fits a plane to each point's nearest neighbours: the
+// normal is the eigenvector of their covariance with the smallest
+// eigenvalue. The sign is chosen to point away from the cloud's centroid,
+// which is right for closed, roughly convex objects such as the scans here.
+//
+// poissonSubsample and estimateNormals find neighbours through a PointKdTree
+// built over the positions.
+class PointCloudSimplifier {
+public:
+    static constexpr int kDefaultNeighbours = 16;
+
+    // 0 threads uses one per hardware thread
+    void setThreadCount(unsigned threads) { threadCount = threads; }
+
+    Mesh voxelDownsample(const Mesh& cloud, float voxelSize);
+    // Inputs of at most targetCount points are returned unchanged. The kept
+    // points stay in input order.
+    Mesh poissonSubsample(const Mesh& cloud, size_t targetCount);
+    // One unit normal per point
+    std::vector<Vector3> estimateNormals(const Mesh& cloud, int neighbours = kDefaultNeighbours);
+
+    // Disk radius rmax used by the last poissonSubsample
+    float getPoissonRadius() const { return poissonRadius; }
+
+private:
+    unsigned threadCount = 0;
+    float poissonRadius = 0.0f;
+};
@@ -0,0 +1,144 @@
+#include "point_kd_tree.hpp"
+#include "../utils/parallel.hpp"
+#include "../utils/trace.hpp"
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace {
+
+// Points copied per thread below this are not worth splitting
+const size_t kMinChunk = 65536;
+
+// Subtrees handed out per build thread, so uneven ones even out
+const size_t kSubtreesPerThread = 4;
+
+} // namespace
+
+// Best k so far, sorted by distance, in the caller's arrays
+struct PointKdTree::Candidates {
+    uint32_t* indices;
+    float* distances;
+    size_t capacity;
+    size_t count = 0;
+
+    float worst() const {
+        return count < capacity ? std::numeric_limits<float>::infinity() : distances[count - 1];
+    }
+
+    void offer(uint32_t index, float distance) {
+        if (distance >= worst()) return;
+        size_t slot = count < capacity ? count++ : count - 1;
+        while (slot > 0 && distances[slot - 1] > distance) {
+            distances[slot] = distances[slot - 1];
+            indices[slot] = indices[slot - 1];
+            slot--;
+        }
+        distances[slot] = distance;
+        indices[slot] = index;
+    }
+};
+
+PointKdTree::PointKdTree(const std::vector<Vector3>& points, unsigned threadCount) {
+    Trace::Scope trace("PointKdTree::build");
+    const unsigned threads = Parallel::resolveThreadCount(threadCount);
+
+    entries.resize(points.size());
+    axes.assign(points.size(), 0);
+    Parallel::forChunks(points.size(), Parallel::chunkCount(points.size(), threads, kMinChunk),
+        [&](unsigned, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                entries[i] = {{points[i].x, points[i].y, points[i].z}, static_cast<uint32_t>(i)};
+            }
+        });
+
+    // Split the top levels here until there are enough subtrees to share out
+    std::vector<std::pair<size_t, size_t>> subtrees{{0, entries.size()}};
+    if (threads > 1) {
+        std::vector<std::pair<size_t, size_t>> next;
+        while (subtrees.size() < threads * kSubtreesPerThread && subtrees[0].second - subtrees[0].first > kMinChunk) {
+            next.clear();
+            for (const auto& range : subtrees) {
+                const size_t mid = split(range.first, range.second);
+                next.emplace_back(range.first, mid);
+                next.emplace_back(mid + 1, range.second);
+            }
+            subtrees.swap(next);
+        }
+    }
+
+    Parallel::forChunks(subtrees.size(), Parallel::chunkCount(subtrees.size(), threads, 1),
+        [&](unsigned, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) build(subtrees[i].first, subtrees[i].second);
+        });
+    Trace::count("kd_points", static_cast<int64_t>(entries.size()));
+}
+
+// Partitions a node's range around the median of its widest axis and
+// returns the middle slot
+size_t PointKdTree::split(size_t begin, size_t end) {
+    float min[3] = {entries[begin].p[0], entries[begin].p[1], entries[begin].p[2]};
+    float max[3] = {min[0], min[1], min[2]};
+    for (size_t i = begin + 1; i < end; i++) {
+        for (int a = 0; a < 3; a++) {
+            min[a] = std::min(min[a], entries[i].p[a]);
+            max[a] = std::max(max[a], entries[i].p[a]);
+        }
+    }
+    int axis = 0;
+    if (max[1] - min[1] > max[axis] - min[axis]) axis = 1;
+    if (max[2] - min[2] > max[axis] - min[axis]) axis = 2;
+
+    const size_t mid = begin + (end - begin) / 2;
+    std::nth_element(entries.begin() + begin, entries.begin() + mid, entries.begin() + end,
+                     [axis](const Entry& a, const Entry& b) { return a.p[axis] < b.p[axis]; });
+    axes[mid] = static_cast<uint8_t>(axis);
+    return mid;
+}
+
+void PointKdTree::build(size_t begin, size_t end) {
+    while (end - begin > kLeafSize) {
+        const size_t mid = split(begin, end);
+        build(begin, mid);
+        begin = mid + 1;
+    }
+}
+
+size_t PointKdTree::nearest(const Vector3& query, size_t k, uint32_t* indices, float* distancesSquared) const {
+    Candidates best{indices, distancesSquared, k};
+    if (k == 0 || entries.empty()) return 0;
+    const float q[3] = {query.x, query.y, query.z};
+    nearestIn(0, entries.size(), q, best);
+    return best.count;
+}
+
+void PointKdTree::nearestIn(size_t begin, size_t end, const float q[3], Candidates& best) const {
+    auto offer = [&](const Entry& e) {
+        const float dx = e.p[0] - q[0], dy = e.p[1] - q[1], dz = e.p[2] - q[2];
+        best.offer(e.index, dx * dx + dy * dy + dz * dz);
+    };
+
+    if (end - begin <= kLeafSize) {
+        for (size_t i = begin; i < end; i++) offer(entries[i]);
+        return;
+    }
+
+    const size_t mid = begin + (end - begin) / 2;
+    const Entry& pivot = entries[mid];
+    offer(pivot);
+    const float diff = q[axes[mid]] - pivot.p[axes[mid]];
+
+    // Near side first; the far side only if the split plane is closer than
+    // the current k-th neighbour
+    if (diff < 0.0f) {
+        nearestIn(begin, mid, q, best);
+        if (diff * diff < best.worst()) nearestIn(mid + 1, end, q, best);
+    } else {
+        nearestIn(mid + 1, end, q, best);
+        if (diff * diff < best.worst()) nearestIn(begin, mid, q, best);
+    }
+}
+
+size_t PointKdTree::memoryBytes() const {
+    return entries.capacity() * sizeof(Entry) + axes.capacity();
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include "../mesh/mesh.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Implicit kd-tree over a point set, for nearest-neighbour and radius queries.
+//
+// The points are copied once into tree order and no nodes are stored: a
+// range [begin, end) of that array is a node whose splitting point sits at
+// mid = begin + (end - begin) / 2, with its subtrees in [begin, mid) and
+// [mid + 1, end). Ranges of kLeafSize points or fewer are leaves and are
+// scanned directly. Each range is split at the median of its widest axis
+// with nth_element, linear per level, so building takes O(n log n); the top
+// levels are split on the calling thread and the subtrees below them are
+// built in parallel. A point costs 16 bytes (position and source index)
+// plus one byte for its split axis, and a query walks one contiguous array.
+// The tree is read-only once built and safe to query from any number of
+// threads.
+class PointKdTree {
+public:
+    static constexpr size_t kLeafSize = 8;
+
+    // 0 threads uses one per hardware thread
+    explicit PointKdTree(const std::vector<Vector3>& points, unsigned threadCount = 0);
+
+    // The k points nearest to query, closest first, as source indices and
+    // squared distances. Returns how many were written, which is less than
+    // k only when the tree holds fewer points. A point equal to query counts.
+    size_t nearest(const Vector3& query, size_t k, uint32_t* indices, float* distancesSquared) const;
+
+    // Calls fn(index, distanceSquared) for every point strictly within
+    // radius of query, in no particular order
+    template <typename F>
+    void forEachWithin(const Vector3& query, float radius, F&& fn) const;
+
+    size_t size() const { return entries.size(); }
+    size_t memoryBytes() const;
+
+private:
+    struct Entry {
+        float p[3];
+        uint32_t index;  // Position in the source array
+    };
+
+    struct Candidates;
+
+    std::vector<Entry> entries;  // Tree order
+    std::vector<uint8_t> axes;   // Split axis of the node whose middle is at each slot
+
+    size_t split(size_t begin, size_t end);
+    void build(size_t begin, size_t end);
+    void nearestIn(size_t begin, size_t end, const float q[3], Candidates& best) const;
+};
+
+template <typename F>
+void PointKdTree::forEachWithin(const Vector3& query, float radius, F&& fn) const {
+    const float q[3] = {query.x, query.y, query.z};
+    const float radiusSquared = radius * radius;
+    auto visit = [&](const Entry& e) {
+        const float dx = e.p[0] - q[0], dy = e.p[1] - q[1], dz = e.p[2] - q[2];
+        const float d = dx * dx + dy * dy + dz * dz;
+        if (d < radiusSquared) fn(e.index, d);
+    };
+
+    // Ranges still to visit; the tree is at most 32 levels deep and each
+    // level leaves at most one sibling behind
+    size_t stack[2 * 64];
+    int top = 0;
+    stack[top++] = 0;
+    stack[top++] = entries.size();
+    while (top > 0) {
+        size_t end = stack[--top];
+        size_t begin = stack[--top];
+        while (end - begin > kLeafSize) {
+            const size_t mid = begin + (end - begin) / 2;
+            const Entry& pivot = entries[mid];
+            visit(pivot);
+            const float diff = q[axes[mid]] - pivot.p[axes[mid]];
+            // Keep walking the side holding the query; queue the other if
+            // the sphere reaches across the split plane
+            if (diff < 0.0f) {
+                if (diff * diff < radiusSquared) {
+                    stack[top++] = mid + 1;
+                    stack[top++] = end;
+                }
+                end = mid;
+            } else {
+                if (diff * diff < radiusSquared) {
+                    stack[top++] = begin;
+                    stack[top++] = mid;
+                }
+                begin = mid + 1;
+            }
+        }
+        for (size_t i = begin; i < end; i++) visit(entries[i]);
+    }
+}
@@ -0,0 +1,523 @@
+#include "quadric_simplification.hpp"
+#include "../utils/trace.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <queue>
+#include <vector>
+
+namespace {
+
+// Boundary planes are weighted well above surface planes so open borders
+// stay in place
+const double kBoundaryWeight = 1000.0;
+
+// Collapses that turn a face normal by more than ~78 degrees are rejected
+const double kMinNormalCosine = 0.2;
+
+// Queue pops between looks at the cancel flag
+const size_t kCancelCheckInterval = 1024;
+
+// Boundary edges tried for an exact last collapse once one that overshoots
+// the target has been set aside
+const size_t kFallbackAttempts = 256;
+
+// Symmetric 4x4 matrix stored as its upper triangle:
+// a2 ab ac ad / b2 bc bd / c2 cd / d2
+struct Quadric {
+    float m[10] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+    static Quadric fromPlane(double a, double b, double c, double d, double weight) {
+        Quadric q;
+        q.m[0] = static_cast<float>(weight * a * a);
+        q.m[1] = static_cast<float>(weight * a * b);
+        q.m[2] = static_cast<float>(weight * a * c);
+        q.m[3] = static_cast<float>(weight * a * d);
+        q.m[4] = static_cast<float>(weight * b * b);
+        q.m[5] = static_cast<float>(weight * b * c);
+        q.m[6] = static_cast<float>(weight * b * d);
+        q.m[7] = static_cast<float>(weight * c * c);
+        q.m[8] = static_cast<float>(weight * c * d);
+        q.m[9] = static_cast<float>(weight * d * d);
+        return q;
+    }
+
+    void operator+=(const Quadric& other) {
+        for (int i = 0; i < 10; i++) m[i] += other.m[i];
+    }
+
+    // v^T Q v for v = (x, y, z, 1)
+    double error(double x, double y, double z) const {
+        return m[0] * x * x + 2 * m[1] * x * y + 2 * m[2] * x * z + 2 * m[3] * x
+             + m[4] * y * y + 2 * m[5] * y * z + 2 * m[6] * y
+             + m[7] * z * z + 2 * m[8] * z
+             + m[9];
+    }
+
+    // Position minimizing the error, if the 3x3 system is well conditioned
+    bool minimizer(double& x, double& y, double& z) const {
+        const double a = m[0], b = m[1], c = m[2];
+        const double e = m[4], f = m[5], i = m[7];
+        const double det = a * (e * i - f * f) - b * (b * i - f * c) + c * (b * f - e * c);
+        const double scale = std::max({std::fabs(a), std::fabs(e), std::fabs(i)});
+        if (std::fabs(det) <= 1e-12 * scale * scale * scale || scale == 0.0) return false;
+
+        const double r0 = -m[3], r1 = -m[6], r2 = -m[8];
+        x = (r0 * (e * i - f * f) - b * (r1 * i - f * r2) + c * (r1 * f - e * r2)) / det;
+        y = (a * (r1 * i - f * r2) - r0 * (b * i - f * c) + c * (b * r2 - r1 * c)) / det;
+        z = (a * (e * r2 - r1 * f) - b * (b * r2 - r1 * c) + r0 * (b * f - e * c)) / det;
+        return true;
+    }
+};
+
+struct Candidate {
+    double error;
+    uint32_t a, b;
+    uint32_t versionA, versionB;
+
+    bool operator>(const Candidate& other) const { return error > other.error; }
+};
+
+struct Vec3d {
+    double x, y, z;
+};
+
+inline Vec3d cross(const Vec3d& u, const Vec3d& v) {
+    return {u.y * v.z - u.z * v.y, u.z * v.x - u.x * v.z, u.x * v.y - u.y * v.x};
+}
+
+inline double dot(const Vec3d& u, const Vec3d& v) {
+    return u.x * v.x + u.y * v.y + u.z * v.z;
+}
+
+class EdgeCollapser {
+public:
+    EdgeCollapser(const std::vector<Vector3>& inputVertices, const std::vector<Face>& inputFaces)
+        : positions(inputVertices.size()), quadrics(inputVertices.size()),
+          version(inputVertices.size(), 0), vertexAlive(inputVertices.size(), 1),
+          mark(inputVertices.size(), 0), onBoundary(inputVertices.size(), 0),
+          refStart(inputVertices.size(), 0), refCount(inputVertices.size(), 0) {
+        for (size_t i = 0; i < inputVertices.size(); i++) {
+            positions[i] = {inputVertices[i].x, inputVertices[i].y, inputVertices[i].z};
+        }
+
+        faces.reserve(inputFaces.size());
+        for (const auto& face : inputFaces) {
+            if (face.v1 == face.v2 || face.v2 == face.v3 || face.v3 == face.v1) continue;
+            faces.push_back({face.v1, face.v2, face.v3});
+        }
+        faceAlive.assign(faces.size(), 1);
+        liveFaces = faces.size();
+
+        buildAdjacency();
+        buildQuadrics();
+    }
+
+    size_t faceCount() const { return liveFaces; }
+
+    // Pushes every unique edge of the mesh as a collapse candidate
+    void seedQueue() {
+        std::vector<uint64_t> edges;
+        edges.reserve(faces.size() * 3);
+        for (const auto& f : faces) {
+            for (int k = 0; k < 3; k++) {
+                uint32_t a = f[k], b = f[(k + 1) % 3];
+                if (a > b) std::swap(a, b);
+                edges.push_back((uint64_t(a) << 32) | b);
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        std::vector<Candidate> initial;
+        initial.reserve(edges.size());
+        for (uint64_t edge : edges) {
+            initial.push_back(makeCandidate(uint32_t(edge >> 32), uint32_t(edge & 0xFFFFFFFFu)));
+        }
+        queue = std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>>(
+            std::greater<Candidate>(), std::move(initial));
+    }
+
+    // Runs collapses until a stopping condition holds or *cancel is set;
+    // returns collapses done
+    size_t run(size_t targetFaces, double maxError, const std::atomic<bool>* cancel) {
+        size_t collapses = 0;
+        size_t steps = 0;
+
+        // A collapse that would remove more faces than are left to remove
+        // (an interior edge when one face is left) is set aside, so a
+        // cheaper boundary collapse can land exactly on the target. Only
+        // edges between boundary vertices can be one, so the search skips
+        // the rest without a link test, stops at once on a closed mesh and
+        // gives up after kFallbackAttempts boundary edges; the first
+        // collapse set aside is then used.
+        bool haveFallback = false;
+        size_t fallbackAttempts = 0;
+        Candidate fallback{};
+        Vec3d fallbackTarget{};
+
+        while (liveFaces > targetFaces && !queue.empty()) {
+            if (cancel && ++steps % kCancelCheckInterval == 0 && cancel->load(std::memory_order_relaxed)) break;
+            Candidate candidate = queue.top();
+            queue.pop();
+
+            if (!vertexAlive[candidate.a] || !vertexAlive[candidate.b] ||
+                version[candidate.a] != candidate.versionA ||
+                version[candidate.b] != candidate.versionB) {
+                continue;  // Stale entry
+            }
+            if (candidate.error > maxError) break;
+            if (haveFallback) {
+                if (boundaryVertices == 0 || fallbackAttempts == kFallbackAttempts) break;
+                if (!onBoundary[candidate.a] || !onBoundary[candidate.b]) continue;
+                fallbackAttempts++;
+            }
+
+            Vec3d target = optimalPosition(candidate.a, candidate.b);
+            size_t removed = 0;
+            if (!canCollapse(candidate.a, candidate.b, target, removed)) continue;
+            if (removed > liveFaces - targetFaces) {
+                if (!haveFallback) {
+                    fallback = candidate;
+                    fallbackTarget = target;
+                    haveFallback = true;
+                }
+                continue;
+            }
+
+            collapse(candidate.a, candidate.b, target);
+            collapses++;
+        }
+
+        const bool cancelled = cancel && cancel->load(std::memory_order_relaxed);
+        if (liveFaces > targetFaces && haveFallback && !cancelled &&
+            version[fallback.a] == fallback.versionA && version[fallback.b] == fallback.versionB) {
+            size_t removed = 0;
+            if (canCollapse(fallback.a, fallback.b, fallbackTarget, removed)) {
+                collapse(fallback.a, fallback.b, fallbackTarget);
+                collapses++;
+            }
+        }
+        return collapses;
+    }
+
+    void extract(std::vector<Vector3>& outVertices, std::vector<Face>& outFaces) const {
+        std::vector<uint32_t> remap(positions.size(), UINT32_MAX);
+        outVertices.clear();
+        outFaces.clear();
+        outFaces.reserve(liveFaces);
+
+        for (size_t f = 0; f < faces.size(); f++) {
+            if (!faceAlive[f]) continue;
+            uint32_t index[3];
+            for (int k = 0; k < 3; k++) {
+                uint32_t v = faces[f][k];
+                if (remap[v] == UINT32_MAX) {
+                    remap[v] = static_cast<uint32_t>(outVertices.size());
+                    outVertices.emplace_back(static_cast<float>(positions[v].x),
+                                             static_cast<float>(positions[v].y),
+                                             static_cast<float>(positions[v].z));
+                }
+                index[k] = remap[v];
+            }
+            outFaces.emplace_back(index[0], index[1], index[2]);
+        }
+    }
+
+private:
+    using Tri = std::array<uint32_t, 3>;
+
+    std::vector<Vec3d> positions;
+    std::vector<Quadric> quadrics;
+    std::vector<uint32_t> version;
+    std::vector<uint8_t> vertexAlive;
+    std::vector<uint32_t> mark;
+    uint32_t markId = 0;
+    std::vector<uint8_t> onBoundary;  // Vertex has an edge with one face
+    size_t boundaryVertices = 0;      // Live ones
+
+    std::vector<Tri> faces;
+    std::vector<uint8_t> faceAlive;
+    size_t liveFaces = 0;
+
+    // Vertex -> face references: refs[refStart[v] .. refStart[v] + refCount[v]).
+    // A collapse appends the merged list at the end; compact() reclaims space.
+    std::vector<uint32_t> refs;
+    std::vector<uint32_t> refStart;
+    std::vector<uint32_t> refCount;
+    size_t compactThreshold = 0;
+
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> queue;
+
+    void buildAdjacency() {
+        for (const auto& f : faces) {
+            for (uint32_t v : f) refCount[v]++;
+        }
+        uint32_t offset = 0;
+        for (size_t v = 0; v < refCount.size(); v++) {
+            refStart[v] = offset;
+            offset += refCount[v];
+        }
+        refs.resize(offset);
+        std::vector<uint32_t> fill(refStart);
+        for (uint32_t f = 0; f < faces.size(); f++) {
+            for (uint32_t v : faces[f]) refs[fill[v]++] = f;
+        }
+        compactThreshold = std::max<size_t>(refs.size() * 2, 1024);
+    }
+
+    void buildQuadrics() {
+        std::vector<uint64_t> edges;
+        edges.reserve(faces.size() * 3);
+
+        for (uint32_t f = 0; f < faces.size(); f++) {
+            const Tri& t = faces[f];
+            const Vec3d& p0 = positions[t[0]];
+            Vec3d n = faceNormal(positions[t[0]], positions[t[1]], positions[t[2]]);
+            double length = std::sqrt(dot(n, n));
+            if (length <= 0.0) continue;
+
+            // Area-weighted plane quadric
+            double area = 0.5 * length;
+            n = {n.x / length, n.y / length, n.z / length};
+            double d = -dot(n, p0);
+            Quadric q = Quadric::fromPlane(n.x, n.y, n.z, d, area);
+            for (uint32_t v : t) quadrics[v] += q;
+
+            for (int k = 0; k < 3; k++) {
+                uint32_t a = t[k], b = t[(k + 1) % 3];
+                uint64_t key = a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+                edges.push_back(key);
+            }
+        }
+
+        // Edges seen once are on the boundary: add a plane through the edge,
+        // perpendicular to its face
+        std::vector<uint64_t> sorted(edges);
+        std::sort(sorted.begin(), sorted.end());
+        for (uint32_t f = 0; f < faces.size(); f++) {
+            const Tri& t = faces[f];
+            Vec3d n = faceNormal(positions[t[0]], positions[t[1]], positions[t[2]]);
+            for (int k = 0; k < 3; k++) {
+                uint32_t a = t[k], b = t[(k + 1) % 3];
+                uint64_t key = a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+                auto range = std::equal_range(sorted.begin(), sorted.end(), key);
+                if (range.second - range.first != 1) continue;
+                for (uint32_t v : {a, b}) {
+                    if (!onBoundary[v]) boundaryVertices++;
+                    onBoundary[v] = 1;
+                }
+
+                const Vec3d& pa = positions[a];
+                const Vec3d& pb = positions[b];
+                Vec3d edge = {pb.x - pa.x, pb.y - pa.y, pb.z - pa.z};
+                Vec3d perpendicular = cross(edge, n);
+                double length = std::sqrt(dot(perpendicular, perpendicular));
+                if (length <= 0.0) continue;
+                perpendicular = {perpendicular.x / length, perpendicular.y / length, perpendicular.z / length};
+                double d = -dot(perpendicular, pa);
+                Quadric q = Quadric::fromPlane(perpendicular.x, perpendicular.y, perpendicular.z, d,
+                                               kBoundaryWeight * dot(edge, edge));
+                quadrics[a] += q;
+                quadrics[b] += q;
+            }
+        }
+    }
+
+    // Unnormalized normal; its length is twice the triangle area
+    static Vec3d faceNormal(const Vec3d& p0, const Vec3d& p1, const Vec3d& p2) {
+        Vec3d e1 = {p1.x - p0.x, p1.y - p0.y, p1.z - p0.z};
+        Vec3d e2 = {p2.x - p0.x, p2.y - p0.y, p2.z - p0.z};
+        return cross(e1, e2);
+    }
+
+    Quadric combined(uint32_t a, uint32_t b) const {
+        Quadric q = quadrics[a];
+        q += quadrics[b];
+        return q;
+    }
+
+    Vec3d optimalPosition(uint32_t a, uint32_t b) const {
+        Quadric q = combined(a, b);
+        Vec3d p;
+        if (q.minimizer(p.x, p.y, p.z)) return p;
+
+        // Singular system: best of the endpoints and the midpoint
+        const Vec3d& pa = positions[a];
+        const Vec3d& pb = positions[b];
+        Vec3d mid = {(pa.x + pb.x) * 0.5, (pa.y + pb.y) * 0.5, (pa.z + pb.z) * 0.5};
+        double ea = q.error(pa.x, pa.y, pa.z);
+        double eb = q.error(pb.x, pb.y, pb.z);
+        double em = q.error(mid.x, mid.y, mid.z);
+        if (ea <= eb && ea <= em) return pa;
+        if (eb <= em) return pb;
+        return mid;
+    }
+
+    Candidate makeCandidate(uint32_t a, uint32_t b) const {
+        Vec3d p = optimalPosition(a, b);
+        double error = std::max(0.0, combined(a, b).error(p.x, p.y, p.z));
+        return {error, a, b, version[a], version[b]};
+    }
+
+    // Rejects collapses that break manifoldness or flip a surrounding face;
+    // sharedFaces receives how many faces the collapse would remove
+    bool canCollapse(uint32_t a, uint32_t b, const Vec3d& target, size_t& sharedFaces) {
+        // Link condition: a and b may only share the vertices opposite the edge
+        markId++;
+        sharedFaces = 0;
+        forEachFace(a, [&](uint32_t f) {
+            const Tri& t = faces[f];
+            if (t[0] == b || t[1] == b || t[2] == b) sharedFaces++;
+            for (uint32_t v : t) mark[v] = markId;
+        });
+        if (sharedFaces == 0) return false;
+
+        size_t commonNeighbors = 0;
+        uint32_t countedId = ++markId;
+        forEachFace(b, [&](uint32_t f) {
+            for (uint32_t v : faces[f]) {
+                if (v != a && v != b && mark[v] == countedId - 1) {
+                    commonNeighbors++;
+                    mark[v] = countedId;
+                }
+            }
+        });
+        if (commonNeighbors != sharedFaces) return false;
+
+        return !flips(a, b, target) && !flips(b, a, target);
+    }
+
+    // Whether moving v to target flips any face of v that does not contain other
+    bool flips(uint32_t v, uint32_t other, const Vec3d& target) const {
+        bool flipped = false;
+        forEachFace(v, [&](uint32_t f) {
+            if (flipped) return;
+            const Tri& t = faces[f];
+            if (t[0] == other || t[1] == other || t[2] == other) return;
+
+            Vec3d before[3], after[3];
+            for (int k = 0; k < 3; k++) {
+                before[k] = positions[t[k]];
+                after[k] = (t[k] == v) ? target : positions[t[k]];
+            }
+            Vec3d n0 = faceNormal(before[0], before[1], before[2]);
+            Vec3d n1 = faceNormal(after[0], after[1], after[2]);
+            double l0 = std::sqrt(dot(n0, n0));
+            double l1 = std::sqrt(dot(n1, n1));
+            if (l1 <= 1e-12 * std::max(l0, 1e-30)) {
+                flipped = true;  // Collapses to a sliver
+            } else if (l0 > 0.0 && dot(n0, n1) < kMinNormalCosine * l0 * l1) {
+                flipped = true;
+            }
+        });
+        return flipped;
+    }
+
+    template <typename F>
+    void forEachFace(uint32_t v, F&& fn) const {
+        const uint32_t* begin = refs.data() + refStart[v];
+        const uint32_t* end = begin + refCount[v];
+        for (const uint32_t* it = begin; it != end; ++it) {
+            if (faceAlive[*it]) fn(*it);
+        }
+    }
+
+    void collapse(uint32_t a, uint32_t b, const Vec3d& target) {
+        positions[a] = target;
+        quadrics[a] += quadrics[b];
+        vertexAlive[b] = 0;
+        if (onBoundary[b]) {
+            if (onBoundary[a]) boundaryVertices--;
+            onBoundary[a] = 1;
+        }
+        version[a]++;
+        version[b]++;
+
+        // Merged face list for a: a's faces, then b's faces rewired to a
+        const uint32_t newStart = static_cast<uint32_t>(refs.size());
+        uint32_t newCount = 0;
+        forEachFace(a, [&](uint32_t f) {
+            Tri& t = faces[f];
+            if (t[0] == b || t[1] == b || t[2] == b) {
+                faceAlive[f] = 0;  // The faces on the collapsed edge vanish
+                liveFaces--;
+            } else {
+                refs.push_back(f);
+                newCount++;
+            }
+        });
+        forEachFace(b, [&](uint32_t f) {
+            Tri& t = faces[f];
+            for (uint32_t& v : t) {
+                if (v == b) v = a;
+            }
+            refs.push_back(f);
+            newCount++;
+        });
+        refStart[a] = newStart;
+        refCount[a] = newCount;
+        refCount[b] = 0;
+
+        // New candidates for every edge around the merged vertex
+        markId++;
+        mark[a] = markId;
+        forEachFace(a, [&](uint32_t f) {
+            for (uint32_t v : faces[f]) {
+                if (mark[v] != markId) {
+                    mark[v] = markId;
+                    queue.push(makeCandidate(a, v));
+                }
+            }
+        });
+
+        if (refs.size() > compactThreshold) compact();
+    }
+
+    // Rewrites the reference lists without the space left by earlier merges
+    void compact() {
+        std::vector<uint32_t> packed;
+        packed.reserve(liveFaces * 3);
+        for (size_t v = 0; v < refStart.size(); v++) {
+            uint32_t start = static_cast<uint32_t>(packed.size());
+            forEachFace(static_cast<uint32_t>(v), [&](uint32_t f) { packed.push_back(f); });
+            refStart[v] = start;
+            refCount[v] = static_cast<uint32_t>(packed.size()) - start;
+        }
+        refs.swap(packed);
+        compactThreshold = std::max<size_t>(refs.size() * 2, 1024);
+    }
+};
+
+} // namespace
+
+Mesh QuadricSimplifier::simplify(const Mesh& inputMesh) {
+    Trace::Scope trace("QuadricSimplifier::simplify");
+
+    EdgeCollapser collapser(inputMesh.getVertices(), inputMesh.getFaces());
+    {
+        Trace::Scope seed("QuadricSimplifier::seedQueue");
+        collapser.seedQueue();
+    }
+    Trace::Scope collapse("QuadricSimplifier::collapse");
+    size_t collapses = collapser.run(targetFaceCount, maxError, cancelFlag);
+    collapse.close();
+    if (cancelFlag && cancelFlag->load(std::memory_order_relaxed)) return Mesh();
+
+    std::vector<Vector3> newVertices;
+    std::vector<Face> newFaces;
+    collapser.extract(newVertices, newFaces);
+
+    // Create simplified mesh
+    Mesh simplifiedMesh;
+    simplifiedMesh.setVertices(std::move(newVertices));
+    simplifiedMesh.setFaces(std::move(newFaces));
+
+    Trace::count("edge_collapses", static_cast<int64_t>(collapses));
+    Trace::count("output_vertices", static_cast<int64_t>(simplifiedMesh.getVertexCount()));
+    Trace::count("output_faces", static_cast<int64_t>(simplifiedMesh.getFaceCount()));
+    Trace::sampleMemory();
+
+    return simplifiedMesh;
+}
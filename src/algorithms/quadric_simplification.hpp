@@ -0,0 +1,38 @@
+#pragma once
+#include "../mesh/mesh.hpp"
+#include <atomic>
+#include <cstddef>
+#include <limits>
+
+// Garland-Heckbert edge-collapse decimation driven by quadric error metrics.
+//
+// Each vertex carries a symmetric 4x4 quadric (10 floats) summed from the
+// planes of its faces, plus boundary-preserving planes along open edges.
+// Candidate collapses sit in a priority queue with lazy invalidation: a
+// collapse bumps the version of both endpoints and stale entries are
+// dropped when they reach the top. Adjacency is a compact vertex->face
+// reference list that grows in place as collapses merge vertices.
+class QuadricSimplifier {
+public:
+    // Collapses edges until the mesh has at most targetFaceCount faces, or the
+    // cheapest collapse would exceed maxError (sum of squared plane distances
+    // in the mesh's own units). Pass 0 faces to stop on error alone.
+    // An interior collapse removes two faces, so the last step looks for a
+    // boundary edge, trying a bounded number; a mesh without one can end at
+    // targetFaceCount - 1.
+    QuadricSimplifier(size_t targetFaceCount,
+                      double maxError = std::numeric_limits<double>::max())
+        : targetFaceCount(targetFaceCount), maxError(maxError) {}
+
+    // Once *flag becomes true, simplify stops at its next check and returns
+    // an empty mesh. The flag must outlive the call; null disables checks.
+    void setCancelFlag(const std::atomic<bool>* flag) { cancelFlag = flag; }
+
+    // Main simplification function
+    Mesh simplify(const Mesh& inputMesh);
+
+private:
+    size_t targetFaceCount;
+    double maxError;
+    const std::atomic<bool>* cancelFlag = nullptr;
+};
@@ -0,0 +1,156 @@
+#include "streaming_clustering.hpp"
+#include "face_deduplicator.hpp"
+#include "../utils/trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Output triangle with its corners sorted, so rotations and the opposite
+// winding compare equal, as in FaceDeduplicator
+struct CellTriangle {
+    uint32_t a, b, c;
+
+    CellTriangle(uint32_t v1, uint32_t v2, uint32_t v3) {
+        if (v1 > v2) std::swap(v1, v2);
+        if (v2 > v3) std::swap(v2, v3);
+        if (v1 > v2) std::swap(v1, v2);
+        a = v1;
+        b = v2;
+        c = v3;
+    }
+
+    bool operator==(const CellTriangle& other) const {
+        return a == other.a && b == other.b && c == other.c;
+    }
+};
+
+struct CellTriangleHasher {
+    size_t operator()(const CellTriangle& t) const {
+        return static_cast<size_t>(FaceDeduplicator::key(t.a, t.b, t.c));
+    }
+};
+
+} // namespace
+
+void StreamingClustering::setBoundingBox(const Vector3& min, const Vector3& max) {
+    boxMin = min;
+    boxMax = max;
+    hasBoundingBox = true;
+}
+
+bool StreamingClustering::simplify(const std::string& filename, Mesh& output) {
+    Trace::Scope trace("StreamingClustering::simplify");
+    auto startTime = std::chrono::steady_clock::now();
+    stats = Stats();
+
+    PLYStreamReader reader(windowBytes);
+    if (!reader.open(filename)) return false;
+    const size_t vertexCount = reader.vertexCount();
+    if (vertexCount == 0) {
+        output = Mesh();
+        return true;
+    }
+
+    // Faces are resolved through the cells of vertices already read, so
+    // the vertex element has to come first
+    const FileIO::PLYHeader& header = reader.getHeader();
+    const FileIO::PLYElement* vertexElement = header.findElement("vertex");
+    const FileIO::PLYElement* faceElement = header.findElement("face");
+    if (faceElement && faceElement < vertexElement) {
+        std::cerr << "Error: Face element precedes the vertex element in " << filename << std::endl;
+        return false;
+    }
+
+    // Pre-pass over the vertex element only
+    Vector3 min = boxMin, max = boxMax;
+    if (!hasBoundingBox) {
+        bool first = true;
+        bool ok = reader.read([&](const Vector3* vertices, size_t count) {
+            if (first) {
+                min = max = vertices[0];
+                first = false;
+            }
+            for (size_t i = 0; i < count; i++) {
+                min.x = std::min(min.x, vertices[i].x);
+                min.y = std::min(min.y, vertices[i].y);
+                min.z = std::min(min.z, vertices[i].z);
+                max.x = std::max(max.x, vertices[i].x);
+                max.y = std::max(max.y, vertices[i].y);
+                max.z = std::max(max.z, vertices[i].z);
+            }
+            return true;
+        }, nullptr);
+        if (!ok) return false;
+        stats.bytesRead += reader.bytesRead();
+    }
+
+    CellAccumulator cells(gridSize, min, max, denseBudgetBytes);
+    std::vector<uint32_t> vertexToCell(vertexCount);
+    std::unordered_set<CellTriangle, CellTriangleHasher> seen;
+    std::vector<Face> newFaces;
+
+    auto trackMemory = [&]() {
+        const size_t setBytes = seen.bucket_count() * sizeof(void*) +
+                                seen.size() * (sizeof(CellTriangle) + 2 * sizeof(void*));
+        const size_t bytes = vertexToCell.capacity() * sizeof(uint32_t) + cells.memoryBytes() +
+                             newFaces.capacity() * sizeof(Face) + setBytes + windowBytes;
+        stats.peakBytes = std::max(stats.peakBytes, bytes);
+    };
+
+    size_t nextVertex = 0;
+    bool ok = reader.read(
+        [&](const Vector3* vertices, size_t count) {
+            for (size_t i = 0; i < count; i++) {
+                vertexToCell[nextVertex++] = cells.add(vertices[i]);
+            }
+            trackMemory();
+            return true;
+        },
+        [&](const Face* faces, size_t count) {
+            for (size_t i = 0; i < count; i++) {
+                const uint32_t v1 = vertexToCell[faces[i].v1];
+                const uint32_t v2 = vertexToCell[faces[i].v2];
+                const uint32_t v3 = vertexToCell[faces[i].v3];
+
+                if (v1 == v2 || v2 == v3 || v3 == v1) {
+                    stats.degenerateFaces++;
+                } else if (!seen.emplace(v1, v2, v3).second) {
+                    stats.duplicateFaces++;
+                } else {
+                    newFaces.emplace_back(v1, v2, v3);
+                }
+            }
+            stats.inputFaces += count;
+            trackMemory();
+            return true;
+        });
+    if (!ok) return false;
+    stats.bytesRead += reader.bytesRead();
+    stats.inputVertices = nextVertex;
+
+    std::vector<Vector3> newVertices(cells.cellCount());
+    for (uint32_t slot = 0; slot < cells.cellCount(); slot++) {
+        newVertices[slot] = cells.average(slot);
+    }
+
+    output = Mesh();
+    output.setVertices(std::move(newVertices));
+    output.setFaces(std::move(newFaces));
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    Trace::count("bytes_read", static_cast<int64_t>(stats.bytesRead));
+    Trace::count("clustered_vertices", static_cast<int64_t>(stats.inputVertices));
+    Trace::count("degenerate_faces_dropped", static_cast<int64_t>(stats.degenerateFaces));
+    Trace::count("duplicate_faces_dropped", static_cast<int64_t>(stats.duplicateFaces));
+    Trace::count("output_vertices", static_cast<int64_t>(output.getVertexCount()));
+    Trace::count("output_faces", static_cast<int64_t>(output.getFaceCount()));
+    Trace::gauge("streaming_peak_mb", stats.peakBytes / (1024.0 * 1024.0));
+    Trace::sampleMemory();
+    return true;
+}
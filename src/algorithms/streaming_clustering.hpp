@@ -0,0 +1,58 @@
+#pragma once
+#include "../mesh/mesh.hpp"
+#include "../utils/file_io.hpp"
+#include "cell_accumulator.hpp"
+#include <cstddef>
+#include <string>
+
+// Out-of-core vertex clustering straight from a PLY file (in the spirit of
+// Lindstrom's OoCS).
+//
+// The file is streamed through a fixed-size window. Vertices are added to
+// grid cells as they pass, and each face is mapped to its cells and kept
+// only if it is not degenerate and not already in the output in either
+// winding. The input
+// mesh is never built. What is held is the cell accumulator and the
+// deduplicated output triangles, which grow with the output, plus one
+// 4-byte cell index per input vertex so that indexed faces can be resolved.
+//
+// The grid's bounding box is either given up front, which gives a single
+// pass over the file, or found by a pre-pass that reads only the vertex
+// element. With the box of the whole input, vertices match VertexClustering
+// exactly and faces match its default output, which drops the same
+// duplicates and keeps the first occurrence.
+class StreamingClustering {
+public:
+    struct Stats {
+        size_t inputVertices = 0;
+        size_t inputFaces = 0;
+        size_t degenerateFaces = 0;   // Collapsed to an edge or a point
+        size_t duplicateFaces = 0;    // Same cells as an earlier face, either winding
+        size_t bytesRead = 0;         // Including the bounding box pre-pass
+        size_t peakBytes = 0;         // Largest tracked working set
+        double seconds = 0.0;
+    };
+
+    StreamingClustering(int gridSize, size_t denseBudgetBytes = CellAccumulator::kDefaultDenseBudget)
+        : gridSize(gridSize), denseBudgetBytes(denseBudgetBytes) {}
+
+    // Cluster over this box instead of running the pre-pass. Vertices
+    // outside it land in the nearest boundary cell.
+    void setBoundingBox(const Vector3& min, const Vector3& max);
+    void setWindowBytes(size_t bytes) { windowBytes = bytes; }
+
+    // Streams filename and writes the clustered mesh, in the file's own
+    // coordinates, to output. Returns false if the file cannot be read or
+    // lists its faces before its vertices.
+    bool simplify(const std::string& filename, Mesh& output);
+
+    const Stats& getStats() const { return stats; }
+
+private:
+    int gridSize;
+    size_t denseBudgetBytes;
+    size_t windowBytes = PLYStreamReader::kDefaultWindowBytes;
+    bool hasBoundingBox = false;
+    Vector3 boxMin, boxMax;
+    Stats stats;
+};
@@ -0,0 +1,314 @@
+#include "triangle_bvh.hpp"
+#include "../utils/trace.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Centroid bins per axis; small nodes use one per triangle
+const int kBins = 16;
+// Nodes this small become leaves without trying a split
+const uint32_t kMinSplitSize = 5;
+// Leaves may hold up to this many triangles when the SAH prefers it
+const uint32_t kMaxLeafSize = 8;
+// Past this depth nodes become leaves, which bounds the query stack
+const int kMaxDepth = 60;
+
+struct Box {
+    float min[3] = {INFINITY, INFINITY, INFINITY};
+    float max[3] = {-INFINITY, -INFINITY, -INFINITY};
+
+    void grow(const Vector3& p) {
+        min[0] = std::min(min[0], p.x); max[0] = std::max(max[0], p.x);
+        min[1] = std::min(min[1], p.y); max[1] = std::max(max[1], p.y);
+        min[2] = std::min(min[2], p.z); max[2] = std::max(max[2], p.z);
+    }
+
+    void grow(const Box& other) {
+        for (int k = 0; k < 3; k++) {
+            min[k] = std::min(min[k], other.min[k]);
+            max[k] = std::max(max[k], other.max[k]);
+        }
+    }
+
+    // Half the surface area, which is all the SAH needs
+    float area() const {
+        const float dx = max[0] - min[0], dy = max[1] - min[1], dz = max[2] - min[2];
+        return (dx < 0.0f) ? 0.0f : dx * dy + dy * dz + dz * dx;
+    }
+};
+
+inline float axisOf(const Vector3& v, int axis) {
+    return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+inline Vector3 sub(const Vector3& u, const Vector3& v) {
+    return Vector3(u.x - v.x, u.y - v.y, u.z - v.z);
+}
+
+inline float dot(const Vector3& u, const Vector3& v) {
+    return u.x * v.x + u.y * v.y + u.z * v.z;
+}
+
+// Squared length of p - (a + s*u + t*v)
+inline float offsetLengthSquared(const Vector3& p, const Vector3& a, const Vector3& u, float s,
+                                 const Vector3& v, float t) {
+    const Vector3 d(p.x - a.x - s * u.x - t * v.x, p.y - a.y - s * u.y - t * v.y,
+                    p.z - a.z - s * u.z - t * v.z);
+    return dot(d, d);
+}
+
+inline float ratio(float numerator, float denominator) {
+    return denominator != 0.0f ? numerator / denominator : 0.0f;
+}
+
+// Squared distance from p to triangle abc, by the Voronoi region of the
+// closest feature (Ericson, Real-Time Collision Detection, 5.1.5).
+// Divisions are guarded so degenerate triangles act as segments or points.
+float pointTriangleDistanceSquared(const Vector3& p, const Vector3& a, const Vector3& b, const Vector3& c) {
+    const Vector3 ab = sub(b, a), ac = sub(c, a), ap = sub(p, a);
+    const float d1 = dot(ab, ap), d2 = dot(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f) return dot(ap, ap);
+
+    const Vector3 bp = sub(p, b);
+    const float d3 = dot(ab, bp), d4 = dot(ac, bp);
+    if (d3 >= 0.0f && d4 <= d3) return dot(bp, bp);
+
+    const float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+        return offsetLengthSquared(p, a, ab, ratio(d1, d1 - d3), ac, 0.0f);
+    }
+
+    const Vector3 cp = sub(p, c);
+    const float d5 = dot(ab, cp), d6 = dot(ac, cp);
+    if (d6 >= 0.0f && d5 <= d6) return dot(cp, cp);
+
+    const float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+        return offsetLengthSquared(p, a, ab, 0.0f, ac, ratio(d2, d2 - d6));
+    }
+
+    const float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+        const float w = ratio(d4 - d3, (d4 - d3) + (d5 - d6));
+        return offsetLengthSquared(p, b, sub(c, b), w, ab, 0.0f);
+    }
+
+    const float denominator = va + vb + vc;
+    return offsetLengthSquared(p, a, ab, ratio(vb, denominator), ac, ratio(vc, denominator));
+}
+
+class Builder {
+public:
+    Builder(const std::vector<Vector3>& vertices, const std::vector<Face>& faces)
+        : boxes(faces.size()), centroids(faces.size()), order(faces.size()) {
+        for (size_t f = 0; f < faces.size(); f++) {
+            const Vector3& a = vertices[faces[f].v1];
+            const Vector3& b = vertices[faces[f].v2];
+            const Vector3& c = vertices[faces[f].v3];
+            boxes[f].grow(a);
+            boxes[f].grow(b);
+            boxes[f].grow(c);
+            centroids[f] = Vector3((a.x + b.x + c.x) / 3.0f, (a.y + b.y + c.y) / 3.0f, (a.z + b.z + c.z) / 3.0f);
+            order[f] = static_cast<uint32_t>(f);
+        }
+    }
+
+    // Appends the subtree over order[begin, end) depth first; returns its root
+    template <typename Node>
+    uint32_t build(std::vector<Node>& nodes, uint32_t begin, uint32_t end, int depth) {
+        const uint32_t index = static_cast<uint32_t>(nodes.size());
+        nodes.emplace_back();
+
+        Box bounds, centroidBounds;
+        for (uint32_t i = begin; i < end; i++) {
+            bounds.grow(boxes[order[i]]);
+            centroidBounds.grow(centroids[order[i]]);
+        }
+        for (int k = 0; k < 3; k++) {
+            nodes[index].min[k] = bounds.min[k];
+            nodes[index].max[k] = bounds.max[k];
+        }
+
+        const uint32_t count = end - begin;
+        uint32_t mid = begin;
+        if (count >= kMinSplitSize && depth < kMaxDepth) {
+            mid = split(begin, end, bounds, centroidBounds);
+        }
+        if (mid == begin) {
+            nodes[index].offset = begin;
+            nodes[index].count = count;
+            return index;
+        }
+
+        build(nodes, begin, mid, depth + 1);
+        const uint32_t right = build(nodes, mid, end, depth + 1);
+        nodes[index].offset = right;
+        nodes[index].count = 0;
+        return index;
+    }
+
+    const std::vector<uint32_t>& leafOrder() const { return order; }
+
+private:
+    std::vector<Box> boxes;
+    std::vector<Vector3> centroids;
+    std::vector<uint32_t> order;
+
+    // Partitions order[begin, end) at the best binned SAH split and returns
+    // the first index of the right half, or begin to make a leaf
+    uint32_t split(uint32_t begin, uint32_t end, const Box& bounds, const Box& centroidBounds) {
+        const uint32_t count = end - begin;
+        const int bins = static_cast<int>(std::min<uint32_t>(count, kBins));
+        float bestCost = INFINITY;
+        int bestAxis = -1, bestBin = 0;
+
+        // One pass over the triangles fills the bins of all three axes
+        float scales[3];
+        for (int axis = 0; axis < 3; axis++) {
+            const float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+            scales[axis] = extent > 0.0f ? bins / extent : 0.0f;
+        }
+        Box binBoxes[3][kBins];
+        uint32_t binCounts[3][kBins] = {};
+        for (uint32_t i = begin; i < end; i++) {
+            const uint32_t f = order[i];
+            const Box& box = boxes[f];
+            for (int axis = 0; axis < 3; axis++) {
+                const int bin = binOf(axisOf(centroids[f], axis), centroidBounds.min[axis], scales[axis], bins);
+                binBoxes[axis][bin].grow(box);
+                binCounts[axis][bin]++;
+            }
+        }
+
+        for (int axis = 0; axis < 3; axis++) {
+            if (scales[axis] == 0.0f) continue;
+
+            // Area and count left of each boundary, then sweep from the right
+            float leftArea[kBins - 1];
+            uint32_t leftCount[kBins - 1];
+            Box box;
+            uint32_t running = 0;
+            for (int b = 0; b < bins - 1; b++) {
+                box.grow(binBoxes[axis][b]);
+                running += binCounts[axis][b];
+                leftArea[b] = box.area();
+                leftCount[b] = running;
+            }
+            box = Box();
+            running = 0;
+            for (int b = bins - 1; b > 0; b--) {
+                box.grow(binBoxes[axis][b]);
+                running += binCounts[axis][b];
+                if (leftCount[b - 1] == 0 || running == 0) continue;
+                const float cost = leftArea[b - 1] * leftCount[b - 1] + box.area() * running;
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestBin = b - 1;
+                }
+            }
+        }
+
+        // All centroids coincide: split in the middle if the node is too big
+        if (bestAxis < 0) return count > kMaxLeafSize ? begin + count / 2 : begin;
+
+        // Traversal costs about one triangle test
+        const float parentArea = bounds.area();
+        const float splitCost = 1.0f + (parentArea > 0.0f ? bestCost / parentArea : 0.0f);
+        if (count <= kMaxLeafSize && splitCost >= static_cast<float>(count)) return begin;
+
+        const float minimum = centroidBounds.min[bestAxis];
+        uint32_t* middle = std::partition(order.data() + begin, order.data() + end, [&](uint32_t f) {
+            return binOf(axisOf(centroids[f], bestAxis), minimum, scales[bestAxis], bins) <= bestBin;
+        });
+        return static_cast<uint32_t>(middle - order.data());
+    }
+
+    static int binOf(float value, float minimum, float scale, int bins) {
+        const int bin = static_cast<int>((value - minimum) * scale);
+        return std::min(std::max(bin, 0), bins - 1);
+    }
+};
+
+inline float boxDistanceSquared(const Vector3& p, const float min[3], const float max[3]) {
+    const float dx = std::max(std::max(min[0] - p.x, p.x - max[0]), 0.0f);
+    const float dy = std::max(std::max(min[1] - p.y, p.y - max[1]), 0.0f);
+    const float dz = std::max(std::max(min[2] - p.z, p.z - max[2]), 0.0f);
+    return dx * dx + dy * dy + dz * dz;
+}
+
+} // namespace
+
+TriangleBVH::TriangleBVH(const std::vector<Vector3>& vertices, const std::vector<Face>& faces) {
+    if (faces.empty()) return;
+    Trace::Scope trace("TriangleBVH::build");
+
+    Builder builder(vertices, faces);
+    builder.build(nodes, 0, static_cast<uint32_t>(faces.size()), 0);
+
+    faceOf = builder.leafOrder();
+    triangles.resize(faces.size());
+    for (size_t slot = 0; slot < faceOf.size(); slot++) {
+        const Face& face = faces[faceOf[slot]];
+        triangles[slot] = {vertices[face.v1], vertices[face.v2], vertices[face.v3]};
+    }
+}
+
+float TriangleBVH::distanceSquared(const Vector3& p, uint32_t slot) const {
+    const Triangle& t = triangles[slot];
+    return pointTriangleDistanceSquared(p, t.a, t.b, t.c);
+}
+
+TriangleBVH::Hit TriangleBVH::closest(const Vector3& p, uint32_t hintSlot) const {
+    Hit best;
+    if (nodes.empty()) return best;
+    if (hintSlot < triangles.size()) {
+        best.distanceSquared = distanceSquared(p, hintSlot);
+        best.slot = hintSlot;
+    }
+
+    // Pending subtrees with their box distance; nearer children are
+    // visited first and each level defers at most one sibling
+    struct Entry {
+        uint32_t node;
+        float distanceSquared;
+    };
+    Entry stack[kMaxDepth + 2];
+    int top = 0;
+    stack[top++] = {0, boxDistanceSquared(p, nodes[0].min, nodes[0].max)};
+
+    while (top > 0) {
+        const Entry entry = stack[--top];
+        if (entry.distanceSquared >= best.distanceSquared) continue;
+
+        const Node& node = nodes[entry.node];
+        if (node.count > 0) {
+            for (uint32_t slot = node.offset; slot < node.offset + node.count; slot++) {
+                const float d = distanceSquared(p, slot);
+                if (d < best.distanceSquared) {
+                    best.distanceSquared = d;
+                    best.slot = slot;
+                }
+            }
+            continue;
+        }
+
+        const uint32_t left = entry.node + 1, right = node.offset;
+        const float leftDistance = boxDistanceSquared(p, nodes[left].min, nodes[left].max);
+        const float rightDistance = boxDistanceSquared(p, nodes[right].min, nodes[right].max);
+        const bool leftFirst = leftDistance <= rightDistance;
+        const Entry nearer = leftFirst ? Entry{left, leftDistance} : Entry{right, rightDistance};
+        const Entry farther = leftFirst ? Entry{right, rightDistance} : Entry{left, leftDistance};
+        if (farther.distanceSquared < best.distanceSquared) stack[top++] = farther;
+        if (nearer.distanceSquared < best.distanceSquared) stack[top++] = nearer;
+    }
+
+    if (best.slot != kNone) best.face = faceOf[best.slot];
+    return best;
+}
+
+size_t TriangleBVH::memoryBytes() const {
+    return nodes.size() * sizeof(Node) + triangles.size() * sizeof(Triangle) +
+           faceOf.size() * sizeof(uint32_t);
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "../mesh/mesh.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Bounding volume hierarchy over the triangles of a mesh, for closest-point
+// queries.
+//
+// Built top-down with a binned surface area heuristic: each node tries 16
+// centroid bins on all three axes and splits where the summed child areas
+// weighted by triangle counts are least, or becomes a leaf when no split
+// beats testing its triangles directly. Nodes are stored depth first, so a
+// node's left child follows it and only the right child needs an index.
+// Triangles are copied into leaf order with their corner positions, so a
+// leaf test reads one contiguous block. The tree is read-only once built
+// and safe to query from any number of threads.
+class TriangleBVH {
+public:
+    static constexpr uint32_t kNone = 0xFFFFFFFFu;
+
+    struct Hit {
+        float distanceSquared = std::numeric_limits<float>::infinity();
+        uint32_t face = kNone;   // Index in the source mesh
+        uint32_t slot = kNone;   // Position in leaf order, usable as a hint
+    };
+
+    // Degenerate faces are kept; they behave as segments or points
+    TriangleBVH(const std::vector<Vector3>& vertices, const std::vector<Face>& faces);
+
+    // Closest triangle to p. A hint from an earlier nearby query seeds the
+    // search bound, which prunes most of the tree for coherent queries.
+    Hit closest(const Vector3& p, uint32_t hintSlot = kNone) const;
+
+    size_t triangleCount() const { return triangles.size(); }
+    size_t nodeCount() const { return nodes.size(); }
+    size_t memoryBytes() const;
+
+private:
+    struct Node {
+        float min[3], max[3];
+        uint32_t offset;  // First triangle for leaves, right child otherwise
+        uint32_t count;   // Triangles in a leaf; 0 for inner nodes
+    };
+
+    struct Triangle {
+        Vector3 a, b, c;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<Triangle> triangles;  // Leaf order
+    std::vector<uint32_t> faceOf;     // Source face of each slot
+
+    float distanceSquared(const Vector3& p, uint32_t slot) const;
+};
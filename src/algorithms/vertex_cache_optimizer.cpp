@@ -0,0 +1,191 @@
+#include "vertex_cache_optimizer.hpp"
+#include "../mesh/mesh_connectivity.hpp"
+#include "../mesh/meshlets.hpp"
+#include "../utils/trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+namespace {
+
+const uint32_t kNone = MeshConnectivity::kNone;
+
+// Corners of a face with repeated indices removed; returns how many remain
+int distinctCorners(const Face& face, uint32_t corners[3]) {
+    int count = 0;
+    corners[count++] = face.v1;
+    if (face.v2 != face.v1) corners[count++] = face.v2;
+    if (face.v3 != face.v1 && face.v3 != face.v2) corners[count++] = face.v3;
+    return count;
+}
+
+// A run of faces [first, last) reordered on its own
+struct Run {
+    uint32_t first, last;
+};
+
+// Tipsify face order over each run in turn, never moving a face out of its
+// run; the cache state carries over between runs. Returns the indices of
+// the faces in emission order.
+std::vector<uint32_t> tipsify(const std::vector<Face>& faces, const MeshConnectivity& connectivity, int cacheSize,
+                              const std::vector<Run>& runs) {
+    const size_t vertexCount = connectivity.vertexCount();
+    std::vector<uint32_t> order;
+    order.reserve(faces.size());
+
+    // Faces of the current run not emitted yet around each vertex
+    std::vector<uint32_t> live(vertexCount, 0);
+
+    // A vertex is in the cache while timestamp - cacheTime <= cacheSize;
+    // starting the clock past cacheSize leaves every vertex out of it
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    uint32_t timestamp = static_cast<uint32_t>(cacheSize) + 1;
+    std::vector<uint8_t> emitted(faces.size(), 0);
+    std::vector<uint32_t> deadEnd;
+    std::vector<uint32_t> candidates;
+
+    for (const Run& run : runs) {
+        for (uint32_t f = run.first; f < run.last; f++) {
+            uint32_t corners[3];
+            const int count = distinctCorners(faces[f], corners);
+            for (int i = 0; i < count; i++) live[corners[i]]++;
+        }
+        uint32_t cursor = run.first;
+
+        // Next vertex with live faces: recently used ones first, then a
+        // corner of the first face of the run not emitted yet
+        auto skipDeadEnd = [&]() -> uint32_t {
+            while (!deadEnd.empty()) {
+                const uint32_t v = deadEnd.back();
+                deadEnd.pop_back();
+                if (live[v] > 0) return v;
+            }
+            while (cursor < run.last) {
+                if (!emitted[cursor]) return faces[cursor].v1;
+                cursor++;
+            }
+            return kNone;
+        };
+
+        uint32_t fan = skipDeadEnd();
+        while (fan != kNone) {
+            candidates.clear();
+            for (uint32_t f : connectivity.facesOf(fan)) {
+                if (f < run.first || f >= run.last || emitted[f]) continue;
+                emitted[f] = 1;
+                order.push_back(f);
+
+                uint32_t corners[3];
+                const int count = distinctCorners(faces[f], corners);
+                for (int i = 0; i < count; i++) {
+                    const uint32_t v = corners[i];
+                    deadEnd.push_back(v);
+                    candidates.push_back(v);
+                    live[v]--;
+                    if (timestamp - cacheTime[v] > static_cast<uint32_t>(cacheSize)) cacheTime[v] = timestamp++;
+                }
+            }
+
+            // The candidate that stays cached through its own remaining faces
+            // and has been there longest; otherwise any dead-end vertex
+            uint32_t best = kNone;
+            int64_t bestPriority = -1;
+            for (uint32_t v : candidates) {
+                if (live[v] == 0) continue;
+                int64_t priority = 0;
+                const int64_t age = timestamp - cacheTime[v];
+                if (age + 2 * static_cast<int64_t>(live[v]) <= cacheSize) priority = age;
+                if (priority > bestPriority) {
+                    bestPriority = priority;
+                    best = v;
+                }
+            }
+            fan = best != kNone ? best : skipDeadEnd();
+        }
+    }
+    return order;
+}
+
+} // namespace
+
+VertexCacheOptimizer::CacheStats VertexCacheOptimizer::measure(const std::vector<Face>& faces,
+                                                               size_t vertexCount, int cacheSize) {
+    CacheStats result;
+    if (faces.empty()) return result;
+
+    // With misses as the clock, a vertex loaded at miss m is evicted by
+    // miss m + cacheSize
+    std::vector<uint64_t> loadedAt(vertexCount, UINT64_MAX);
+    uint64_t misses = 0;
+    size_t used = 0;
+    for (const Face& face : faces) {
+        for (unsigned v : {face.v1, face.v2, face.v3}) {
+            if (loadedAt[v] == UINT64_MAX) used++;
+            else if (misses - loadedAt[v] < static_cast<uint64_t>(cacheSize)) continue;
+            loadedAt[v] = misses++;
+        }
+    }
+    result.acmr = static_cast<double>(misses) / faces.size();
+    result.atvr = static_cast<double>(misses) / used;
+    return result;
+}
+
+void VertexCacheOptimizer::optimize(Mesh& mesh) {
+    stats = Stats();
+    const auto& vertices = mesh.getVertices();
+    const auto& faces = mesh.getFaces();
+    if (faces.empty()) return;
+    Trace::Scope trace("VertexCacheOptimizer::optimize");
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    stats.before = measure(faces, vertices.size(), cacheSize);
+
+    // Each meshlet is its own run, so meshlets keep their ranges
+    const Meshlets* meshlets = mesh.getMeshlets();
+    std::vector<Run> runs;
+    if (meshlets) {
+        runs.reserve(meshlets->size());
+        for (const Meshlets::Meshlet& m : meshlets->get()) runs.push_back({m.firstFace, m.firstFace + m.faceCount});
+    } else {
+        runs.push_back({0, static_cast<uint32_t>(faces.size())});
+    }
+    const std::vector<uint32_t> order = tipsify(faces, mesh.getConnectivity(), cacheSize, runs);
+
+    // New vertex numbers in order of first use, unused vertices last
+    std::vector<uint32_t> remap(vertices.size(), kNone);
+    uint32_t next = 0;
+    for (uint32_t f : order) {
+        for (unsigned v : {faces[f].v1, faces[f].v2, faces[f].v3}) {
+            if (remap[v] == kNone) remap[v] = next++;
+        }
+    }
+    for (uint32_t& slot : remap) {
+        if (slot == kNone) slot = next++;
+    }
+
+    std::vector<Vector3> newVertices(vertices.size());
+    for (size_t v = 0; v < vertices.size(); v++) newVertices[remap[v]] = vertices[v];
+
+    std::vector<Face> newFaces;
+    newFaces.reserve(faces.size());
+    for (uint32_t f : order) {
+        Face face = faces[f];
+        face.v1 = remap[face.v1];
+        face.v2 = remap[face.v2];
+        face.v3 = remap[face.v3];
+        newFaces.push_back(face);
+    }
+
+    if (meshlets) {
+        mesh.setReordered(std::move(newVertices), std::move(newFaces));
+    } else {
+        mesh.setVertices(std::move(newVertices));
+        mesh.setFaces(std::move(newFaces));
+    }
+    stats.after = measure(mesh.getFaces(), mesh.getVertexCount(), cacheSize);
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    stats.seconds = std::chrono::duration<double>(endTime - startTime).count();
+    Trace::gauge("acmr_before", stats.before.acmr);
+    Trace::gauge("acmr_after", stats.after.acmr);
+}
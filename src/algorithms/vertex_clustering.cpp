@@ -1,112 +1,239 @@
 #include "vertex_clustering.hpp"
-#include <iostream>
-#include <unordered_map>
+#include "../utils/parallel.hpp"
+#include "../utils/trace.hpp"
 #include <algorithm>
 #include <cmath>
 
-VertexClustering::Grid3D VertexClustering::positionToGrid(
-    const Vector3& pos, const Vector3& min, const Vector3& max) {
-    
-    // Scale to [0,1]
-    float x = (pos.x - min.x) / (max.x - min.x);
-    float y = (pos.y - min.y) / (max.y - min.y);
-    float z = (pos.z - min.z) / (max.z - min.z);
-
-    // Convert to grid coordinates
-    return Grid3D{
-        static_cast<int>(x * gridSize),
-        static_cast<int>(y * gridSize),
-        static_cast<int>(z * gridSize)
-    };
-}
+namespace {
+
+// Inputs smaller than this per thread are not worth splitting
+const size_t kMinChunk = 32768;
+
+// Keys quantized per kernel call on SoA input; small enough for the stack
+const size_t kKeyBlock = 1024;
+
+} // namespace
 
 Mesh VertexClustering::simplify(const Mesh& inputMesh) {
-    std::cout << "Starting vertex clustering simplification...\n";
-    std::cout << "Input mesh: " << inputMesh.getVertexCount() << " vertices, "
-              << inputMesh.getFaceCount() << " faces\n";
+    Mesh simplifiedMesh;
+    simplify(inputMesh, simplifiedMesh);
+    return simplifiedMesh;
+}
+
+void VertexClustering::simplify(const Mesh& inputMesh, Mesh& output) {
+    Trace::Scope trace("VertexClustering::simplify");
+    stats = Stats();
 
     // Get mesh data
     const auto& inputVertices = inputMesh.getVertices();
     const auto& inputFaces = inputMesh.getFaces();
-
-    // Find bounding box
-    Vector3 min = inputVertices[0], max = inputVertices[0];
-    for (const auto& v : inputVertices) {
-        min.x = std::min(min.x, v.x);
-        min.y = std::min(min.y, v.y);
-        min.z = std::min(min.z, v.z);
-        max.x = std::max(max.x, v.x);
-        max.y = std::max(max.y, v.y);
-        max.z = std::max(max.z, v.z);
+    std::vector<Vector3>& newVertices = workspace.vertices;
+    std::vector<Face>& newFaces = workspace.faces;
+
+    // Leaves output empty, keeping its buffers for the next call
+    auto clearOutput = [&]() {
+        newVertices.clear();
+        newFaces.clear();
+        output.swapBuffers(newVertices, newFaces);
+    };
+    if (inputVertices.empty()) {
+        clearOutput();
+        return;
     }
 
-    // Map grid cells to representative vertices
-    std::unordered_map<Grid3D, Vector3, GridHasher> gridToVertex;
-    std::unordered_map<Grid3D, int, GridHasher> gridToCount;
-    std::vector<Grid3D> vertexToGrid(inputVertices.size());
-
-    // First pass: accumulate vertices in grid cells
-    for (size_t i = 0; i < inputVertices.size(); i++) {
-        const auto& v = inputVertices[i];
-        Grid3D grid = positionToGrid(v, min, max);
-        vertexToGrid[i] = grid;
-
-        if (gridToVertex.find(grid) == gridToVertex.end()) {
-            gridToVertex[grid] = Vector3(0, 0, 0);
-            gridToCount[grid] = 0;
+    const unsigned threads = Parallel::resolveThreadCount(threadCount);
+
+    // Find bounding box: the fixed one if set, the mesh's if known, else one
+    // partial box per chunk
+    const unsigned vertexChunks = Parallel::chunkCount(inputVertices.size(), threads, kMinChunk);
+    Vector3 min = boxMin, max = boxMax;
+    if (!hasBoundingBox && !inputMesh.getCachedBoundingBox(min, max)) {
+        std::vector<Vector3>& chunkMin = workspace.chunkMin;
+        std::vector<Vector3>& chunkMax = workspace.chunkMax;
+        chunkMin.assign(vertexChunks, inputVertices[0]);
+        chunkMax.assign(vertexChunks, inputVertices[0]);
+        Parallel::forChunks(inputVertices.size(), vertexChunks,
+            [&](unsigned chunk, size_t begin, size_t end) {
+                Vector3& min = chunkMin[chunk];
+                Vector3& max = chunkMax[chunk];
+                for (size_t i = begin; i < end; i++) {
+                    const Vector3& v = inputVertices[i];
+                    min.x = std::min(min.x, v.x);
+                    min.y = std::min(min.y, v.y);
+                    min.z = std::min(min.z, v.z);
+                    max.x = std::max(max.x, v.x);
+                    max.y = std::max(max.y, v.y);
+                    max.z = std::max(max.z, v.z);
+                }
+            });
+
+        min = chunkMin[0];
+        max = chunkMax[0];
+        for (unsigned chunk = 1; chunk < vertexChunks; chunk++) {
+            min.x = std::min(min.x, chunkMin[chunk].x);
+            min.y = std::min(min.y, chunkMin[chunk].y);
+            min.z = std::min(min.z, chunkMin[chunk].z);
+            max.x = std::max(max.x, chunkMax[chunk].x);
+            max.y = std::max(max.y, chunkMax[chunk].y);
+            max.z = std::max(max.z, chunkMax[chunk].z);
         }
+    }
 
-        // Accumulate vertices
-        gridToVertex[grid].x += v.x;
-        gridToVertex[grid].y += v.y;
-        gridToVertex[grid].z += v.z;
-        gridToCount[grid]++;
+    Trace::Scope quantize("VertexClustering::quantize");
+    // First pass: accumulate vertices in grid cells. Each chunk fills its own
+    // partial table (sharing the dense budget) and records chunk-local slots.
+    std::vector<uint32_t>& vertexToCell = workspace.vertexToCell;
+    vertexToCell.resize(inputVertices.size());
+    std::vector<CellAccumulator>& tables = workspace.tables;
+    const size_t tableCount = vertexChunks == 1 ? 1 : vertexChunks + 1;
+    for (size_t t = 0; t < tableCount; t++) {
+        const size_t budget = t < vertexChunks ? denseBudgetBytes / vertexChunks : denseBudgetBytes;
+        if (t < tables.size()) tables[t].reset(gridSize, min, max, budget);
+        else tables.emplace_back(gridSize, min, max, budget);
+    }
+    const PositionArrays* soa = inputMesh.getPositionArrays();
+    Parallel::forChunks(inputVertices.size(), vertexChunks,
+        [&](unsigned chunk, size_t begin, size_t end) {
+            CellAccumulator& cells = tables[chunk];
+            if (!soa) {
+                for (size_t i = begin; i < end; i++) {
+                    vertexToCell[i] = cells.add(inputVertices[i]);
+                }
+                return;
+            }
+
+            // SoA input: quantize a block with the SIMD kernel, then accumulate
+            uint64_t keys[kKeyBlock];
+            for (size_t block = begin; block < end; block += kKeyBlock) {
+                const size_t count = std::min(kKeyBlock, end - block);
+                cells.cellKeys(&soa->x[block], &soa->y[block], &soa->z[block], count, keys);
+                for (size_t i = 0; i < count; i++) {
+                    vertexToCell[block + i] = cells.add(keys[i], inputVertices[block + i]);
+                }
+            }
+        });
+
+    // Merge the partial tables in input order, which reproduces the slot
+    // numbering and the exact sums of a single-threaded pass
+    CellAccumulator& cells = tables[tableCount - 1];
+    if (vertexChunks > 1) {
+        std::vector<std::vector<uint32_t>>& remaps = workspace.remaps;
+        if (remaps.size() < vertexChunks) remaps.resize(vertexChunks);
+        for (unsigned chunk = 0; chunk < vertexChunks; chunk++) {
+            cells.merge(tables[chunk], remaps[chunk]);
+        }
+        Parallel::forChunks(inputVertices.size(), vertexChunks,
+            [&](unsigned chunk, size_t begin, size_t end) {
+                const std::vector<uint32_t>& remap = remaps[chunk];
+                for (size_t i = begin; i < end; i++) {
+                    vertexToCell[i] = remap[vertexToCell[i]];
+                }
+            });
+    }
+    Trace::count("clustered_vertices", static_cast<int64_t>(inputVertices.size()));
+    Trace::count(cells.isDense() ? "dense_cells" : "hashed_cells", static_cast<int64_t>(cells.cellCount()));
+    Trace::gauge("cell_table_mb", cells.memoryBytes() / (1024.0 * 1024.0));
+    quantize.close();
+    if (cancelled()) {
+        clearOutput();
+        return;
     }
 
-    // Second pass: compute average positions
-    for (auto& pair : gridToVertex) {
-        const Grid3D& grid = pair.first;
-        Vector3& avg = pair.second;
-        int count = gridToCount[grid];
-        
-        avg.x /= count;
-        avg.y /= count;
-        avg.z /= count;
+    // Second pass: compute average positions, one output vertex per occupied cell
+    newVertices.resize(cells.cellCount());
+    Parallel::forChunks(newVertices.size(),
+        Parallel::chunkCount(newVertices.size(), threads, kMinChunk),
+        [&](unsigned, size_t begin, size_t end) {
+            for (size_t slot = begin; slot < end; slot++) {
+                newVertices[slot] = cells.average(static_cast<uint32_t>(slot));
+            }
+        });
+
+    if (cancelled()) {
+        clearOutput();
+        return;
     }
 
-    // Create mapping from old vertices to new indices
-    std::unordered_map<Grid3D, int, GridHasher> gridToIndex;
-    std::vector<Vector3> newVertices;
-    for (const auto& pair : gridToVertex) {
-        gridToIndex[pair.first] = newVertices.size();
-        newVertices.push_back(pair.second);
+    // Create new faces, removing degenerate ones. Each chunk writes the
+    // faces it keeps, with their duplicate keys, to the start of its own
+    // input range, and the ranges are then moved together in input order.
+    Trace::Scope remapFaces("VertexClustering::remapFaces");
+    const unsigned faceChunks = Parallel::chunkCount(inputFaces.size(), threads, kMinChunk);
+    std::vector<size_t>& kept = workspace.chunkFaceCounts;
+    std::vector<uint64_t>& faceKeys = workspace.faceKeys;
+    kept.assign(faceChunks, 0);
+    newFaces.resize(inputFaces.size(), Face(0, 0, 0));
+    faceKeys.resize(removeDuplicates ? inputFaces.size() : 0);
+    Parallel::forChunks(inputFaces.size(), faceChunks,
+        [&](unsigned chunk, size_t begin, size_t end) {
+            size_t out = begin;
+            for (size_t i = begin; i < end; i++) {
+                const Face& face = inputFaces[i];
+
+                // Get new vertex indices
+                uint32_t v1 = vertexToCell[face.v1];
+                uint32_t v2 = vertexToCell[face.v2];
+                uint32_t v3 = vertexToCell[face.v3];
+
+                // Skip degenerate triangles
+                if (v1 != v2 && v2 != v3 && v3 != v1) {
+                    if (removeDuplicates) faceKeys[out] = FaceDeduplicator::key(v1, v2, v3);
+                    newFaces[out++] = Face(v1, v2, v3);
+                }
+            }
+            kept[chunk] = out - begin;
+        });
+
+    size_t totalFaces = kept[0];
+    for (unsigned chunk = 1; chunk < faceChunks; chunk++) {
+        const size_t begin = Parallel::chunkBegin(inputFaces.size(), faceChunks, chunk);
+        std::copy(newFaces.begin() + begin, newFaces.begin() + begin + kept[chunk], newFaces.begin() + totalFaces);
+        if (removeDuplicates) {
+            std::copy(faceKeys.begin() + begin, faceKeys.begin() + begin + kept[chunk], faceKeys.begin() + totalFaces);
+        }
+        totalFaces += kept[chunk];
+    }
+    newFaces.resize(totalFaces, Face(0, 0, 0));
+    stats.degenerateFaces = inputFaces.size() - totalFaces;
+    if (removeDuplicates) {
+        faceKeys.resize(totalFaces);
+        stats.duplicateFaces = workspace.deduplicator.removeDuplicates(newFaces, faceKeys, threads);
     }
 
-    // Create new faces, removing degenerate ones
-    std::vector<Face> newFaces;
-    for (const auto& face : inputFaces) {
-        // Get new vertex indices
-        int v1 = gridToIndex[vertexToGrid[face.v1]];
-        int v2 = gridToIndex[vertexToGrid[face.v2]];
-        int v3 = gridToIndex[vertexToGrid[face.v3]];
-
-        // Skip degenerate triangles
-        if (v1 != v2 && v2 != v3 && v3 != v1) {
-            newFaces.emplace_back(v1, v2, v3);
+    // Renumber the cells the faces use in slot order and drop the rest
+    if (removeUnreferenced && !inputFaces.empty()) {
+        std::vector<uint32_t>& cellRemap = workspace.cellRemap;
+        cellRemap.assign(newVertices.size(), CellAccumulator::kEmpty);
+        for (const Face& face : newFaces) {
+            cellRemap[face.v1] = cellRemap[face.v2] = cellRemap[face.v3] = 0;
+        }
+        uint32_t used = 0;
+        for (size_t slot = 0; slot < newVertices.size(); slot++) {
+            if (cellRemap[slot] == CellAccumulator::kEmpty) continue;
+            cellRemap[slot] = used;
+            newVertices[used++] = newVertices[slot];
+        }
+        stats.unreferencedVertices = newVertices.size() - used;
+        newVertices.resize(used);
+        for (Face& face : newFaces) {
+            face.v1 = cellRemap[face.v1];
+            face.v2 = cellRemap[face.v2];
+            face.v3 = cellRemap[face.v3];
         }
     }
 
-    // Create simplified mesh
-    Mesh simplifiedMesh;
-    simplifiedMesh.setVertices(newVertices);
-    simplifiedMesh.setFaces(newFaces);
+    // Hand the buffers to the output mesh and keep its old ones
+    if (output.getPositionLayout() != inputMesh.getPositionLayout()) {
+        output.setPositionLayout(inputMesh.getPositionLayout());
+    }
+    output.swapBuffers(newVertices, newFaces);
 
-    std::cout << "Simplification complete:\n";
-    std::cout << "Output mesh: " << simplifiedMesh.getVertexCount() << " vertices, "
-              << simplifiedMesh.getFaceCount() << " faces\n";
-    std::cout << "Reduction ratio: " 
-              << (float)simplifiedMesh.getVertexCount() / inputMesh.getVertexCount() * 100.0f 
-              << "%\n";
+    remapFaces.close();
 
-    return simplifiedMesh;
-}
\ No newline at end of file
+    Trace::count("degenerate_faces_dropped", static_cast<int64_t>(stats.degenerateFaces));
+    Trace::count("duplicate_faces_dropped", static_cast<int64_t>(stats.duplicateFaces));
+    Trace::count("unreferenced_vertices_dropped", static_cast<int64_t>(stats.unreferencedVertices));
+    Trace::count("output_vertices", static_cast<int64_t>(output.getVertexCount()));
+    Trace::count("output_faces", static_cast<int64_t>(output.getFaceCount()));
+    Trace::sampleMemory();
+}
@@ -1,40 +1,92 @@
 #pragma once
 #include "../mesh/mesh.hpp"
-#include <unordered_map>
+#include "cell_accumulator.hpp"
+#include "face_deduplicator.hpp"
+#include <atomic>
 #include <vector>
 
 class VertexClustering {
 public:
-    struct Grid3D {
-        int x, y, z;
-        
-        // Hash function for grid coordinates
-        size_t hash() const {
-            return (size_t)x * 73856093 + 
-                   (size_t)y * 19349663 + 
-                   (size_t)z * 83492791;
-        }
-
-        bool operator==(const Grid3D& other) const {
-            return x == other.x && y == other.y && z == other.z;
-        }
+    // Faces removed by the last simplify, by reason, and the vertices
+    // dropped for having no face
+    struct Stats {
+        size_t degenerateFaces = 0;       // Two or more corners in one cell
+        size_t duplicateFaces = 0;        // Same three cells as an earlier face
+        size_t unreferencedVertices = 0;  // Cells no face uses, if removed
     };
 
-    struct GridHasher {
-        size_t operator()(const Grid3D& grid) const {
-            return grid.hash();
-        }
-    };
+    // Constructor takes the number of grid cells per dimension and the memory
+    // the dense cell table may use before falling back to hashing
+    VertexClustering(int gridSize, size_t denseBudgetBytes = CellAccumulator::kDefaultDenseBudget)
+        : gridSize(gridSize), denseBudgetBytes(denseBudgetBytes) {}
+
+    // Worker threads used by simplify; 0 uses every hardware thread.
+    // The output is identical for any thread count.
+    void setThreadCount(unsigned threads) { threadCount = threads; }
+
+    // Once *flag becomes true, simplify stops at the next phase boundary and
+    // returns an empty mesh. The flag must outlive the call; null disables
+    // checks.
+    void setCancelFlag(const std::atomic<bool>* flag) { cancelFlag = flag; }
+
+    // Fixes the box the grid spans instead of using the input's bounds;
+    // positions outside it fall in the boundary cells
+    void setBoundingBox(const Vector3& min, const Vector3& max) {
+        boxMin = min;
+        boxMax = max;
+        hasBoundingBox = true;
+    }
+
+    // Drops faces over the same three cells as an earlier face, in either
+    // winding (see FaceDeduplicator). On by default.
+    void setRemoveDuplicates(bool enabled) { removeDuplicates = enabled; }
 
-    // Constructor takes the number of grid cells per dimension
-    VertexClustering(int gridSize) : gridSize(gridSize) {}
+    // Drops cells that no output face uses and renumbers the rest in order.
+    // Off by default; inputs without faces always keep their cells.
+    void setRemoveUnreferenced(bool enabled) { removeUnreferenced = enabled; }
 
     // Main simplification function
     Mesh simplify(const Mesh& inputMesh);
 
+    // Same, built into output's buffers. Working tables are kept in this
+    // object between calls, so repeating the call on inputs no larger than
+    // before allocates nothing on a single thread (each extra thread still
+    // costs its start-up allocation).
+    void simplify(const Mesh& inputMesh, Mesh& output);
+
+    // Frees the working tables kept between calls
+    void releaseWorkspace() { workspace = Workspace(); }
+
+    const Stats& getStats() const { return stats; }
+
 private:
-    int gridSize;  // Number of grid cells per dimension
+    // Buffers reused from one call to the next
+    struct Workspace {
+        std::vector<Vector3> chunkMin, chunkMax;
+        std::vector<uint32_t> vertexToCell;
+        // One table per chunk, plus the merged table when there are several
+        std::vector<CellAccumulator> tables;
+        std::vector<std::vector<uint32_t>> remaps;
+        std::vector<size_t> chunkFaceCounts;
+        std::vector<uint64_t> faceKeys;
+        FaceDeduplicator deduplicator;
+        std::vector<uint32_t> cellRemap;
+        // Output buffers; swapped with the output mesh's, so they hold its
+        // previous buffers afterwards
+        std::vector<Vector3> vertices;
+        std::vector<Face> faces;
+    };
+
+    int gridSize;             // Number of grid cells per dimension
+    size_t denseBudgetBytes;  // Memory allowed for the dense cell table
+    unsigned threadCount = 0;
+    const std::atomic<bool>* cancelFlag = nullptr;
+    bool removeDuplicates = true;
+    bool removeUnreferenced = false;
+    bool hasBoundingBox = false;
+    Vector3 boxMin, boxMax;
+    Workspace workspace;
+    Stats stats;
 
-    // Convert 3D position to grid cell coordinates
-    Grid3D positionToGrid(const Vector3& pos, const Vector3& min, const Vector3& max);
-};
\ No newline at end of file
+    bool cancelled() const { return cancelFlag && cancelFlag->load(std::memory_order_relaxed); }
+};
@@ -1,9 +1,21 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <string>
 #include "mesh/mesh.hpp"
+#include "mesh/meshlets.hpp"
 #include "visualization/camera.hpp"
 #include <cmath>
-#include "algorithms/vertex_clustering.hpp"
+#include "algorithms/clustering_lod.hpp"
+#include "algorithms/quadric_simplification.hpp"
+#include "algorithms/background_simplifier.hpp"
+#include "algorithms/vertex_cache_optimizer.hpp"
+#include "utils/thread_pool.hpp"
+#include "utils/trace.hpp"
+#include <atomic>
+#include <memory>
+#include <vector>
 
 // Global variables
 Camera camera;
@@ -14,6 +26,86 @@ bool wireframeMode = false;
 Mesh* originalMesh = nullptr;
 Mesh* simplifiedMesh = nullptr;
 bool showSimplified = false;
+Mesh::NormalMode normalMode = Mesh::NormalMode::PerFace;
+
+// Clustering levels precomputed at load time. A worker pool prepares every
+// level's mesh (extract, meshlets, cache order) and publishes it in the
+// level's slot; the render thread takes it over on first use and keeps it,
+// so switching levels never simplifies on the frame. Until the level asked
+// for is ready, the last level drawn stays on screen.
+ClusteringLOD* lod = nullptr;
+std::vector<std::unique_ptr<Mesh>> lodMeshes;        // Taken meshes, render thread only
+std::unique_ptr<std::atomic<Mesh*>[]> lodReady;      // Prepared meshes not taken yet
+std::atomic<bool> lodCancelled{false};               // Skips levels not started at exit
+ThreadPool* lodPool = nullptr;
+Mesh* shownLodMesh = nullptr;  // Last level mesh drawn
+int lodLevel = -1;     // Level shown as the simplified mesh, -1 for simplifiedMesh
+bool autoLod = false;  // Pick the level from the camera distance every frame
+bool meshletCulling = true;  // Skip meshlets outside the view or facing away
+
+// Edge-collapse jobs run here; the render loop picks up finished meshes
+BackgroundSimplifier* simplifier = nullptr;
+
+const float kFieldOfView = 45.0f;
+const float kAspect = 800.0f / 600.0f;
+const float kNearPlane = 0.1f;
+const float kFarPlane = 100.0f;
+
+// Queues every level on the pool, the starting level first
+void prepareLodMeshes(int firstLevel) {
+    const int levels = lod->levelCount();
+    lodMeshes.resize(levels);
+    lodReady.reset(new std::atomic<Mesh*>[levels]);
+    for (int level = 0; level < levels; level++) lodReady[level].store(nullptr);
+    lodPool = new ThreadPool();
+
+    for (int i = 0; i < levels; i++) {
+        const int level = i == 0 ? firstLevel : (i <= firstLevel ? i - 1 : i);
+        lodPool->submit([level]() {
+            if (lodCancelled.load()) return;
+            std::unique_ptr<Mesh> mesh(new Mesh(lod->extract(level)));
+            // Meshlets first: the cache pass then reorders within each one.
+            // The pool already runs one level per thread.
+            mesh->buildMeshlets(1);
+            VertexCacheOptimizer().optimize(*mesh);
+            lodReady[level].store(mesh.release());
+        });
+    }
+}
+
+// Stops and joins the pool and frees the levels never taken
+void releaseLodMeshes() {
+    lodCancelled.store(true);
+    delete lodPool;
+    lodPool = nullptr;
+    for (size_t level = 0; level < lodMeshes.size(); level++) delete lodReady[level].exchange(nullptr);
+    lodMeshes.clear();
+}
+
+// Mesh of a level, or null while the pool is still preparing it
+Mesh* lodMesh(int level) {
+    if (!lodMeshes[level]) {
+        Mesh* ready = lodReady[level].exchange(nullptr);
+        if (!ready) return nullptr;
+        ready->setNormalMode(normalMode);
+        lodMeshes[level].reset(ready);
+    }
+    return lodMeshes[level].get();
+}
+
+void showLodLevel(int level) {
+    lodLevel = std::max(0, std::min(level, lod->levelCount() - 1));
+    showSimplified = true;
+    std::cout << "LOD level " << lodLevel << ": grid " << lod->gridSizeOf(lodLevel) << ", "
+              << lod->vertexCount(lodLevel) << " vertices, " << lod->faceCount(lodLevel) << " faces\n";
+}
+
+// Mesh shown when the simplified view is active
+Mesh* currentSimplified() {
+    if (lodLevel < 0) return simplifiedMesh;
+    if (Mesh* mesh = lodMesh(lodLevel)) shownLodMesh = mesh;
+    return shownLodMesh;
+}
 
 
 // Helper function to set perspective projection
@@ -37,19 +129,65 @@ void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods
         else
             glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
     }
+    else if (key == GLFW_KEY_N && action == GLFW_PRESS) {
+        normalMode = (normalMode == Mesh::NormalMode::PerFace) ? Mesh::NormalMode::PerVertex
+                                                               : Mesh::NormalMode::PerFace;
+        originalMesh->setNormalMode(normalMode);
+        if (simplifiedMesh) simplifiedMesh->setNormalMode(normalMode);
+        for (auto& mesh : lodMeshes) {
+            if (mesh) mesh->setNormalMode(normalMode);
+        }
+        std::cout << "Using per-" << (normalMode == Mesh::NormalMode::PerFace ? "face" : "vertex")
+                  << " normals\n";
+    }
     else if (key == GLFW_KEY_SPACE && action == GLFW_PRESS) {
         showSimplified = !showSimplified;
-        std::cout << "Showing " << (showSimplified ? "simplified" : "original") << " mesh\n";
+        const Mesh* shown = (showSimplified && currentSimplified()) ? currentSimplified() : originalMesh;
+        std::cout << "Showing " << (showSimplified ? "simplified" : "original") << " mesh: "
+                  << shown->getVertexCount() << " vertices, " << shown->getFaceCount() << " faces\n";
     }
     else if (key == GLFW_KEY_S && action == GLFW_PRESS) {
-        // Simplify with different grid sizes
+        // Switch between precomputed grid sizes
         static int gridSize = 16;
-        VertexClustering clustering(gridSize);
-        delete simplifiedMesh;
-        simplifiedMesh = new Mesh(clustering.simplify(*originalMesh));
-        std::cout << "Simplified with grid size: " << gridSize << std::endl;
+        autoLod = false;
+        showLodLevel(lod->levelForGridSize(gridSize));
         gridSize = (gridSize == 16) ? 32 : (gridSize == 32) ? 8 : 16;  // Cycle through grid sizes
     }
+    else if ((key == GLFW_KEY_LEFT_BRACKET || key == GLFW_KEY_RIGHT_BRACKET) && action == GLFW_PRESS) {
+        // Step one LOD level coarser / finer
+        autoLod = false;
+        int current = lodLevel >= 0 ? lodLevel : lod->levelForGridSize(16);
+        showLodLevel(current + (key == GLFW_KEY_RIGHT_BRACKET ? 1 : -1));
+    }
+    else if (key == GLFW_KEY_C && action == GLFW_PRESS) {
+        meshletCulling = !meshletCulling;
+        std::cout << "Meshlet culling " << (meshletCulling ? "on" : "off") << std::endl;
+    }
+    else if (key == GLFW_KEY_L && action == GLFW_PRESS) {
+        autoLod = !autoLod;
+        showSimplified = autoLod || showSimplified;
+        std::cout << "Distance-based LOD " << (autoLod ? "on" : "off") << std::endl;
+    }
+    else if (key == GLFW_KEY_Q && action == GLFW_PRESS) {
+        // Simplify with edge collapses to different face budgets. The job
+        // runs in the background; pressing Q again before it finishes
+        // cancels it in favour of the next budget.
+        static size_t targetFaces = 5000;
+        const size_t budget = targetFaces;
+        const Mesh* source = originalMesh;
+        simplifier->submit([budget, source](const std::atomic<bool>& cancelled) {
+            QuadricSimplifier quadric(budget);
+            quadric.setCancelFlag(&cancelled);
+            Mesh simplified = quadric.simplify(*source);
+            if (!cancelled.load()) {
+                simplified.buildMeshlets();
+                VertexCacheOptimizer().optimize(simplified);
+            }
+            return simplified;
+        });
+        std::cout << "Simplifying to face budget " << budget << " in the background" << std::endl;
+        targetFaces = (targetFaces == 5000) ? 1000 : (targetFaces == 1000) ? 20000 : 5000;  // Cycle through budgets
+    }
 }
 
 // Mouse callbacks remain the same
@@ -95,14 +233,152 @@ void setupLighting() {
     glMaterialfv(GL_FRONT_AND_BACK, GL_SHININESS, materialShininess);
 }
 
+// The volume the projection and camera.apply() show, for meshlet culling
+ViewFrustum cameraFrustum() {
+    float eye[3], forward[3], right[3], up[3];
+    camera.getView(eye, forward, right, up);
+    ViewFrustum view;
+    view.eye = Vector3(eye[0], eye[1], eye[2]);
+    view.forward = Vector3(forward[0], forward[1], forward[2]);
+    view.right = Vector3(right[0], right[1], right[2]);
+    view.up = Vector3(up[0], up[1], up[2]);
+    view.tanHalfFovY = tan(kFieldOfView * 3.14159f / 360.0f);
+    view.aspect = kAspect;
+    view.zNear = kNearPlane;
+    view.zFar = kFarPlane;
+    return view;
+}
+
+// Draws mesh, culled to the camera's view when culling is on
+void renderMesh(const Mesh& mesh) {
+    if (meshletCulling) mesh.render(cameraFrustum());
+    else mesh.render();
+}
+
+// Clears the framebuffer and draws the current mesh
+void drawFrame(GLFWwindow* window) {
+    Trace::Scope trace("frame");
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    glViewport(0, 0, width, height);
+
+    // Clear buffers with darker background
+    glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // Setup view
+    glMatrixMode(GL_MODELVIEW);
+    camera.apply();
+
+    // Update lighting
+    setupLighting();
+
+    if (autoLod) {
+        // Keep grid cells at least two pixels wide on screen
+        float pixelsPerUnit = height / (2.0f * camera.getRadius() * tan(kFieldOfView * 3.14159f / 360.0f));
+        int level = lod->levelForScreenSize(pixelsPerUnit, 2.0f);
+        if (level != lodLevel) showLodLevel(level);
+    }
+
+    // Render the appropriate mesh
+    Mesh* simplified = currentSimplified();
+    if (showSimplified && simplified) {
+        // Set color for simplified mesh (e.g., slightly reddish)
+        glColor3f(1.0f, 1.0f, 1.0f);
+        renderMesh(*simplified);
+    } else if (originalMesh) {
+        // Set color for original mesh (white)
+        glColor3f(1.0f, 1.0f, 1.0f);
+        renderMesh(*originalMesh);
+    }
+}
+
+// Renders a fixed number of frames and reports the mean frame time.
+// glFinish makes each frame's GPU work count, so it also works offscreen.
+void benchmarkFrames(GLFWwindow* window, int frames, const char* label) {
+    drawFrame(window);  // Warm-up frame pays for the buffer upload
+    glFinish();
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < frames; i++) {
+        camera.rotate(360.0f / frames, 0.0f);
+        drawFrame(window);
+        glFinish();
+        glfwSwapBuffers(window);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    double ms = std::chrono::duration<double, std::milli>(end - start).count() / frames;
+    std::cout << "Frame time (" << label << "): " << ms << " ms, " << 1000.0 / ms << " fps\n";
+}
+
+// Shows the newest background result, if one finished since the last frame.
+// The mesh it replaces is freed here, on the thread that owns its buffers.
+void pollSimplifier() {
+    std::unique_ptr<Mesh> result = simplifier->takeResult();
+    if (!result) return;
+
+    result->setNormalMode(normalMode);
+    delete simplifiedMesh;
+    simplifiedMesh = result.release();
+    lodLevel = -1;
+    autoLod = false;
+    showSimplified = true;
+    std::cout << "Simplified mesh ready: " << simplifiedMesh->getVertexCount() << " vertices, "
+              << simplifiedMesh->getFaceCount() << " faces" << std::endl;
+}
+
+// Writes the trace file, if tracing, and prints the summary table
+void finishTrace(const std::string& tracePath) {
+    if (tracePath.empty()) return;
+    Trace::sampleMemory();
+    if (Trace::writeChromeTrace(tracePath)) std::cout << "Trace written to " << tracePath << "\n";
+    Trace::printSummary(std::cout);
+}
+
+int main(int argc, char** argv) {
+    // --bench-frames N renders N frames into a hidden window and exits;
+    // --headless also asks GLFW 3.4+ for an OSMesa context with no display;
+    // --soa loads with the SoA position layout and its SIMD kernels;
+    // --morton sorts vertices and faces along a Morton curve at load;
+    // --no-cache reparses the PLY instead of reading its binary cache;
+    // --no-cull draws every face instead of culling meshlets (key C);
+    // --trace FILE records load, clustering and frame timings (see Trace)
+    int benchFrames = 0;
+    bool headless = false;
+    bool soa = false;
+    bool morton = false;
+    bool useCache = true;
+    std::string tracePath;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--bench-frames" && i + 1 < argc) benchFrames = std::atoi(argv[++i]);
+        else if (arg == "--headless") headless = true;
+        else if (arg == "--vertex-normals") normalMode = Mesh::NormalMode::PerVertex;
+        else if (arg == "--soa") soa = true;
+        else if (arg == "--morton") morton = true;
+        else if (arg == "--no-cache") useCache = false;
+        else if (arg == "--no-cull") meshletCulling = false;
+        else if (arg == "--trace" && i + 1 < argc) tracePath = argv[++i];
+    }
+    if (!tracePath.empty()) Trace::enable();
 
+#ifdef GLFW_PLATFORM_NULL
+    if (headless) glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#else
+    if (headless) std::cerr << "--headless needs GLFW 3.4; using a hidden window instead\n";
+#endif
 
-int main() {
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW" << std::endl;
         return -1;
     }
 
+    if (benchFrames > 0) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+#ifdef GLFW_OSMESA_CONTEXT_API
+    if (headless) glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+#endif
+
     GLFWwindow* window = glfwCreateWindow(800, 600, "Mesh Simplification", nullptr, nullptr);
     if (!window) {
         std::cerr << "Failed to create GLFW window" << std::endl;
@@ -129,63 +405,60 @@ int main() {
     // Load mesh
 // Load mesh (Stanford bunny)
     originalMesh = new Mesh();
-    if (!originalMesh->loadFromPLY("models/bunny/reconstruction/bun_zipper.ply")) {
+    if (soa) originalMesh->setPositionLayout(Mesh::PositionLayout::SoA);
+    if (morton) originalMesh->setVertexOrder(Mesh::VertexOrder::Morton);
+    const std::string modelPath = "models/bunny/reconstruction/bun_zipper.ply";
+    if (!(useCache ? originalMesh->loadCached(modelPath) : originalMesh->loadFromPLY(modelPath))) {
         std::cerr << "Failed to load mesh" << std::endl;
         glfwTerminate();
         return -1;
     }
+    originalMesh->setNormalMode(normalMode);
+    originalMesh->buildMeshlets();
 
-    // Initial simplification
-    VertexClustering clustering(16);  // Start with 16x16x16 grid
-    simplifiedMesh = new Mesh(clustering.simplify(*originalMesh));
+    // Build the clustering hierarchy once; start on the 16x16x16 grid
+    lod = new ClusteringLOD(*originalMesh);
+    lodLevel = lod->levelForGridSize(16);
+    prepareLodMeshes(lodLevel);
+    simplifier = new BackgroundSimplifier();
 
     // Setup projection matrix
     setupLighting();
     glMatrixMode(GL_PROJECTION);
     glLoadIdentity();
-    setPerspective(45.0f, 800.0f/600.0f, 0.1f, 100.0f);
+    setPerspective(kFieldOfView, kAspect, kNearPlane, kFarPlane);
 
-    // Main loop
-// Main loop
-    while (!glfwWindowShouldClose(window)) {
-        int width, height;
-        glfwGetFramebufferSize(window, &width, &height);
-        glViewport(0, 0, width, height);
-        
-        // Clear buffers with darker background
-        glClearColor(0.2f, 0.2f, 0.2f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        
-        // Setup view
-        glMatrixMode(GL_MODELVIEW);
-        camera.apply();
-
-        // Update lighting
-        setupLighting();
-
-        // Render the appropriate mesh
-        if (showSimplified && simplifiedMesh) {
-            // Set color for simplified mesh (e.g., slightly reddish)
-            glColor3f(1.0f, 1.0f, 1.0f);
-            simplifiedMesh->render();
-        } else if (originalMesh) {
-            // Set color for original mesh (white)
-            glColor3f(1.0f, 1.0f, 1.0f);
-            originalMesh->render();
-        }
+    if (benchFrames > 0) {
+        showSimplified = false;
+        benchmarkFrames(window, benchFrames, "original");
+        lodPool->wait();  // Time the simplified level, not its stand-in
+        showSimplified = true;
+        benchmarkFrames(window, benchFrames, "simplified");
+        finishTrace(tracePath);
 
-        // Display mesh information
-        if (showSimplified && simplifiedMesh) {
-            std::cout << "\rShowing simplified mesh: " 
-                     << simplifiedMesh->getVertexCount() << " vertices, "
-                     << simplifiedMesh->getFaceCount() << " faces     \r" << std::flush;
-        }
+        delete simplifier;
+        releaseLodMeshes();
+        delete lod;
+        delete originalMesh;
+        delete simplifiedMesh;
+        glfwTerminate();
+        return 0;
+    }
 
+    // Main loop
+    while (!glfwWindowShouldClose(window)) {
+        pollSimplifier();
+        drawFrame(window);
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
+    finishTrace(tracePath);
 
-    // Cleanup
+    // Cleanup; the simplifier and the level pool go first, as their jobs
+    // read originalMesh and lod
+    delete simplifier;
+    releaseLodMeshes();
+    delete lod;
     delete originalMesh;
     delete simplifiedMesh;
 
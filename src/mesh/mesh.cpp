@@ -1,32 +1,115 @@
 #include "mesh.hpp"
-#include <GLFW/glfw3.h>
+#include "vertex_kernels.hpp"
+#include "mesh_connectivity.hpp"
+#include "meshlets.hpp"
+#include "spatial_order.hpp"
+#include "../utils/file_io.hpp"
+#include "../utils/mesh_cache.hpp"
+#include "../utils/trace.hpp"
 #include <iostream>
-#include <fstream>  // Added for ifstream
-#include <sstream>  // Added for istringstream
 #include <limits>
 #include <cmath>
 #include <algorithm>
 
-void Mesh::computeBoundingBox(Vector3& min, Vector3& max) {
-    if (vertices.empty()) return;
+void PositionArrays::assign(const std::vector<Vector3>& vertices) {
+    x.resize(vertices.size());
+    y.resize(vertices.size());
+    z.resize(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        x[i] = vertices[i].x;
+        y[i] = vertices[i].y;
+        z[i] = vertices[i].z;
+    }
+}
+
+void PositionArrays::copyTo(std::vector<Vector3>& vertices) const {
+    vertices.resize(size());
+    for (size_t i = 0; i < size(); i++) {
+        vertices[i] = Vector3(x[i], y[i], z[i]);
+    }
+}
+
+void Mesh::setVertices(const std::vector<Vector3>& newVertices) {
+    vertices = newVertices;
+    if (layout == PositionLayout::SoA) positions.assign(vertices);
+    bounds.valid = false;
+    connectivity.reset();
+    meshlets.reset();
+    gpu.dirty = true;
+}
+
+void Mesh::setVertices(std::vector<Vector3>&& newVertices) {
+    vertices = std::move(newVertices);
+    if (layout == PositionLayout::SoA) positions.assign(vertices);
+    bounds.valid = false;
+    connectivity.reset();
+    meshlets.reset();
+    gpu.dirty = true;
+}
+
+void Mesh::swapBuffers(std::vector<Vector3>& otherVertices, std::vector<Face>& otherFaces) {
+    vertices.swap(otherVertices);
+    faces.swap(otherFaces);
+    if (layout == PositionLayout::SoA) positions.assign(vertices);
+    bounds.valid = false;
+    connectivity.reset();
+    meshlets.reset();
+    gpu.dirty = true;
+}
+
+void Mesh::setPositionLayout(PositionLayout newLayout) {
+    layout = newLayout;
+    if (layout == PositionLayout::SoA) {
+        positions.assign(vertices);
+    } else {
+        positions = PositionArrays();
+    }
+}
 
-    min = max = vertices[0];
-    for (const auto& v : vertices) {
-        min.x = std::min(min.x, v.x);
-        min.y = std::min(min.y, v.y);
-        min.z = std::min(min.z, v.z);
-        max.x = std::max(max.x, v.x);
-        max.y = std::max(max.y, v.y);
-        max.z = std::max(max.z, v.z);
+void Mesh::getBoundingBox(Vector3& min, Vector3& max) const {
+    if (!bounds.valid) {
+        bounds.min = bounds.max = Vector3(0, 0, 0);
+        if (layout == PositionLayout::SoA && positions.size() > 0) {
+            VertexKernels::bounds(positions.x.data(), positions.y.data(), positions.z.data(),
+                                  positions.size(), bounds.min, bounds.max);
+        } else if (!vertices.empty()) {
+            bounds.min = bounds.max = vertices[0];
+            for (const auto& v : vertices) {
+                bounds.min.x = std::min(bounds.min.x, v.x);
+                bounds.min.y = std::min(bounds.min.y, v.y);
+                bounds.min.z = std::min(bounds.min.z, v.z);
+                bounds.max.x = std::max(bounds.max.x, v.x);
+                bounds.max.y = std::max(bounds.max.y, v.y);
+                bounds.max.z = std::max(bounds.max.z, v.z);
+            }
+        }
+        bounds.valid = true;
+    }
+    min = bounds.min;
+    max = bounds.max;
+}
+
+bool Mesh::getCachedBoundingBox(Vector3& min, Vector3& max) const {
+    if (!bounds.valid) return false;
+    min = bounds.min;
+    max = bounds.max;
+    return true;
+}
+
+const MeshConnectivity& Mesh::getConnectivity() const {
+    if (!connectivity) {
+        connectivity = std::make_shared<const MeshConnectivity>(vertices.size(), faces);
     }
+    return *connectivity;
 }
 
 void Mesh::centerAndScale() {
     if (vertices.empty()) return;
+    Trace::Scope trace("Mesh::centerAndScale");
 
     // Compute bounding box
     Vector3 min, max;
-    computeBoundingBox(min, max);
+    getBoundingBox(min, max);
 
     // Compute center
     centerPoint.x = (min.x + max.x) / 2.0f;
@@ -41,16 +124,36 @@ void Mesh::centerAndScale() {
     if (scale < 1e-6f) scale = 1.0f;
 
     // Center and scale vertices
-    for (auto& v : vertices) {
-        v.x = (v.x - centerPoint.x) / scale;
-        v.y = (v.y - centerPoint.y) / scale;
-        v.z = (v.z - centerPoint.z) / scale;
+    if (layout == PositionLayout::SoA) {
+        VertexKernels::centerAndScale(positions.x.data(), positions.y.data(), positions.z.data(),
+                                      positions.size(), centerPoint, scale);
+        positions.copyTo(vertices);
+    } else {
+        for (auto& v : vertices) {
+            v.x = (v.x - centerPoint.x) / scale;
+            v.y = (v.y - centerPoint.y) / scale;
+            v.z = (v.z - centerPoint.z) / scale;
+        }
     }
 
-    std::cout << "Mesh centered and scaled. Scale factor: " << scale << std::endl;
+    // The transform is monotonic per axis, so the box maps onto the new box
+    bounds.min = Vector3((min.x - centerPoint.x) / scale, (min.y - centerPoint.y) / scale,
+                         (min.z - centerPoint.z) / scale);
+    bounds.max = Vector3((max.x - centerPoint.x) / scale, (max.y - centerPoint.y) / scale,
+                         (max.z - centerPoint.z) / scale);
+    meshlets.reset();
+    gpu.dirty = true;
 }
 
 void Mesh::computeNormals() {
+    Trace::Scope trace("Mesh::computeNormals");
+    if (layout == PositionLayout::SoA) {
+        VertexKernels::faceNormals(positions.x.data(), positions.y.data(), positions.z.data(),
+                                   faces.data(), faces.size());
+        gpu.dirty = true;
+        return;
+    }
+
     for (auto& face : faces) {
         const Vector3& v1 = vertices[face.v1];
         const Vector3& v2 = vertices[face.v2];
@@ -75,128 +178,94 @@ void Mesh::computeNormals() {
             face.normal.z /= len;
         }
     }
+    gpu.dirty = true;
 }
 
-bool Mesh::loadFromPLY(const std::string& filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        std::cerr << "Error: Could not open file " << filename << std::endl;
-        return false;
-    }
+void Mesh::buildMeshlets(unsigned threadCount) {
+    auto built = std::make_shared<const Meshlets>(vertices, faces, threadCount);
+    connectivity.reset();
+    meshlets = std::move(built);
+    gpu.dirty = true;
+}
 
-    vertices.clear();
-    faces.clear();
+void Mesh::setReordered(std::vector<Vector3>&& newVertices, std::vector<Face>&& newFaces) {
+    vertices = std::move(newVertices);
+    faces = std::move(newFaces);
+    if (layout == PositionLayout::SoA) positions.assign(vertices);
+    connectivity.reset();
+    gpu.dirty = true;
+}
 
-    // Read header
-    std::string line;
-    int nVertices = 0, nFaces = 0;
-    bool binary = false;
+void Mesh::sortSpatially() {
+    if (vertices.empty()) return;
+    Vector3 min, max;
+    getBoundingBox(min, max);
+    SpatialOrder::sortMesh(vertices, faces, min, max);
+    if (layout == PositionLayout::SoA) positions.assign(vertices);
+    connectivity.reset();
+    meshlets.reset();
+    gpu.dirty = true;
+}
 
-    std::cout << "Starting to read PLY file: " << filename << std::endl;
+bool Mesh::loadFromPLY(const std::string& filename) {
+    Trace::Scope trace("Mesh::loadFromPLY");
 
-    // Process header
-    std::getline(file, line);
-    if (line != "ply") {
-        std::cerr << "Error: Not a PLY file" << std::endl;
+    FileIO::LoadStats stats;
+    if (!FileIO::loadPLY(filename, vertices, faces, &stats)) {
+        std::cerr << "Error: Failed to load PLY file " << filename << std::endl;
         return false;
     }
-
-    while (std::getline(file, line)) {
-        if (line == "end_header") break;
-
-        std::istringstream iss(line);
-        std::string keyword;
-        iss >> keyword;
-
-        if (keyword == "format") {
-            std::string format;
-            iss >> format;
-            binary = (format == "binary_little_endian");
-            std::cout << "File format: " << format << std::endl;
-        }
-        else if (keyword == "element") {
-            std::string element;
-            int count;
-            iss >> element >> count;
-            if (element == "vertex") {
-                nVertices = count;
-                std::cout << "Number of vertices: " << nVertices << std::endl;
-            }
-            else if (element == "face") {
-                nFaces = count;
-                std::cout << "Number of faces: " << nFaces << std::endl;
-            }
-        }
-    }
-
-    // Read vertices
-    std::cout << "Reading vertices..." << std::endl;
-    vertices.reserve(nVertices);
-    for (int i = 0; i < nVertices; i++) {
-        std::string line;
-        std::getline(file, line);
-        std::istringstream iss(line);
-        
-        float x, y, z;
-        iss >> x >> y >> z;
-        vertices.emplace_back(x, y, z);
-        
-        if (i % 10000 == 0) {
-            std::cout << "Processed " << i << " vertices\r" << std::flush;
-        }
-    }
-    std::cout << "\nFinished reading vertices" << std::endl;
-
-    // Read faces
-    std::cout << "Reading faces..." << std::endl;
-    faces.reserve(nFaces);
-    for (int i = 0; i < nFaces; i++) {
-        std::string line;
-        std::getline(file, line);
-        std::istringstream iss(line);
-        
-        int nVerticesInFace;
-        iss >> nVerticesInFace;
-        
-        if (nVerticesInFace != 3) {
-            std::cerr << "Error: Only triangular faces are supported" << std::endl;
-            return false;
-        }
-
-        unsigned int v1, v2, v3;
-        iss >> v1 >> v2 >> v3;
-        faces.emplace_back(v1, v2, v3);
-        
-        if (i % 10000 == 0) {
-            std::cout << "Processed " << i << " faces\r" << std::flush;
-        }
-    }
-    std::cout << "\nFinished reading faces" << std::endl;
-
-    std::cout << "Successfully loaded PLY file\n";
-    std::cout << "Vertices loaded: " << vertices.size() << std::endl;
-    std::cout << "Faces loaded: " << faces.size() << std::endl;
+    Trace::count("vertices_loaded", static_cast<int64_t>(vertices.size()));
+    Trace::count("faces_loaded", static_cast<int64_t>(faces.size()));
+    Trace::count("bytes_read", static_cast<int64_t>(stats.bytes));
+    Trace::gauge("parse_mb_per_s", stats.megabytesPerSecond());
+    Trace::gauge("parse_elements_per_s", stats.elementsPerSecond());
+    if (layout == PositionLayout::SoA) positions.assign(vertices);
+    bounds.valid = false;
+    connectivity.reset();
+    meshlets.reset();
+    if (vertexOrder == VertexOrder::Morton) sortSpatially();
 
     // Center and scale the mesh
     centerAndScale();
     computeNormals();
+    gpu.dirty = true;
+    Trace::sampleMemory();
 
     return true;
 }
-void Mesh::render() const {
-    glBegin(GL_TRIANGLES);
-    for (const auto& face : faces) {
-        glNormal3f(face.normal.x, face.normal.y, face.normal.z);
-        
-        const Vector3& v1 = vertices[face.v1];
-        const Vector3& v2 = vertices[face.v2];
-        const Vector3& v3 = vertices[face.v3];
 
-        glVertex3f(v1.x, v1.y, v1.z);
-        glVertex3f(v2.x, v2.y, v2.z);
-        glVertex3f(v3.x, v3.y, v3.z);
+bool Mesh::loadCached(const std::string& filename, const std::string& cachePath) {
+    Trace::Scope trace("Mesh::loadCached");
+    const std::string path = cachePath.empty() ? MeshCache::pathFor(filename) : cachePath;
+    uint32_t flags = 0;
+    if (vertexOrder == VertexOrder::Morton) flags |= MeshCache::kMortonOrder;
+
+    MeshCache::Transform transform;
+    if (MeshCache::read(path, filename, flags, vertices, faces, transform)) {
+        centerPoint = transform.center;
+        scale = transform.scale;
+        bounds.min = transform.min;
+        bounds.max = transform.max;
+        bounds.valid = true;
+        if (layout == PositionLayout::SoA) positions.assign(vertices);
+        connectivity.reset();
+        meshlets.reset();
+        gpu.dirty = true;
+        Trace::sampleMemory();
+        return true;
     }
-    glEnd();
+
+    if (!loadFromPLY(filename)) return false;
+    transform.center = centerPoint;
+    transform.scale = scale;
+    getBoundingBox(transform.min, transform.max);
+    MeshCache::write(path, filename, flags, vertices, faces, transform);
+    return true;
+}
+
+bool Mesh::saveToPLY(const std::string& filename) const {
+    return FileIO::savePLY(filename, vertices, faces);
 }
 
 void Mesh::debugPrint() const {
@@ -2,6 +2,9 @@
 #include <vector>
 #include <string>
 #include <array>
+#include <memory>
+#include <utility>
+#include "../utils/aligned_allocator.hpp"
 
 struct Vector3 {
     float x, y, z;
@@ -30,13 +33,62 @@ struct Face {
         : v1(v1), v2(v2), v3(v3) {}
 };
 
+// Vertex positions as separate x/y/z arrays (structure of arrays), each on a
+// 32-byte boundary, for the SIMD kernels in vertex_kernels.hpp
+struct PositionArrays {
+    std::vector<float, AlignedAllocator<float, 32>> x, y, z;
+
+    size_t size() const { return x.size(); }
+    void assign(const std::vector<Vector3>& vertices);
+    void copyTo(std::vector<Vector3>& vertices) const;
+};
+
+// GPU buffers holding an uploaded mesh; defined next to Mesh::render
+struct MeshGpuBuffers;
+
+class MeshConnectivity;
+class Meshlets;
+struct ViewFrustum;
+
 class Mesh {
 public:
+    // Shading normals used by render(): one per face (flat, vertices are
+    // duplicated per triangle) or one per vertex (smooth, indexed draw)
+    enum class NormalMode { PerFace, PerVertex };
+
+    // AoS keeps positions only in getVertices(). SoA also mirrors them in
+    // PositionArrays, which centerAndScale, computeNormals, the bounds and
+    // VertexClustering then process with SIMD kernels.
+    enum class PositionLayout { AoS, SoA };
+
+    // Order loadFromPLY leaves vertices and faces in: as in the file, or
+    // sorted along a Morton curve by sortSpatially
+    enum class VertexOrder { File, Morton };
+
     Mesh() = default;
     ~Mesh() = default;
+    // Declared so that the destructor above does not turn moves into copies
+    Mesh(const Mesh&) = default;
+    Mesh(Mesh&&) = default;
+    Mesh& operator=(const Mesh&) = default;
+    Mesh& operator=(Mesh&&) = default;
 
     bool loadFromPLY(const std::string& filename);
+    // loadFromPLY through the binary cache (mesh_cache.hpp) at cachePath,
+    // by default next to the file: a valid cache is read instead of the
+    // file, otherwise the file is loaded and the cache rewritten. Failing
+    // to write the cache does not fail the load.
+    bool loadCached(const std::string& filename, const std::string& cachePath = "");
+    // Writes the mesh as binary little-endian PLY
+    bool saveToPLY(const std::string& filename) const;
+    // Draws from vertex/index buffers, uploading only after the mesh changed
     void render() const;
+    // Draws only the meshlets that may be visible from view (see
+    // buildMeshlets), merging runs of neighbours into one draw; without
+    // meshlets it draws everything
+    void render(const ViewFrustum& view) const;
+    void setNormalMode(NormalMode mode) { normalMode = mode; gpu.dirty = true; }
+    NormalMode getNormalMode() const { return normalMode; }
     void debugPrint() const;
 
     // Getters
@@ -45,16 +97,100 @@ public:
     // Add these getter/setter methods
     const std::vector<Vector3>& getVertices() const { return vertices; }
     const std::vector<Face>& getFaces() const { return faces; }
-    void setVertices(const std::vector<Vector3>& newVertices) { vertices = newVertices; }
-    void setFaces(const std::vector<Face>& newFaces) { faces = newFaces; }
+    void setVertices(const std::vector<Vector3>& newVertices);
+    void setFaces(const std::vector<Face>& newFaces) {
+        faces = newFaces;
+        connectivity.reset();
+        meshlets.reset();
+        gpu.dirty = true;
+    }
+    // Take over the buffers instead of copying them
+    void setVertices(std::vector<Vector3>&& newVertices);
+    void setFaces(std::vector<Face>&& newFaces) {
+        faces = std::move(newFaces);
+        connectivity.reset();
+        meshlets.reset();
+        gpu.dirty = true;
+    }
+    // Exchanges the mesh's buffers with the given ones, so a caller that
+    // fills buffers and swaps them in gets the previous ones back to fill
+    // next time, with their capacity
+    void swapBuffers(std::vector<Vector3>& otherVertices, std::vector<Face>& otherFaces);
+
+    // Run by loadFromPLY; public so meshes built in code can use them too.
+    // centerAndScale moves the bounding box center to the origin and its
+    // largest side to 1; computeNormals fills in the unit face normals.
+    void centerAndScale();
+    void computeNormals();
+    // Sorts vertices along a Morton curve and faces by their first vertex
+    // on it (spatial_order.hpp); the surface is unchanged
+    void sortSpatially();
+
+    void setPositionLayout(PositionLayout layout);
+    PositionLayout getPositionLayout() const { return layout; }
+
+    // Applies to the next loadFromPLY
+    void setVertexOrder(VertexOrder order) { vertexOrder = order; }
+    VertexOrder getVertexOrder() const { return vertexOrder; }
+    // Null unless the layout is SoA
+    const PositionArrays* getPositionArrays() const {
+        return layout == PositionLayout::SoA ? &positions : nullptr;
+    }
+
+    // Axis-aligned bounds, computed on first use after the vertices change
+    void getBoundingBox(Vector3& min, Vector3& max) const;
+    // Returns the bounds only if they are already known
+    bool getCachedBoundingBox(Vector3& min, Vector3& max) const;
+
+    // Vertex-to-face and edge adjacency (mesh_connectivity.hpp), built on
+    // first use after the faces or vertices change. Copies of the mesh
+    // share it until either one is modified.
+    const MeshConnectivity& getConnectivity() const;
+
+    // Splits the faces into meshlets (meshlets.hpp) and reorders them so
+    // each meshlet is a contiguous run; the surface is unchanged. Any later
+    // change to the vertices or faces other than setReordered drops the
+    // meshlets.
+    void buildMeshlets(unsigned threadCount = 0);
+    // Null unless buildMeshlets ran since the last change
+    const Meshlets* getMeshlets() const { return meshlets.get(); }
+    // Takes over a renumbering of the same vertices and a reordering of the
+    // faces that leaves every face in its meshlet's run (as
+    // VertexCacheOptimizer does), so the meshlets and bounds are kept
+    void setReordered(std::vector<Vector3>&& newVertices, std::vector<Face>&& newFaces);
 
 private:
     std::vector<Vector3> vertices;
     std::vector<Face> faces;
     Vector3 centerPoint{0, 0, 0};
     float scale = 1.0f;
+    NormalMode normalMode = NormalMode::PerFace;
+    PositionLayout layout = PositionLayout::AoS;
+    VertexOrder vertexOrder = VertexOrder::File;
+    PositionArrays positions;  // Filled only for the SoA layout
 
-    void computeBoundingBox(Vector3& min, Vector3& max);
-    void centerAndScale();
-    void computeNormals();
+    struct Bounds {
+        Vector3 min, max;
+        bool valid = false;
+    };
+    mutable Bounds bounds;
+    mutable std::shared_ptr<const MeshConnectivity> connectivity;
+    std::shared_ptr<const Meshlets> meshlets;  // Shared by copies, like connectivity
+
+    // Buffers created by render(). A copied Mesh never shares them; it
+    // uploads its own on first draw.
+    struct GpuState {
+        std::shared_ptr<MeshGpuBuffers> buffers;
+        bool dirty = true;
+
+        GpuState() = default;
+        GpuState(const GpuState&) {}
+        GpuState& operator=(const GpuState&) { dirty = true; return *this; }
+    };
+    mutable GpuState gpu;
+
+    void uploadToGpu() const;
+    // Uploads if needed and draws the visible meshlets, or every face when
+    // view or the meshlets are missing
+    void draw(const ViewFrustum* view) const;
 };
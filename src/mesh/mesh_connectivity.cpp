@@ -0,0 +1,219 @@
+#include "mesh_connectivity.hpp"
+#include "../utils/parallel.hpp"
+#include "../utils/trace.hpp"
+#include <algorithm>
+
+namespace {
+
+// Inputs smaller than this per thread are not worth splitting
+const size_t kMinChunk = 32768;
+
+// The first pass sorts into at most 2^kBucketBits ranges of vertices
+const int kBucketBits = 12;
+
+// Second half of a face edge, grouped under its smaller vertex
+struct HalfEdge {
+    uint32_t other;
+    uint32_t face;
+
+    bool operator<(const HalfEdge& rhs) const {
+        return other < rhs.other || (other == rhs.other && face < rhs.face);
+    }
+};
+
+// Counting sort of the (vertex, value) pairs that emit(face, out) passes to
+// out, into CSR form: the values of vertex v end up in
+// values[offsets[v], offsets[v + 1]), in face order. Each chunk of faces
+// counts and then scatters its pairs into coarse vertex buckets, which are
+// then sorted by vertex independently.
+template <typename Value, typename Emit>
+void groupByVertex(size_t vertexCount, size_t faceCount, unsigned threads, const Emit& emit,
+                   std::vector<uint32_t>& offsets, std::vector<Value>& values) {
+    int shift = 0;
+    while ((vertexCount >> shift) >= (size_t(1) << kBucketBits)) shift++;
+    const size_t bucketCount = (vertexCount >> shift) + 1;
+    const unsigned chunks = Parallel::chunkCount(faceCount, threads, kMinChunk);
+
+    // Pairs per (chunk, bucket)
+    std::vector<size_t> cursors(chunks * bucketCount, 0);
+    Parallel::forChunks(faceCount, chunks, [&](unsigned chunk, size_t begin, size_t end) {
+        size_t* counts = &cursors[chunk * bucketCount];
+        for (size_t f = begin; f < end; f++) {
+            emit(f, [&](uint32_t vertex, const Value&) { counts[vertex >> shift]++; });
+        }
+    });
+
+    // Bucket-major prefix sum with the chunks of a bucket in order, so
+    // every bucket lists its pairs in face order
+    std::vector<size_t> bucketStart(bucketCount + 1);
+    size_t total = 0;
+    for (size_t bucket = 0; bucket < bucketCount; bucket++) {
+        bucketStart[bucket] = total;
+        for (unsigned chunk = 0; chunk < chunks; chunk++) {
+            const size_t count = cursors[chunk * bucketCount + bucket];
+            cursors[chunk * bucketCount + bucket] = total;
+            total += count;
+        }
+    }
+    bucketStart[bucketCount] = total;
+
+    std::vector<uint32_t> keys(total);
+    std::vector<Value> scattered(total);
+    Parallel::forChunks(faceCount, chunks, [&](unsigned chunk, size_t begin, size_t end) {
+        size_t* cursor = &cursors[chunk * bucketCount];
+        for (size_t f = begin; f < end; f++) {
+            emit(f, [&](uint32_t vertex, const Value& value) {
+                const size_t i = cursor[vertex >> shift]++;
+                keys[i] = vertex;
+                scattered[i] = value;
+            });
+        }
+    });
+    std::vector<size_t>().swap(cursors);
+
+    // Stable counting sort of each bucket by vertex
+    offsets.assign(vertexCount + 1, 0);
+    values.resize(total);
+    Parallel::forChunks(bucketCount, Parallel::chunkCount(bucketCount, threads, 1),
+        [&](unsigned, size_t begin, size_t end) {
+            std::vector<size_t> cursor(size_t(1) << shift);
+            for (size_t bucket = begin; bucket < end; bucket++) {
+                const size_t firstVertex = bucket << shift;
+                const size_t lastVertex = std::min(vertexCount, (bucket + 1) << shift);
+                if (firstVertex >= lastVertex) continue;
+
+                std::fill(cursor.begin(), cursor.end(), 0);
+                for (size_t i = bucketStart[bucket]; i < bucketStart[bucket + 1]; i++) {
+                    cursor[keys[i] - firstVertex]++;
+                }
+                size_t next = bucketStart[bucket];
+                for (size_t v = firstVertex; v < lastVertex; v++) {
+                    offsets[v] = static_cast<uint32_t>(next);
+                    const size_t count = cursor[v - firstVertex];
+                    cursor[v - firstVertex] = next;
+                    next += count;
+                }
+                for (size_t i = bucketStart[bucket]; i < bucketStart[bucket + 1]; i++) {
+                    values[cursor[keys[i] - firstVertex]++] = scattered[i];
+                }
+            }
+        });
+    offsets[vertexCount] = static_cast<uint32_t>(total);
+}
+
+} // namespace
+
+MeshConnectivity::MeshConnectivity(size_t vertexCount, const std::vector<Face>& inputFaces,
+                                   unsigned threadCount)
+    : faces(inputFaces.size()) {
+    Trace::Scope trace("MeshConnectivity::build");
+    const unsigned threads = Parallel::resolveThreadCount(threadCount);
+    const Face* faceData = inputFaces.data();
+
+    // Faces around each vertex, each distinct corner once
+    groupByVertex<uint32_t>(vertexCount, faces, threads,
+        [faceData](size_t f, auto&& out) {
+            const Face& face = faceData[f];
+            const uint32_t index = static_cast<uint32_t>(f);
+            out(face.v1, index);
+            if (face.v2 != face.v1) out(face.v2, index);
+            if (face.v3 != face.v1 && face.v3 != face.v2) out(face.v3, index);
+        },
+        vertexFaceOffsets, vertexFaces);
+
+    // Edges of each vertex towards larger vertices, read off the faces
+    // around it. half[] collects (other vertex, face) pairs; faces come in
+    // ascending order, so sorting by both keeps each edge's faces in order.
+    const unsigned vertexChunks = Parallel::chunkCount(vertexCount, threads, kMinChunk);
+    auto gatherHalfEdges = [&](uint32_t v, std::vector<HalfEdge>& half) {
+        const Range around = facesOf(v);
+        half.resize(2 * around.size());
+        size_t count = 0;
+        for (uint32_t f : around) {
+            const Face& face = faceData[f];
+            if (face.v1 == face.v2 || face.v2 == face.v3 || face.v3 == face.v1) continue;
+            // The other two corners, picked without branches
+            const uint32_t a = face.v1 == v ? face.v2 : face.v1;
+            const uint32_t b = face.v3 == v ? face.v2 : face.v3;
+            half[count] = {a, f};
+            count += a > v;
+            half[count] = {b, f};
+            count += b > v;
+        }
+        half.resize(count);
+        std::sort(half.begin(), half.end());
+    };
+
+    // Each chunk of vertices lists its edges on its own; the lists are
+    // then copied into place in vertex order
+    edgeOffsets.assign(vertexCount + 1, 0);
+    std::vector<std::vector<Edge>> chunkEdges(vertexChunks);
+    std::vector<std::vector<uint8_t>> chunkFlags(vertexChunks);
+    Parallel::forChunks(vertexCount, vertexChunks, [&](unsigned chunk, size_t begin, size_t end) {
+        std::vector<HalfEdge> half;
+        std::vector<Edge>& out = chunkEdges[chunk];
+        std::vector<uint8_t>& flags = chunkFlags[chunk];
+        out.reserve((end - begin) * 3);
+        flags.reserve((end - begin) * 3);
+        for (size_t v = begin; v < end; v++) {
+            gatherHalfEdges(static_cast<uint32_t>(v), half);
+            const size_t before = out.size();
+            for (size_t i = 0; i < half.size();) {
+                size_t run = i + 1;
+                while (run < half.size() && half[run].other == half[i].other) run++;
+                const size_t count = run - i;
+
+                out.push_back({static_cast<uint32_t>(v), half[i].other, half[i].face,
+                               count > 1 ? half[i + 1].face : kNone});
+                flags.push_back(count == 1 ? kBoundary : (count > 2 ? kNonManifold : 0));
+                i = run;
+            }
+            edgeOffsets[v + 1] = static_cast<uint32_t>(out.size() - before);
+        }
+    });
+    std::vector<size_t> chunkStart(vertexChunks + 1, 0);
+    for (unsigned chunk = 0; chunk < vertexChunks; chunk++) {
+        chunkStart[chunk + 1] = chunkStart[chunk] + chunkEdges[chunk].size();
+    }
+    for (size_t v = 0; v < vertexCount; v++) edgeOffsets[v + 1] += edgeOffsets[v];
+
+    if (vertexChunks == 1) {
+        edges.swap(chunkEdges[0]);
+        edgeFlagValues.swap(chunkFlags[0]);
+    } else {
+        edges.resize(chunkStart[vertexChunks]);
+        edgeFlagValues.resize(edges.size());
+        Parallel::forChunks(vertexChunks, vertexChunks, [&](unsigned chunk, size_t, size_t) {
+            std::copy(chunkEdges[chunk].begin(), chunkEdges[chunk].end(), edges.begin() + chunkStart[chunk]);
+            std::copy(chunkFlags[chunk].begin(), chunkFlags[chunk].end(),
+                      edgeFlagValues.begin() + chunkStart[chunk]);
+            std::vector<Edge>().swap(chunkEdges[chunk]);
+            std::vector<uint8_t>().swap(chunkFlags[chunk]);
+        });
+    }
+
+    vertexFlagValues.assign(vertexCount, 0);
+    for (size_t e = 0; e < edges.size(); e++) {
+        const uint8_t flags = edgeFlagValues[e];
+        if (!flags) continue;
+        if (flags & kBoundary) boundaryEdges++;
+        if (flags & kNonManifold) nonManifoldEdges++;
+        vertexFlagValues[edges[e].v0] |= flags;
+        vertexFlagValues[edges[e].v1] |= flags;
+    }
+}
+
+uint32_t MeshConnectivity::findEdge(uint32_t a, uint32_t b) const {
+    if (a > b) std::swap(a, b);
+    if (b >= vertexCount()) return kNone;
+    const Edge* first = edges.data() + edgeOffsets[a];
+    const Edge* last = edges.data() + edgeOffsets[a + 1];
+    const Edge* it = std::lower_bound(first, last, b,
+        [](const Edge& edge, uint32_t v) { return edge.v1 < v; });
+    return (it != last && it->v1 == b) ? static_cast<uint32_t>(it - edges.data()) : kNone;
+}
+
+size_t MeshConnectivity::memoryBytes() const {
+    return (vertexFaceOffsets.size() + vertexFaces.size() + edgeOffsets.size()) * sizeof(uint32_t) +
+           edges.size() * sizeof(Edge) + edgeFlagValues.size() + vertexFlagValues.size();
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include "mesh.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Vertex and edge adjacency of a triangle mesh, built once and read-only.
+//
+// The faces around each vertex are stored in CSR form: one offset per
+// vertex into a single array of face indices, ascending within a vertex.
+// Edges are unique vertex pairs (v0 < v1) sorted by v0 then v1, so the
+// edges starting at a vertex are also a CSR range and findEdge is a
+// binary search. Each edge keeps its first two faces in face order; an
+// edge with one face is a boundary edge and one with more than two is
+// non-manifold. A vertex carries the flags of its edges.
+//
+// The vertex-to-face lists come from a parallel counting sort: each chunk
+// of faces scatters its corners into coarse vertex buckets, then every
+// bucket is sorted by vertex on its own. Edges are then read off the faces
+// around each vertex, in parallel over vertex ranges. The result does not
+// depend on the thread count. Degenerate faces are listed at their
+// distinct corners but add no edges. Indices and offsets are 32-bit, so
+// the mesh may have at most (2^32 - 1) / 3 faces.
+class MeshConnectivity {
+public:
+    static constexpr uint32_t kNone = 0xFFFFFFFFu;
+
+    enum Flags : uint8_t {
+        kBoundary = 1,     // Edge with a single face
+        kNonManifold = 2,  // Edge with more than two faces
+    };
+
+    struct Edge {
+        uint32_t v0, v1;        // v0 < v1
+        uint32_t face0, face1;  // face1 is kNone on boundary edges
+    };
+
+    // Contiguous run of indices in one of the CSR arrays
+    struct Range {
+        const uint32_t* first;
+        const uint32_t* last;
+
+        const uint32_t* begin() const { return first; }
+        const uint32_t* end() const { return last; }
+        size_t size() const { return static_cast<size_t>(last - first); }
+    };
+
+    // 0 threads uses one per hardware thread
+    MeshConnectivity(size_t vertexCount, const std::vector<Face>& faces, unsigned threadCount = 0);
+
+    size_t vertexCount() const { return vertexFaceOffsets.size() - 1; }
+    size_t faceCount() const { return faces; }
+    size_t edgeCount() const { return edges.size(); }
+
+    // Faces using vertex v, in ascending order
+    Range facesOf(uint32_t v) const {
+        return {vertexFaces.data() + vertexFaceOffsets[v], vertexFaces.data() + vertexFaceOffsets[v + 1]};
+    }
+
+    // Edges whose smaller vertex is v occupy [firstEdge(v), firstEdge(v + 1))
+    uint32_t firstEdge(uint32_t v) const { return edgeOffsets[v]; }
+    const Edge& edge(uint32_t e) const { return edges[e]; }
+    uint8_t edgeFlags(uint32_t e) const { return edgeFlagValues[e]; }
+    uint8_t vertexFlags(uint32_t v) const { return vertexFlagValues[v]; }
+
+    // Index of the edge between a and b, in either order, or kNone
+    uint32_t findEdge(uint32_t a, uint32_t b) const;
+
+    size_t boundaryEdgeCount() const { return boundaryEdges; }
+    size_t nonManifoldEdgeCount() const { return nonManifoldEdges; }
+    size_t memoryBytes() const;
+
+private:
+    size_t faces = 0;
+    std::vector<uint32_t> vertexFaceOffsets;  // vertexCount + 1
+    std::vector<uint32_t> vertexFaces;
+    std::vector<uint32_t> edgeOffsets;        // vertexCount + 1
+    std::vector<Edge> edges;
+    std::vector<uint8_t> edgeFlagValues;
+    std::vector<uint8_t> vertexFlagValues;
+    size_t boundaryEdges = 0;
+    size_t nonManifoldEdges = 0;
+};
@@ -0,0 +1,194 @@
+#define GL_GLEXT_PROTOTYPES
+#define GLFW_INCLUDE_GLEXT
+#include "mesh.hpp"
+#include "meshlets.hpp"
+#include "../utils/trace.hpp"
+#include <GLFW/glfw3.h>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+struct MeshGpuBuffers {
+    GLuint vertexBuffer = 0;
+    GLuint indexBuffer = 0;
+    GLsizei drawCount = 0;
+    bool indexed = false;
+
+    // Per-frame culling output and the draw ranges built from it, kept so
+    // culled frames do not allocate
+    std::vector<uint32_t> visible;
+    std::vector<GLint> firsts;
+    std::vector<GLsizei> counts;
+    std::vector<const void*> offsets;
+
+    MeshGpuBuffers() {
+        glGenBuffers(1, &vertexBuffer);
+        glGenBuffers(1, &indexBuffer);
+    }
+
+    ~MeshGpuBuffers() {
+        glDeleteBuffers(1, &vertexBuffer);
+        glDeleteBuffers(1, &indexBuffer);
+    }
+};
+
+namespace {
+
+// Interleaved layout shared by both normal modes
+struct GpuVertex {
+    Vector3 position;
+    Vector3 normal;
+};
+
+Vector3 faceNormal(const Vector3& a, const Vector3& b, const Vector3& c) {
+    Vector3 e1{b.x - a.x, b.y - a.y, b.z - a.z};
+    Vector3 e2{c.x - a.x, c.y - a.y, c.z - a.z};
+    return Vector3(e1.y * e2.z - e1.z * e2.y,
+                   e1.z * e2.x - e1.x * e2.z,
+                   e1.x * e2.y - e1.y * e2.x);
+}
+
+} // namespace
+
+void Mesh::uploadToGpu() const {
+    Trace::Scope trace("Mesh::uploadToGpu");
+    MeshGpuBuffers& buffers = *gpu.buffers;
+    std::vector<GpuVertex> staging;
+
+    if (normalMode == NormalMode::PerVertex) {
+        // Area-weighted vertex normals: sum the unnormalized face normals
+        staging.resize(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++) {
+            staging[i].position = vertices[i];
+            staging[i].normal = Vector3(0, 0, 0);
+        }
+        for (const auto& face : faces) {
+            Vector3 n = faceNormal(vertices[face.v1], vertices[face.v2], vertices[face.v3]);
+            staging[face.v1].normal += n;
+            staging[face.v2].normal += n;
+            staging[face.v3].normal += n;
+        }
+        for (auto& v : staging) {
+            float len = std::sqrt(v.normal.x * v.normal.x + v.normal.y * v.normal.y + v.normal.z * v.normal.z);
+            if (len > 1e-12f) v.normal /= len;
+        }
+
+        // Face is {v1, v2, v3, normal}, so indices are packed separately
+        std::vector<GLuint> indices;
+        indices.reserve(faces.size() * 3);
+        for (const auto& face : faces) {
+            indices.push_back(face.v1);
+            indices.push_back(face.v2);
+            indices.push_back(face.v3);
+        }
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.indexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+        buffers.drawCount = static_cast<GLsizei>(indices.size());
+        buffers.indexed = true;
+    } else {
+        // Flat shading needs the face normal on every corner
+        staging.reserve(faces.size() * 3);
+        for (const auto& face : faces) {
+            staging.push_back({vertices[face.v1], face.normal});
+            staging.push_back({vertices[face.v2], face.normal});
+            staging.push_back({vertices[face.v3], face.normal});
+        }
+
+        buffers.drawCount = static_cast<GLsizei>(staging.size());
+        buffers.indexed = false;
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, buffers.vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, staging.size() * sizeof(GpuVertex), staging.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    Trace::count("gpu_bytes_uploaded", static_cast<int64_t>(staging.size() * sizeof(GpuVertex)));
+}
+
+void Mesh::render() const {
+    draw(nullptr);
+}
+
+void Mesh::render(const ViewFrustum& view) const {
+    draw(&view);
+}
+
+void Mesh::draw(const ViewFrustum* view) const {
+    if (faces.empty()) return;
+    Trace::Scope trace("Mesh::render");
+
+    if (!gpu.buffers) {
+        gpu.buffers = std::make_shared<MeshGpuBuffers>();
+        gpu.dirty = true;
+    }
+    if (gpu.dirty) {
+        uploadToGpu();
+        gpu.dirty = false;
+    }
+
+    MeshGpuBuffers& buffers = *gpu.buffers;
+
+    // Visible meshlets as runs of faces, adjacent meshlets merged into one
+    // run; each face is three indices, or three vertices when flat
+    const bool culled = view && meshlets;
+    if (culled) {
+        const Meshlets::CullStats stats = meshlets->cull(*view, buffers.visible);
+        buffers.firsts.clear();
+        buffers.counts.clear();
+        GLint runEnd = -1;
+        for (uint32_t i : buffers.visible) {
+            const Meshlets::Meshlet& m = meshlets->get()[i];
+            const GLint first = static_cast<GLint>(3 * m.firstFace);
+            const GLsizei count = static_cast<GLsizei>(3 * m.faceCount);
+            if (first == runEnd) {
+                buffers.counts.back() += count;
+            } else {
+                buffers.firsts.push_back(first);
+                buffers.counts.push_back(count);
+            }
+            runEnd = first + count;
+        }
+        Trace::count("meshlets_visible", static_cast<int64_t>(stats.visible));
+        Trace::count("meshlets_outside_frustum", static_cast<int64_t>(stats.outsideFrustum));
+        Trace::count("meshlets_backfacing", static_cast<int64_t>(stats.backfacing));
+        Trace::count("faces_submitted", static_cast<int64_t>(stats.visibleFaces));
+    } else {
+        Trace::count("faces_submitted", static_cast<int64_t>(faces.size()));
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, buffers.vertexBuffer);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glVertexPointer(3, GL_FLOAT, sizeof(GpuVertex),
+                    reinterpret_cast<const void*>(offsetof(GpuVertex, position)));
+    glNormalPointer(GL_FLOAT, sizeof(GpuVertex),
+                    reinterpret_cast<const void*>(offsetof(GpuVertex, normal)));
+
+    const GLsizei runs = static_cast<GLsizei>(buffers.firsts.size());
+    if (buffers.indexed) {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.indexBuffer);
+        if (culled) {
+            buffers.offsets.resize(buffers.firsts.size());
+            for (size_t r = 0; r < buffers.firsts.size(); r++) {
+                buffers.offsets[r] = reinterpret_cast<const void*>(buffers.firsts[r] * sizeof(GLuint));
+            }
+            if (runs > 0) {
+                glMultiDrawElements(GL_TRIANGLES, buffers.counts.data(), GL_UNSIGNED_INT,
+                                    buffers.offsets.data(), runs);
+            }
+        } else {
+            glDrawElements(GL_TRIANGLES, buffers.drawCount, GL_UNSIGNED_INT, nullptr);
+        }
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    } else if (culled) {
+        if (runs > 0) glMultiDrawArrays(GL_TRIANGLES, buffers.firsts.data(), buffers.counts.data(), runs);
+    } else {
+        glDrawArrays(GL_TRIANGLES, 0, buffers.drawCount);
+    }
+
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,248 @@
+#include "meshlets.hpp"
+#include "mesh_connectivity.hpp"
+#include "../utils/parallel.hpp"
+#include "../utils/trace.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const uint32_t kNone = 0xFFFFFFFFu;
+
+// Meshlets per thread below which bounds and culling stay on one thread
+const size_t kMinChunk = 4096;
+
+// Classification written by the cull pass before compaction
+const uint32_t kVisible = 0;
+const uint32_t kOutside = 1;
+const uint32_t kBackfacing = 2;
+
+inline Vector3 sub(const Vector3& a, const Vector3& b) { return Vector3(a.x - b.x, a.y - b.y, a.z - b.z); }
+inline float dot(const Vector3& a, const Vector3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline float lengthOf(const Vector3& v) { return std::sqrt(dot(v, v)); }
+
+inline Vector3 cross(const Vector3& a, const Vector3& b) {
+    return Vector3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+
+// Unit inward normal of a side plane through the eye: points p with
+// dot(p - eye, n) >= 0 are on the visible side
+inline Vector3 sidePlane(const Vector3& forward, float slope, const Vector3& side, float sign) {
+    Vector3 n(forward.x * slope - side.x * sign, forward.y * slope - side.y * sign,
+              forward.z * slope - side.z * sign);
+    n /= lengthOf(n);
+    return n;
+}
+
+} // namespace
+
+Meshlets::Meshlets(const std::vector<Vector3>& vertices, std::vector<Face>& faces, unsigned threadCount) {
+    Trace::Scope trace("Meshlets::build");
+    if (faces.empty()) return;
+    const MeshConnectivity adjacency(vertices.size(), faces, threadCount);
+
+    std::vector<Vector3> centroids(faces.size());
+    for (size_t f = 0; f < faces.size(); f++) {
+        const Vector3& a = vertices[faces[f].v1];
+        const Vector3& b = vertices[faces[f].v2];
+        const Vector3& c = vertices[faces[f].v3];
+        centroids[f] = Vector3((a.x + b.x + c.x) / 3.0f, (a.y + b.y + c.y) / 3.0f, (a.z + b.z + c.z) / 3.0f);
+    }
+
+    std::vector<uint8_t> placed(faces.size(), 0);
+    std::vector<uint32_t> owner(vertices.size(), kNone);  // Meshlet holding each vertex
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> candidates;
+    order.reserve(faces.size());
+    size_t scan = 0;
+
+    while (order.size() < faces.size()) {
+        // Rim faces with the fewest unplaced neighbours go first, so
+        // corners between patches fill up instead of becoming fragments
+        uint32_t face = kNone;
+        uint32_t fewest = kNone;
+        for (uint32_t c : candidates) {
+            if (placed[c]) continue;
+            uint32_t live = 0;
+            for (uint32_t v : {faces[c].v1, faces[c].v2, faces[c].v3}) {
+                for (uint32_t g : adjacency.facesOf(v)) live += !placed[g];
+            }
+            if (live < fewest || (live == fewest && c < face)) {
+                face = c;
+                fewest = live;
+            }
+        }
+        if (face == kNone) {
+            while (placed[scan]) scan++;
+            face = static_cast<uint32_t>(scan);
+        }
+        candidates.clear();
+
+        const uint32_t id = static_cast<uint32_t>(meshlets.size());
+        Meshlet meshlet;
+        meshlet.firstFace = static_cast<uint32_t>(order.size());
+        Vector3 sum(0.0f, 0.0f, 0.0f);
+
+        // Corners of f not yet in this meshlet, each counted once
+        auto newCorners = [&](uint32_t f) {
+            const uint32_t a = faces[f].v1, b = faces[f].v2, c = faces[f].v3;
+            return (owner[a] != id) + (owner[b] != id && b != a) + (owner[c] != id && c != a && c != b);
+        };
+
+        while (true) {
+            placed[face] = 1;
+            order.push_back(face);
+            meshlet.faceCount++;
+            sum += centroids[face];
+            for (uint32_t v : {faces[face].v1, faces[face].v2, faces[face].v3}) {
+                if (owner[v] == id) continue;
+                owner[v] = id;
+                meshlet.vertexCount++;
+                for (uint32_t g : adjacency.facesOf(v)) {
+                    if (!placed[g]) candidates.push_back(g);
+                }
+            }
+            if (meshlet.faceCount == kMaxFaces) break;
+
+            // Fewest new vertices that still fit, then nearest the centroid.
+            // Placed faces are dropped from the list on the way.
+            const Vector3 center(sum.x / meshlet.faceCount, sum.y / meshlet.faceCount, sum.z / meshlet.faceCount);
+            uint32_t best = kNone;
+            uint32_t bestNew = 4;
+            float bestDistance = 0.0f;
+            for (size_t k = 0; k < candidates.size();) {
+                const uint32_t g = candidates[k];
+                if (placed[g]) {
+                    candidates[k] = candidates.back();
+                    candidates.pop_back();
+                    continue;
+                }
+                k++;
+                const uint32_t added = newCorners(g);
+                if (meshlet.vertexCount + added > kMaxVertices || added > bestNew) continue;
+                const Vector3 d = sub(centroids[g], center);
+                const float distance = dot(d, d);
+                if (added < bestNew || distance < bestDistance || (distance == bestDistance && g < best)) {
+                    best = g;
+                    bestNew = added;
+                    bestDistance = distance;
+                }
+            }
+            if (best == kNone) break;
+            face = best;
+        }
+        meshlets.push_back(meshlet);
+    }
+
+    std::vector<Face> ordered;
+    ordered.reserve(faces.size());
+    for (uint32_t f : order) ordered.push_back(faces[f]);
+    faces.swap(ordered);
+
+    computeBounds(vertices, faces, threadCount);
+    Trace::count("meshlets_built", static_cast<int64_t>(meshlets.size()));
+}
+
+void Meshlets::computeBounds(const std::vector<Vector3>& vertices, const std::vector<Face>& faces,
+                             unsigned threadCount) {
+    const unsigned chunks = Parallel::chunkCount(meshlets.size(), Parallel::resolveThreadCount(threadCount), kMinChunk);
+    Parallel::forChunks(meshlets.size(), chunks, [&](unsigned, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            Meshlet& m = meshlets[i];
+            const Face* first = faces.data() + m.firstFace;
+            const Face* last = first + m.faceCount;
+
+            // Sphere around the box center reaching the farthest corner
+            Vector3 min = vertices[first->v1], max = min;
+            for (const Face* f = first; f != last; f++) {
+                for (uint32_t v : {f->v1, f->v2, f->v3}) {
+                    const Vector3& p = vertices[v];
+                    min = Vector3(std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z));
+                    max = Vector3(std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z));
+                }
+            }
+            m.center = Vector3((min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f);
+            float radius2 = 0.0f;
+            for (const Face* f = first; f != last; f++) {
+                for (uint32_t v : {f->v1, f->v2, f->v3}) {
+                    const Vector3 d = sub(vertices[v], m.center);
+                    radius2 = std::max(radius2, dot(d, d));
+                }
+            }
+            m.radius = std::sqrt(radius2);
+
+            // Cone around the mean unit normal; degenerate faces face nowhere
+            Vector3 axis(0.0f, 0.0f, 0.0f);
+            for (const Face* f = first; f != last; f++) {
+                Vector3 n = cross(sub(vertices[f->v2], vertices[f->v1]), sub(vertices[f->v3], vertices[f->v1]));
+                const float length = lengthOf(n);
+                if (length <= 0.0f) continue;
+                n /= length;
+                axis += n;
+            }
+            const float axisLength = lengthOf(axis);
+            m.coneCutoff = 1.0f;
+            m.coneAxis = Vector3(0.0f, 0.0f, 0.0f);
+            if (axisLength <= 0.0f) continue;
+            axis /= axisLength;
+            float minDot = 1.0f;
+            for (const Face* f = first; f != last; f++) {
+                Vector3 n = cross(sub(vertices[f->v2], vertices[f->v1]), sub(vertices[f->v3], vertices[f->v1]));
+                const float length = lengthOf(n);
+                if (length > 0.0f) minDot = std::min(minDot, dot(n, axis) / length);
+            }
+            m.coneAxis = axis;
+            if (minDot > 0.0f) m.coneCutoff = std::sqrt(std::max(0.0f, 1.0f - minDot * minDot));
+        }
+    });
+}
+
+Meshlets::CullStats Meshlets::cull(const ViewFrustum& view, std::vector<uint32_t>& visible,
+                                   unsigned threadCount) const {
+    Trace::Scope trace("Meshlets::cull");
+    const float tanX = view.tanHalfFovY * view.aspect;
+    const Vector3 sides[4] = {
+        sidePlane(view.forward, tanX, view.right, 1.0f),
+        sidePlane(view.forward, tanX, view.right, -1.0f),
+        sidePlane(view.forward, view.tanHalfFovY, view.up, 1.0f),
+        sidePlane(view.forward, view.tanHalfFovY, view.up, -1.0f),
+    };
+
+    // Classify in place, then compact in order
+    visible.resize(meshlets.size());
+    const unsigned chunks = Parallel::chunkCount(meshlets.size(), Parallel::resolveThreadCount(threadCount), kMinChunk);
+    Parallel::forChunks(meshlets.size(), chunks, [&](unsigned, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const Meshlet& m = meshlets[i];
+            const Vector3 d = sub(m.center, view.eye);
+            const float depth = dot(d, view.forward);
+            bool inside = depth + m.radius >= view.zNear && depth - m.radius <= view.zFar;
+            for (int s = 0; s < 4 && inside; s++) inside = dot(d, sides[s]) >= -m.radius;
+            if (!inside) {
+                visible[i] = kOutside;
+                continue;
+            }
+
+            // Every view ray into the sphere meets every normal in the cone
+            // at less than 90 degrees
+            const bool backfacing = m.coneCutoff < 1.0f &&
+                                    dot(d, m.coneAxis) >= m.coneCutoff * lengthOf(d) + m.radius;
+            visible[i] = backfacing ? kBackfacing : kVisible;
+        }
+    });
+
+    CullStats stats;
+    for (size_t i = 0; i < meshlets.size(); i++) {
+        const uint32_t state = visible[i];
+        if (state == kOutside) {
+            stats.outsideFrustum++;
+        } else if (state == kBackfacing) {
+            stats.backfacing++;
+        } else {
+            visible[stats.visible++] = static_cast<uint32_t>(i);
+            stats.visibleFaces += meshlets[i].faceCount;
+        }
+    }
+    visible.resize(stats.visible);
+    return stats;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "mesh.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Symmetric perspective view volume: from eye along forward, with right
+// and up the screen axes. The basis vectors must be unit length and
+// orthogonal (Camera::getView gives them).
+struct ViewFrustum {
+    Vector3 eye;
+    Vector3 forward{0.0f, 0.0f, -1.0f};
+    Vector3 right{1.0f, 0.0f, 0.0f};
+    Vector3 up{0.0f, 1.0f, 0.0f};
+    float tanHalfFovY = 1.0f;
+    float aspect = 1.0f;  // Width over height
+    float zNear = 0.1f;
+    float zFar = 100.0f;
+};
+
+// Splits a triangle mesh into meshlets, small patches of at most
+// kMaxVertices distinct vertices and kMaxFaces triangles, so a renderer can
+// skip whole patches the camera cannot see.
+//
+// Meshlets are grown one at a time from a seed face. Each step adds the
+// face sharing a vertex with the patch that brings in the fewest new
+// vertices, ties going to the face nearest the patch centroid, until no
+// face fits. The next seed is a face left over at the previous patch's
+// rim, or else the first face not yet placed. The faces are then reordered
+// so every meshlet is a contiguous run, which lets one draw call cover any
+// run of visible neighbours.
+//
+// Each meshlet carries a bounding sphere of its vertices and a cone
+// holding its face normals (axis and the sine of its half angle). cull()
+// drops meshlets whose sphere lies outside the frustum, and those whose
+// cone faces away from the eye from every point of the sphere, which
+// makes them entirely backfacing. Meshlets are classified in parallel;
+// the result does not depend on the thread count.
+class Meshlets {
+public:
+    static constexpr uint32_t kMaxVertices = 64;
+    static constexpr uint32_t kMaxFaces = 126;
+
+    struct Meshlet {
+        uint32_t firstFace = 0;
+        uint32_t faceCount = 0;
+        uint32_t vertexCount = 0;
+        Vector3 center;  // Bounding sphere
+        float radius = 0.0f;
+        Vector3 coneAxis;
+        float coneCutoff = 1.0f;  // Sine of the cone half angle; 1 never culls
+    };
+
+    struct CullStats {
+        size_t visible = 0;
+        size_t outsideFrustum = 0;
+        size_t backfacing = 0;
+        size_t visibleFaces = 0;
+    };
+
+    // Builds meshlets over faces and reorders faces into meshlet order; the
+    // surface is unchanged. 0 threads uses one per hardware thread.
+    Meshlets(const std::vector<Vector3>& vertices, std::vector<Face>& faces, unsigned threadCount = 0);
+
+    size_t size() const { return meshlets.size(); }
+    const std::vector<Meshlet>& get() const { return meshlets; }
+
+    // Fills visible with the meshlets that may be seen from view, in
+    // ascending order, keeping its capacity between calls
+    CullStats cull(const ViewFrustum& view, std::vector<uint32_t>& visible, unsigned threadCount = 0) const;
+
+private:
+    std::vector<Meshlet> meshlets;
+
+    void computeBounds(const std::vector<Vector3>& vertices, const std::vector<Face>& faces, unsigned threadCount);
+};
@@ -0,0 +1,159 @@
+#include "spatial_order.hpp"
+#include "vertex_kernels.hpp"
+#include "../utils/parallel.hpp"
+#include "../utils/trace.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// Inputs smaller than this per thread are not worth splitting
+const size_t kMinChunk = 65536;
+
+// 11-bit digits sort 63-bit keys in six passes with 2K buckets per chunk
+const int kDigitBits = 11;
+const size_t kBuckets = size_t(1) << kDigitBits;
+
+// Largest cell index per axis
+const float kLastCell = 2097151.0f;
+
+// Spreads the low 21 bits of v so that two zero bits follow each one
+uint64_t spreadBits(uint32_t v) {
+    uint64_t x = v & 0x1FFFFF;
+    x = (x | x << 32) & 0x1F00000000FFFFULL;
+    x = (x | x << 16) & 0x1F0000FF0000FFULL;
+    x = (x | x << 8) & 0x100F00F00F00F00FULL;
+    x = (x | x << 4) & 0x10C30C30C30C30C3ULL;
+    x = (x | x << 2) & 0x1249249249249249ULL;
+    return x;
+}
+
+} // namespace
+
+namespace SpatialOrder {
+
+uint64_t mortonCode(uint32_t x, uint32_t y, uint32_t z) {
+    return spreadBits(x) | (spreadBits(y) << 1) | (spreadBits(z) << 2);
+}
+
+void radixSort(std::vector<uint64_t>& keys, std::vector<uint32_t>& values, unsigned threadCount) {
+    const size_t count = keys.size();
+    if (count < 2) return;
+    const unsigned chunks = Parallel::chunkCount(count, Parallel::resolveThreadCount(threadCount), kMinChunk);
+
+    // Bits that differ from the first key somewhere; digits without any
+    // are the same for every key
+    std::vector<uint64_t> chunkVarying(chunks, 0);
+    Parallel::forChunks(count, chunks, [&](unsigned chunk, size_t begin, size_t end) {
+        uint64_t varying = 0;
+        for (size_t i = begin; i < end; i++) varying |= keys[i] ^ keys[0];
+        chunkVarying[chunk] = varying;
+    });
+    uint64_t varying = 0;
+    for (uint64_t bits : chunkVarying) varying |= bits;
+
+    std::vector<uint64_t> keyBuffer(count);
+    std::vector<uint32_t> valueBuffer(count);
+    std::vector<size_t> cursors(chunks * kBuckets);
+    for (int shift = 0; shift < 64; shift += kDigitBits) {
+        if (((varying >> shift) & (kBuckets - 1)) == 0) continue;
+
+        std::fill(cursors.begin(), cursors.end(), 0);
+        Parallel::forChunks(count, chunks, [&](unsigned chunk, size_t begin, size_t end) {
+            size_t* counts = &cursors[chunk * kBuckets];
+            for (size_t i = begin; i < end; i++) counts[(keys[i] >> shift) & (kBuckets - 1)]++;
+        });
+
+        // Digit-major prefix sum with the chunks of a digit in order keeps
+        // the pass stable
+        size_t total = 0;
+        for (size_t bucket = 0; bucket < kBuckets; bucket++) {
+            for (unsigned chunk = 0; chunk < chunks; chunk++) {
+                const size_t bucketCount = cursors[chunk * kBuckets + bucket];
+                cursors[chunk * kBuckets + bucket] = total;
+                total += bucketCount;
+            }
+        }
+
+        Parallel::forChunks(count, chunks, [&](unsigned chunk, size_t begin, size_t end) {
+            size_t* next = &cursors[chunk * kBuckets];
+            for (size_t i = begin; i < end; i++) {
+                const size_t slot = next[(keys[i] >> shift) & (kBuckets - 1)]++;
+                keyBuffer[slot] = keys[i];
+                valueBuffer[slot] = values[i];
+            }
+        });
+        keys.swap(keyBuffer);
+        values.swap(valueBuffer);
+    }
+}
+
+void curveOrder(const std::vector<Vector3>& points, const Vector3& min, const Vector3& max,
+                std::vector<uint32_t>& order, unsigned threadCount) {
+    const unsigned threads = Parallel::resolveThreadCount(threadCount);
+    const float extent = std::max({max.x - min.x, max.y - min.y, max.z - min.z});
+    const float scale = extent > 0.0f ? kLastCell / extent : 0.0f;
+
+    const size_t count = points.size();
+    std::vector<uint64_t> keys(count);
+    order.resize(count);
+    Parallel::forChunks(count, Parallel::chunkCount(count, threads, kMinChunk),
+        [&](unsigned, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                const Vector3& v = points[i];
+                keys[i] = mortonCode(static_cast<uint32_t>(VertexKernels::cellIndex(v.x, min.x, scale, kLastCell)),
+                                     static_cast<uint32_t>(VertexKernels::cellIndex(v.y, min.y, scale, kLastCell)),
+                                     static_cast<uint32_t>(VertexKernels::cellIndex(v.z, min.z, scale, kLastCell)));
+                order[i] = static_cast<uint32_t>(i);
+            }
+        });
+    radixSort(keys, order, threads);
+}
+
+void sortMesh(std::vector<Vector3>& vertices, std::vector<Face>& faces,
+              const Vector3& min, const Vector3& max, unsigned threadCount) {
+    if (vertices.empty()) return;
+    Trace::Scope trace("SpatialOrder::sortMesh");
+    const unsigned threads = Parallel::resolveThreadCount(threadCount);
+
+    const size_t vertexCount = vertices.size();
+    std::vector<uint32_t> order;
+    curveOrder(vertices, min, max, order, threads);
+    unsigned chunks = Parallel::chunkCount(vertexCount, threads, kMinChunk);
+
+    // order[i] is the old index of new vertex i
+    std::vector<Vector3> sortedVertices(vertexCount);
+    std::vector<uint32_t> remap(vertexCount);
+    Parallel::forChunks(vertexCount, chunks, [&](unsigned, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            sortedVertices[i] = vertices[order[i]];
+            remap[order[i]] = static_cast<uint32_t>(i);
+        }
+    });
+    vertices.swap(sortedVertices);
+
+    const size_t faceCount = faces.size();
+    if (faceCount == 0) return;
+    std::vector<uint64_t> keys(faceCount);
+    order.resize(faceCount);
+    chunks = Parallel::chunkCount(faceCount, threads, kMinChunk);
+    Parallel::forChunks(faceCount, chunks, [&](unsigned, size_t begin, size_t end) {
+        for (size_t f = begin; f < end; f++) {
+            Face& face = faces[f];
+            face.v1 = remap[face.v1];
+            face.v2 = remap[face.v2];
+            face.v3 = remap[face.v3];
+            keys[f] = std::min({face.v1, face.v2, face.v3});
+            order[f] = static_cast<uint32_t>(f);
+        }
+    });
+    radixSort(keys, order, threads);
+
+    std::vector<Face> sortedFaces(faceCount, Face(0, 0, 0));
+    Parallel::forChunks(faceCount, chunks, [&](unsigned, size_t begin, size_t end) {
+        for (size_t f = begin; f < end; f++) sortedFaces[f] = faces[order[f]];
+    });
+    faces.swap(sortedFaces);
+}
+
+} // namespace SpatialOrder
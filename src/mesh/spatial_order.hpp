@@ -0,0 +1,40 @@
+#pragma once
+#include "mesh.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Reorders vertices and faces along a Z-order (Morton) curve so that
+// passes over the mesh touch memory in spatial order.
+//
+// Each vertex is quantized to 21 bits per axis inside the bounding box
+// (one scale for all axes, so cells are cubes) and its coordinates are
+// bit-interleaved into a 63-bit key. Vertices are sorted by key, faces are
+// renumbered, and faces are then sorted by their smallest new vertex
+// index, which is the rank of their first vertex along the curve. Both
+// sorts are stable, so ties keep file order and the result does not depend
+// on the thread count. Anything that walks vertices or faces in order,
+// such as the normal and clustering passes, then reads nearby positions
+// and lands in nearby cells one after another.
+namespace SpatialOrder {
+
+// Interleaves the low 21 bits of x, y and z, x in the lowest bit
+uint64_t mortonCode(uint32_t x, uint32_t y, uint32_t z);
+
+// Stable LSD radix sort of keys, carrying values along. Passes whose digit
+// is the same for every key are skipped. 0 threads uses one per hardware
+// thread.
+void radixSort(std::vector<uint64_t>& keys, std::vector<uint32_t>& values, unsigned threadCount = 0);
+
+// order[i] receives the index of the i-th point along the curve through the
+// box [min, max], ties in input order
+void curveOrder(const std::vector<Vector3>& points, const Vector3& min, const Vector3& max,
+                std::vector<uint32_t>& order, unsigned threadCount = 0);
+
+// Sorts vertices along the curve through the box [min, max], renumbers the
+// faces and sorts them by their smallest vertex. Face normals move with
+// their faces.
+void sortMesh(std::vector<Vector3>& vertices, std::vector<Face>& faces,
+              const Vector3& min, const Vector3& max, unsigned threadCount = 0);
+
+} // namespace SpatialOrder
@@ -0,0 +1,461 @@
+#include "vertex_kernels.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define MESH_KERNELS_X86 1
+#include <immintrin.h>
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace VertexKernels {
+
+namespace {
+
+Isa supportedIsa() {
+#ifdef MESH_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return Isa::AVX2;
+    if (__builtin_cpu_supports("sse4.1")) return Isa::SSE41;
+#endif
+    return Isa::Scalar;
+}
+
+Isa clampIsa(Isa isa) {
+    static const Isa supported = supportedIsa();
+    return static_cast<int>(isa) <= static_cast<int>(supported) ? isa : supported;
+}
+
+Isa initialIsa() {
+    Isa isa = Isa::AVX2;
+    if (const char* name = std::getenv("MESH_SIMD")) {
+        if (std::strcmp(name, "scalar") == 0) isa = Isa::Scalar;
+        else if (std::strcmp(name, "sse") == 0) isa = Isa::SSE41;
+    }
+    return clampIsa(isa);
+}
+
+std::atomic<Isa>& currentIsa() {
+    static std::atomic<Isa> isa{initialIsa()};
+    return isa;
+}
+
+// ---- Scalar ----
+
+void boundsScalar(const float* x, const float* y, const float* z, size_t begin, size_t count,
+                  Vector3& min, Vector3& max) {
+    for (size_t i = begin; i < count; i++) {
+        min.x = std::min(min.x, x[i]);
+        min.y = std::min(min.y, y[i]);
+        min.z = std::min(min.z, z[i]);
+        max.x = std::max(max.x, x[i]);
+        max.y = std::max(max.y, y[i]);
+        max.z = std::max(max.z, z[i]);
+    }
+}
+
+void centerAndScaleScalar(float* x, float* y, float* z, size_t begin, size_t count,
+                          const Vector3& center, float scale) {
+    for (size_t i = begin; i < count; i++) {
+        x[i] = (x[i] - center.x) / scale;
+        y[i] = (y[i] - center.y) / scale;
+        z[i] = (z[i] - center.z) / scale;
+    }
+}
+
+void rigidTransformScalar(float* x, float* y, float* z, size_t begin, size_t count,
+                          const float r[9], const Vector3& t) {
+    for (size_t i = begin; i < count; i++) {
+        const float px = x[i], py = y[i], pz = z[i];
+        x[i] = r[0] * px + r[1] * py + r[2] * pz + t.x;
+        y[i] = r[3] * px + r[4] * py + r[5] * pz + t.y;
+        z[i] = r[6] * px + r[7] * py + r[8] * pz + t.z;
+    }
+}
+
+void faceNormalsScalar(const float* x, const float* y, const float* z,
+                       Face* faces, size_t begin, size_t count) {
+    for (size_t f = begin; f < count; f++) {
+        Face& face = faces[f];
+        const float e1x = x[face.v2] - x[face.v1], e1y = y[face.v2] - y[face.v1], e1z = z[face.v2] - z[face.v1];
+        const float e2x = x[face.v3] - x[face.v1], e2y = y[face.v3] - y[face.v1], e2z = z[face.v3] - z[face.v1];
+
+        Vector3 n(e1y * e2z - e1z * e2y, e1z * e2x - e1x * e2z, e1x * e2y - e1y * e2x);
+        const float len = std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+        if (len > 1e-6f) n /= len;
+        face.normal = n;
+    }
+}
+
+void quantizeScalar(const float* x, const float* y, const float* z, size_t begin, size_t count,
+                    const Vector3& min, const float cellScale[3], int gridSize, uint64_t* keys) {
+    const float last = static_cast<float>(gridSize - 1);
+    const uint64_t g = static_cast<uint64_t>(gridSize);
+    for (size_t i = begin; i < count; i++) {
+        keys[i] = cellIndex(x[i], min.x, cellScale[0], last) +
+                  g * (cellIndex(y[i], min.y, cellScale[1], last) +
+                       g * cellIndex(z[i], min.z, cellScale[2], last));
+    }
+}
+
+#ifdef MESH_KERNELS_X86
+
+// ---- SSE4.1 ----
+
+TARGET_SSE41 float reduceMin(__m128 v) {
+    v = _mm_min_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_min_ss(v, _mm_shuffle_ps(v, v, 1));
+    return _mm_cvtss_f32(v);
+}
+
+TARGET_SSE41 float reduceMax(__m128 v) {
+    v = _mm_max_ps(v, _mm_movehl_ps(v, v));
+    v = _mm_max_ss(v, _mm_shuffle_ps(v, v, 1));
+    return _mm_cvtss_f32(v);
+}
+
+TARGET_SSE41 void boundsSse(const float* x, const float* y, const float* z, size_t count,
+                            Vector3& min, Vector3& max) {
+    __m128 minX = _mm_set1_ps(x[0]), minY = _mm_set1_ps(y[0]), minZ = _mm_set1_ps(z[0]);
+    __m128 maxX = minX, maxY = minY, maxZ = minZ;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 vx = _mm_loadu_ps(x + i), vy = _mm_loadu_ps(y + i), vz = _mm_loadu_ps(z + i);
+        minX = _mm_min_ps(minX, vx); maxX = _mm_max_ps(maxX, vx);
+        minY = _mm_min_ps(minY, vy); maxY = _mm_max_ps(maxY, vy);
+        minZ = _mm_min_ps(minZ, vz); maxZ = _mm_max_ps(maxZ, vz);
+    }
+    min = Vector3(reduceMin(minX), reduceMin(minY), reduceMin(minZ));
+    max = Vector3(reduceMax(maxX), reduceMax(maxY), reduceMax(maxZ));
+    boundsScalar(x, y, z, i, count, min, max);
+}
+
+TARGET_SSE41 void centerAndScaleSse(float* x, float* y, float* z, size_t count,
+                                    const Vector3& center, float scale) {
+    const __m128 cx = _mm_set1_ps(center.x), cy = _mm_set1_ps(center.y), cz = _mm_set1_ps(center.z);
+    const __m128 s = _mm_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(x + i, _mm_div_ps(_mm_sub_ps(_mm_loadu_ps(x + i), cx), s));
+        _mm_storeu_ps(y + i, _mm_div_ps(_mm_sub_ps(_mm_loadu_ps(y + i), cy), s));
+        _mm_storeu_ps(z + i, _mm_div_ps(_mm_sub_ps(_mm_loadu_ps(z + i), cz), s));
+    }
+    centerAndScaleScalar(x, y, z, i, count, center, scale);
+}
+
+// Sums in the scalar order, without FMA, so results match bit for bit
+TARGET_SSE41 void rigidTransformSse(float* x, float* y, float* z, size_t count,
+                                    const float r[9], const Vector3& t) {
+    __m128 m[9];
+    for (int k = 0; k < 9; k++) m[k] = _mm_set1_ps(r[k]);
+    const __m128 tx = _mm_set1_ps(t.x), ty = _mm_set1_ps(t.y), tz = _mm_set1_ps(t.z);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 px = _mm_loadu_ps(x + i), py = _mm_loadu_ps(y + i), pz = _mm_loadu_ps(z + i);
+        _mm_storeu_ps(x + i, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0], px), _mm_mul_ps(m[1], py)),
+                                                   _mm_mul_ps(m[2], pz)), tx));
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m[3], px), _mm_mul_ps(m[4], py)),
+                                                   _mm_mul_ps(m[5], pz)), ty));
+        _mm_storeu_ps(z + i, _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m[6], px), _mm_mul_ps(m[7], py)),
+                                                   _mm_mul_ps(m[8], pz)), tz));
+    }
+    rigidTransformScalar(x, y, z, i, count, r, t);
+}
+
+// Normalizes (nx, ny, nz) where its squared length exceeds the 1e-6 length
+// threshold, using rsqrt plus one Newton-Raphson step
+TARGET_SSE41 void normalizeSse(__m128& nx, __m128& ny, __m128& nz) {
+    const __m128 lenSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz));
+    __m128 inv = _mm_rsqrt_ps(lenSq);
+    inv = _mm_mul_ps(inv, _mm_sub_ps(_mm_set1_ps(1.5f),
+                                     _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), lenSq), _mm_mul_ps(inv, inv))));
+    const __m128 keep = _mm_cmpgt_ps(lenSq, _mm_set1_ps(1e-12f));
+    nx = _mm_blendv_ps(nx, _mm_mul_ps(nx, inv), keep);
+    ny = _mm_blendv_ps(ny, _mm_mul_ps(ny, inv), keep);
+    nz = _mm_blendv_ps(nz, _mm_mul_ps(nz, inv), keep);
+}
+
+TARGET_SSE41 void faceNormalsSse(const float* x, const float* y, const float* z,
+                                 Face* faces, size_t count) {
+    size_t f = 0;
+    for (; f + 4 <= count; f += 4) {
+        const Face* q = faces + f;
+        auto gather = [&](const float* p, unsigned Face::*corner) {
+            return _mm_setr_ps(p[q[0].*corner], p[q[1].*corner], p[q[2].*corner], p[q[3].*corner]);
+        };
+        const __m128 ax = gather(x, &Face::v1), ay = gather(y, &Face::v1), az = gather(z, &Face::v1);
+        const __m128 e1x = _mm_sub_ps(gather(x, &Face::v2), ax);
+        const __m128 e1y = _mm_sub_ps(gather(y, &Face::v2), ay);
+        const __m128 e1z = _mm_sub_ps(gather(z, &Face::v2), az);
+        const __m128 e2x = _mm_sub_ps(gather(x, &Face::v3), ax);
+        const __m128 e2y = _mm_sub_ps(gather(y, &Face::v3), ay);
+        const __m128 e2z = _mm_sub_ps(gather(z, &Face::v3), az);
+
+        __m128 nx = _mm_sub_ps(_mm_mul_ps(e1y, e2z), _mm_mul_ps(e1z, e2y));
+        __m128 ny = _mm_sub_ps(_mm_mul_ps(e1z, e2x), _mm_mul_ps(e1x, e2z));
+        __m128 nz = _mm_sub_ps(_mm_mul_ps(e1x, e2y), _mm_mul_ps(e1y, e2x));
+        normalizeSse(nx, ny, nz);
+
+        alignas(16) float out[3][4];
+        _mm_store_ps(out[0], nx);
+        _mm_store_ps(out[1], ny);
+        _mm_store_ps(out[2], nz);
+        for (int k = 0; k < 4; k++) faces[f + k].normal = Vector3(out[0][k], out[1][k], out[2][k]);
+    }
+    faceNormalsScalar(x, y, z, faces, f, count);
+}
+
+// Keys are formed in 32 bits, so this needs gridSize^3 <= 2^32
+TARGET_SSE41 void quantizeSse(const float* x, const float* y, const float* z, size_t count,
+                              const Vector3& min, const float cellScale[3], int gridSize, uint64_t* keys) {
+    const __m128 minX = _mm_set1_ps(min.x), minY = _mm_set1_ps(min.y), minZ = _mm_set1_ps(min.z);
+    const __m128 scaleX = _mm_set1_ps(cellScale[0]);
+    const __m128 scaleY = _mm_set1_ps(cellScale[1]);
+    const __m128 scaleZ = _mm_set1_ps(cellScale[2]);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 last = _mm_set1_ps(static_cast<float>(gridSize - 1));
+    const __m128i g = _mm_set1_epi32(gridSize);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i cx = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(
+            _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(x + i), minX), scaleX), zero), last));
+        const __m128i cy = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(
+            _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(y + i), minY), scaleY), zero), last));
+        const __m128i cz = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(
+            _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(z + i), minZ), scaleZ), zero), last));
+        const __m128i key = _mm_add_epi32(cx, _mm_mullo_epi32(g, _mm_add_epi32(cy, _mm_mullo_epi32(g, cz))));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(keys + i), _mm_cvtepu32_epi64(key));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(keys + i + 2), _mm_cvtepu32_epi64(_mm_unpackhi_epi64(key, key)));
+    }
+    quantizeScalar(x, y, z, i, count, min, cellScale, gridSize, keys);
+}
+
+// ---- AVX2 ----
+
+// Folds the upper 128-bit half onto the lower one
+TARGET_AVX2 __m128 foldMin(__m256 v) {
+    return _mm_min_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+}
+
+TARGET_AVX2 __m128 foldMax(__m256 v) {
+    return _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+}
+
+TARGET_AVX2 void boundsAvx2(const float* x, const float* y, const float* z, size_t count,
+                            Vector3& min, Vector3& max) {
+    __m256 minX = _mm256_set1_ps(x[0]), minY = _mm256_set1_ps(y[0]), minZ = _mm256_set1_ps(z[0]);
+    __m256 maxX = minX, maxY = minY, maxZ = minZ;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 vx = _mm256_loadu_ps(x + i), vy = _mm256_loadu_ps(y + i), vz = _mm256_loadu_ps(z + i);
+        minX = _mm256_min_ps(minX, vx); maxX = _mm256_max_ps(maxX, vx);
+        minY = _mm256_min_ps(minY, vy); maxY = _mm256_max_ps(maxY, vy);
+        minZ = _mm256_min_ps(minZ, vz); maxZ = _mm256_max_ps(maxZ, vz);
+    }
+    min = Vector3(reduceMin(foldMin(minX)), reduceMin(foldMin(minY)), reduceMin(foldMin(minZ)));
+    max = Vector3(reduceMax(foldMax(maxX)), reduceMax(foldMax(maxY)), reduceMax(foldMax(maxZ)));
+    boundsScalar(x, y, z, i, count, min, max);
+}
+
+TARGET_AVX2 void centerAndScaleAvx2(float* x, float* y, float* z, size_t count,
+                                    const Vector3& center, float scale) {
+    const __m256 cx = _mm256_set1_ps(center.x), cy = _mm256_set1_ps(center.y), cz = _mm256_set1_ps(center.z);
+    const __m256 s = _mm256_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(x + i, _mm256_div_ps(_mm256_sub_ps(_mm256_loadu_ps(x + i), cx), s));
+        _mm256_storeu_ps(y + i, _mm256_div_ps(_mm256_sub_ps(_mm256_loadu_ps(y + i), cy), s));
+        _mm256_storeu_ps(z + i, _mm256_div_ps(_mm256_sub_ps(_mm256_loadu_ps(z + i), cz), s));
+    }
+    centerAndScaleScalar(x, y, z, i, count, center, scale);
+}
+
+TARGET_AVX2 void rigidTransformAvx2(float* x, float* y, float* z, size_t count,
+                                    const float r[9], const Vector3& t) {
+    __m256 m[9];
+    for (int k = 0; k < 9; k++) m[k] = _mm256_set1_ps(r[k]);
+    const __m256 tx = _mm256_set1_ps(t.x), ty = _mm256_set1_ps(t.y), tz = _mm256_set1_ps(t.z);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 px = _mm256_loadu_ps(x + i), py = _mm256_loadu_ps(y + i), pz = _mm256_loadu_ps(z + i);
+        _mm256_storeu_ps(x + i, _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+            _mm256_mul_ps(m[0], px), _mm256_mul_ps(m[1], py)), _mm256_mul_ps(m[2], pz)), tx));
+        _mm256_storeu_ps(y + i, _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+            _mm256_mul_ps(m[3], px), _mm256_mul_ps(m[4], py)), _mm256_mul_ps(m[5], pz)), ty));
+        _mm256_storeu_ps(z + i, _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+            _mm256_mul_ps(m[6], px), _mm256_mul_ps(m[7], py)), _mm256_mul_ps(m[8], pz)), tz));
+    }
+    rigidTransformScalar(x, y, z, i, count, r, t);
+}
+
+// Gathers use signed 32-bit indices, so this needs fewer than 2^31 vertices
+TARGET_AVX2 void faceNormalsAvx2(const float* x, const float* y, const float* z,
+                                 Face* faces, size_t count) {
+    static_assert(sizeof(Face) % sizeof(int) == 0, "Face must be int-aligned for index gathers");
+    constexpr int stride = sizeof(Face) / sizeof(int);
+    const __m256i faceOffsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                                   _mm256_set1_epi32(stride));
+    const __m256 half = _mm256_set1_ps(0.5f), threeHalves = _mm256_set1_ps(1.5f);
+    const __m256 threshold = _mm256_set1_ps(1e-12f);
+
+    size_t f = 0;
+    for (; f + 8 <= count; f += 8) {
+        const int* base = reinterpret_cast<const int*>(faces + f);
+        const __m256i i1 = _mm256_i32gather_epi32(base + offsetof(Face, v1) / sizeof(int), faceOffsets, 4);
+        const __m256i i2 = _mm256_i32gather_epi32(base + offsetof(Face, v2) / sizeof(int), faceOffsets, 4);
+        const __m256i i3 = _mm256_i32gather_epi32(base + offsetof(Face, v3) / sizeof(int), faceOffsets, 4);
+
+        const __m256 ax = _mm256_i32gather_ps(x, i1, 4);
+        const __m256 ay = _mm256_i32gather_ps(y, i1, 4);
+        const __m256 az = _mm256_i32gather_ps(z, i1, 4);
+        const __m256 e1x = _mm256_sub_ps(_mm256_i32gather_ps(x, i2, 4), ax);
+        const __m256 e1y = _mm256_sub_ps(_mm256_i32gather_ps(y, i2, 4), ay);
+        const __m256 e1z = _mm256_sub_ps(_mm256_i32gather_ps(z, i2, 4), az);
+        const __m256 e2x = _mm256_sub_ps(_mm256_i32gather_ps(x, i3, 4), ax);
+        const __m256 e2y = _mm256_sub_ps(_mm256_i32gather_ps(y, i3, 4), ay);
+        const __m256 e2z = _mm256_sub_ps(_mm256_i32gather_ps(z, i3, 4), az);
+
+        __m256 nx = _mm256_sub_ps(_mm256_mul_ps(e1y, e2z), _mm256_mul_ps(e1z, e2y));
+        __m256 ny = _mm256_sub_ps(_mm256_mul_ps(e1z, e2x), _mm256_mul_ps(e1x, e2z));
+        __m256 nz = _mm256_sub_ps(_mm256_mul_ps(e1x, e2y), _mm256_mul_ps(e1y, e2x));
+
+        const __m256 lenSq = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, nx), _mm256_mul_ps(ny, ny)),
+                                           _mm256_mul_ps(nz, nz));
+        __m256 inv = _mm256_rsqrt_ps(lenSq);
+        inv = _mm256_mul_ps(inv, _mm256_sub_ps(threeHalves,
+                                               _mm256_mul_ps(_mm256_mul_ps(half, lenSq), _mm256_mul_ps(inv, inv))));
+        const __m256 keep = _mm256_cmp_ps(lenSq, threshold, _CMP_GT_OQ);
+        nx = _mm256_blendv_ps(nx, _mm256_mul_ps(nx, inv), keep);
+        ny = _mm256_blendv_ps(ny, _mm256_mul_ps(ny, inv), keep);
+        nz = _mm256_blendv_ps(nz, _mm256_mul_ps(nz, inv), keep);
+
+        alignas(32) float out[3][8];
+        _mm256_store_ps(out[0], nx);
+        _mm256_store_ps(out[1], ny);
+        _mm256_store_ps(out[2], nz);
+        for (int k = 0; k < 8; k++) faces[f + k].normal = Vector3(out[0][k], out[1][k], out[2][k]);
+    }
+    faceNormalsScalar(x, y, z, faces, f, count);
+}
+
+// Keys are formed in 32 bits, so this needs gridSize^3 <= 2^32
+TARGET_AVX2 void quantizeAvx2(const float* x, const float* y, const float* z, size_t count,
+                              const Vector3& min, const float cellScale[3], int gridSize, uint64_t* keys) {
+    const __m256 minX = _mm256_set1_ps(min.x), minY = _mm256_set1_ps(min.y), minZ = _mm256_set1_ps(min.z);
+    const __m256 scaleX = _mm256_set1_ps(cellScale[0]);
+    const __m256 scaleY = _mm256_set1_ps(cellScale[1]);
+    const __m256 scaleZ = _mm256_set1_ps(cellScale[2]);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 last = _mm256_set1_ps(static_cast<float>(gridSize - 1));
+    const __m256i g = _mm256_set1_epi32(gridSize);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i cx = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(
+            _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(x + i), minX), scaleX), zero), last));
+        const __m256i cy = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(
+            _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(y + i), minY), scaleY), zero), last));
+        const __m256i cz = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(
+            _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(z + i), minZ), scaleZ), zero), last));
+        const __m256i key = _mm256_add_epi32(cx, _mm256_mullo_epi32(g, _mm256_add_epi32(cy, _mm256_mullo_epi32(g, cz))));
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(keys + i),
+                            _mm256_cvtepu32_epi64(_mm256_castsi256_si128(key)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(keys + i + 4),
+                            _mm256_cvtepu32_epi64(_mm256_extracti128_si256(key, 1)));
+    }
+    quantizeScalar(x, y, z, i, count, min, cellScale, gridSize, keys);
+}
+
+#endif // MESH_KERNELS_X86
+
+} // namespace
+
+Isa activeIsa() {
+    return currentIsa().load(std::memory_order_relaxed);
+}
+
+void setIsa(Isa isa) {
+    currentIsa().store(clampIsa(isa), std::memory_order_relaxed);
+}
+
+const char* isaName(Isa isa) {
+    switch (isa) {
+        case Isa::AVX2: return "avx2";
+        case Isa::SSE41: return "sse4.1";
+        default: return "scalar";
+    }
+}
+
+void bounds(const float* x, const float* y, const float* z, size_t count,
+            Vector3& min, Vector3& max) {
+#ifdef MESH_KERNELS_X86
+    switch (activeIsa()) {
+        case Isa::AVX2: boundsAvx2(x, y, z, count, min, max); return;
+        case Isa::SSE41: boundsSse(x, y, z, count, min, max); return;
+        default: break;
+    }
+#endif
+    min = max = Vector3(x[0], y[0], z[0]);
+    boundsScalar(x, y, z, 1, count, min, max);
+}
+
+void centerAndScale(float* x, float* y, float* z, size_t count,
+                    const Vector3& center, float scale) {
+#ifdef MESH_KERNELS_X86
+    switch (activeIsa()) {
+        case Isa::AVX2: centerAndScaleAvx2(x, y, z, count, center, scale); return;
+        case Isa::SSE41: centerAndScaleSse(x, y, z, count, center, scale); return;
+        default: break;
+    }
+#endif
+    centerAndScaleScalar(x, y, z, 0, count, center, scale);
+}
+
+void rigidTransform(float* x, float* y, float* z, size_t count,
+                    const float rotation[9], const Vector3& translation) {
+#ifdef MESH_KERNELS_X86
+    switch (activeIsa()) {
+        case Isa::AVX2: rigidTransformAvx2(x, y, z, count, rotation, translation); return;
+        case Isa::SSE41: rigidTransformSse(x, y, z, count, rotation, translation); return;
+        default: break;
+    }
+#endif
+    rigidTransformScalar(x, y, z, 0, count, rotation, translation);
+}
+
+void faceNormals(const float* x, const float* y, const float* z,
+                 Face* faces, size_t faceCount) {
+#ifdef MESH_KERNELS_X86
+    switch (activeIsa()) {
+        case Isa::AVX2: faceNormalsAvx2(x, y, z, faces, faceCount); return;
+        case Isa::SSE41: faceNormalsSse(x, y, z, faces, faceCount); return;
+        default: break;
+    }
+#endif
+    faceNormalsScalar(x, y, z, faces, 0, faceCount);
+}
+
+void quantize(const float* x, const float* y, const float* z, size_t count,
+              const Vector3& min, const float cellScale[3], int gridSize, uint64_t* keys) {
+#ifdef MESH_KERNELS_X86
+    const uint64_t g = static_cast<uint64_t>(gridSize);
+    if (g * g * g <= (uint64_t(1) << 32)) {
+        switch (activeIsa()) {
+            case Isa::AVX2: quantizeAvx2(x, y, z, count, min, cellScale, gridSize, keys); return;
+            case Isa::SSE41: quantizeSse(x, y, z, count, min, cellScale, gridSize, keys); return;
+            default: break;
+        }
+    }
+#endif
+    quantizeScalar(x, y, z, 0, count, min, cellScale, gridSize, keys);
+}
+
+} // namespace VertexKernels
@@ -0,0 +1,57 @@
+#pragma once
+#include "mesh.hpp"
+#include <cstddef>
+#include <cstdint>
+
+// Loops over every vertex or face, written against PositionArrays.
+//
+// Each kernel has an AVX2, an SSE4.1 and a scalar version. The widest one
+// the CPU supports is picked at runtime, so no special compiler flags are
+// needed; setting the environment variable MESH_SIMD to scalar, sse or avx2
+// lowers the choice. All versions give bit-identical results except
+// faceNormals, whose SIMD versions normalize with a refined rsqrt (about
+// 1e-7 relative error).
+namespace VertexKernels {
+
+enum class Isa { Scalar, SSE41, AVX2 };
+
+// Instruction set the kernels currently use
+Isa activeIsa();
+// Selects an instruction set, limited to what the CPU supports
+void setIsa(Isa isa);
+const char* isaName(Isa isa);
+
+// Min/max reduction over count positions; count must be at least 1
+void bounds(const float* x, const float* y, const float* z, size_t count,
+            Vector3& min, Vector3& max);
+
+// v = (v - center) / scale for every position
+void centerAndScale(float* x, float* y, float* z, size_t count,
+                    const Vector3& center, float scale);
+
+// v = R * v + t for every position, with R a row-major 3x3 matrix
+void rigidTransform(float* x, float* y, float* z, size_t count,
+                    const float rotation[9], const Vector3& translation);
+
+// Unit normal of every face from the cross product of its edges. Faces
+// with (near) zero area keep their unnormalized cross product.
+void faceNormals(const float* x, const float* y, const float* z,
+                 Face* faces, size_t faceCount);
+
+// Cell index along one axis for a grid of last + 1 cells. Clamping in float
+// before truncating gives the same cell as clamping the integer, without
+// overflow for far-off points; the SIMD quantize paths do the same.
+inline uint64_t cellIndex(float value, float min, float scale, float last) {
+    float cell = (value - min) * scale;
+    cell = cell > 0.0f ? cell : 0.0f;
+    cell = cell < last ? cell : last;
+    return static_cast<uint64_t>(static_cast<int>(cell));
+}
+
+// Linear cell keys x + g*(y + g*z) of a gridSize^3 grid over
+// [min, min + gridSize / cellScale), clamped to the grid. A flat axis
+// (cellScale 0) maps everything to cell 0.
+void quantize(const float* x, const float* y, const float* z, size_t count,
+              const Vector3& min, const float cellScale[3], int gridSize, uint64_t* keys);
+
+} // namespace VertexKernels
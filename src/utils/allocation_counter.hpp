@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+
+// Counts heap allocations made through the global operator new.
+//
+// allocation_counter.cpp replaces the global operator new and delete (all
+// forms, including the aligned ones AlignedAllocator uses) with versions
+// that add to two relaxed atomic counters before calling malloc. A program
+// gets the replacements whenever it links MeshCore, so counts cover the
+// whole process, every thread, from startup. Take a snapshot before and
+// after the code under test and subtract; a steady-state loop that
+// allocates nothing shows zero.
+namespace AllocationCounter {
+
+struct Counts {
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+
+    Counts operator-(const Counts& earlier) const {
+        return {allocations - earlier.allocations, bytes - earlier.bytes};
+    }
+};
+
+// Totals since the process started
+Counts snapshot();
+
+} // namespace AllocationCounter
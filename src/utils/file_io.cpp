@@ -1,95 +1,1133 @@
 #include "file_io.hpp"
+#include "trace.hpp"
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <string>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
 
-bool FileIO::loadPLY(const std::string& filename,
-                     std::vector<Vector3>& vertices,
-                     std::vector<Face>& faces) {
-    std::ifstream file(filename, std::ios::binary);
+namespace {
+
+// Powers of ten that are exact in double precision
+const double kPow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Longest number token handed to strtof
+const size_t kMaxFloatToken = 63;
+
+inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+inline const char* skipSpace(const char* p, const char* end) {
+    while (p < end && isSpace(*p)) ++p;
+    return p;
+}
+
+// Scans a decimal number such as "-0.0378297" or "1.5e-3".
+// Returns the position after the token, or nullptr on malformed input or
+// when no token is left before end.
+const char* parseFloat(const char* p, const char* end, float& out) {
+    p = skipSpace(p, end);
+    const char* start = p;
+
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    bool anyDigits = false;
+
+    // Integer part; digits beyond what fits in the mantissa only scale it
+    for (; p < end && isDigit(*p); ++p) {
+        if (mantissa < 100000000000000000ULL) mantissa = mantissa * 10 + (*p - '0');
+        else exponent++;
+        anyDigits = true;
+    }
+
+    // Fractional part
+    if (p < end && *p == '.') {
+        ++p;
+        for (; p < end && isDigit(*p); ++p) {
+            if (mantissa < 100000000000000000ULL) {
+                mantissa = mantissa * 10 + (*p - '0');
+                exponent--;
+            }
+            anyDigits = true;
+        }
+    }
+
+    // Exponent part
+    if (anyDigits && p < end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        bool expNegative = false;
+        if (q < end && (*q == '-' || *q == '+')) {
+            expNegative = (*q == '-');
+            ++q;
+        }
+        if (q < end && isDigit(*q)) {
+            int e = 0;
+            for (; q < end && isDigit(*q); ++q) {
+                if (e < 10000) e = e * 10 + (*q - '0');
+            }
+            exponent += expNegative ? -e : e;
+            p = q;
+        }
+    }
+
+    if (anyDigits && exponent >= -22 && exponent <= 22 && (p == end || isSpace(*p))) {
+        double value = static_cast<double>(mantissa);
+        value = exponent < 0 ? value / kPow10[-exponent] : value * kPow10[exponent];
+        out = static_cast<float>(negative ? -value : value);
+        return p;
+    }
+
+    // Rare cases (huge exponents, nan/inf): defer to the C library, on a
+    // NUL-terminated copy of the token so it cannot read past end
+    const char* tokenEnd = start;
+    while (tokenEnd < end && !isSpace(*tokenEnd)) ++tokenEnd;
+    char token[kMaxFloatToken + 1];
+    const size_t length = static_cast<size_t>(tokenEnd - start);
+    if (length == 0 || length > kMaxFloatToken) return nullptr;
+    std::memcpy(token, start, length);
+    token[length] = '\0';
+    char* parsedEnd = nullptr;
+    out = std::strtof(token, &parsedEnd);
+    if (parsedEnd == token) return nullptr;
+    return start + (parsedEnd - token);
+}
+
+// Scans an unsigned decimal integer
+const char* parseUInt(const char* p, const char* end, unsigned int& out) {
+    p = skipSpace(p, end);
+    if (p >= end || !isDigit(*p)) return nullptr;
+
+    uint64_t value = 0;
+    for (; p < end && isDigit(*p); ++p) {
+        value = value * 10 + (*p - '0');
+        if (value > 0xFFFFFFFFULL) return nullptr;
+    }
+    out = static_cast<unsigned int>(value);
+    return p;
+}
+
+// Skips one whitespace-delimited token
+inline const char* skipToken(const char* p, const char* end) {
+    p = skipSpace(p, end);
+    if (p >= end) return nullptr;
+    while (p < end && !isSpace(*p)) ++p;
+    return p;
+}
+
+
+bool hostIsLittleEndian() {
+    const uint16_t probe = 1;
+    unsigned char firstByte;
+    std::memcpy(&firstByte, &probe, 1);
+    return firstByte == 1;
+}
+
+bool parseType(const std::string& name, FileIO::PLYType& type) {
+    using T = FileIO::PLYType;
+    if (name == "char" || name == "int8") type = T::Int8;
+    else if (name == "uchar" || name == "uint8") type = T::UInt8;
+    else if (name == "short" || name == "int16") type = T::Int16;
+    else if (name == "ushort" || name == "uint16") type = T::UInt16;
+    else if (name == "int" || name == "int32") type = T::Int32;
+    else if (name == "uint" || name == "uint32") type = T::UInt32;
+    else if (name == "float" || name == "float32") type = T::Float32;
+    else if (name == "double" || name == "float64") type = T::Float64;
+    else return false;
+    return true;
+}
+
+// Applies one header line to the schema; sets done on "end_header"
+bool parseHeaderLine(const std::string& line, FileIO::PLYHeader& header, bool& done) {
+    std::istringstream iss(line);
+    std::string keyword;
+    iss >> keyword;
+
+    if (keyword == "format") {
+        std::string format;
+        iss >> format;
+        if (format == "ascii") header.format = FileIO::PLYFormat::Ascii;
+        else if (format == "binary_little_endian") header.format = FileIO::PLYFormat::BinaryLittleEndian;
+        else if (format == "binary_big_endian") header.format = FileIO::PLYFormat::BinaryBigEndian;
+        else return false;
+    }
+    else if (keyword == "element") {
+        FileIO::PLYElement element;
+        if (!(iss >> element.name >> element.count)) return false;
+        header.elements.push_back(element);
+    }
+    else if (keyword == "property") {
+        if (header.elements.empty()) return false;
+        FileIO::PLYProperty property;
+        std::string type;
+        iss >> type;
+        if (type == "list") {
+            std::string countType, valueType;
+            iss >> countType >> valueType;
+            if (!parseType(countType, property.countType) ||
+                !parseType(valueType, property.type)) return false;
+            property.isList = true;
+        }
+        else if (!parseType(type, property.type)) {
+            return false;
+        }
+        iss >> property.name;
+        header.elements.back().properties.push_back(property);
+    }
+    else if (keyword == "end_header") {
+        done = true;
+    }
+    // comment, obj_info and unknown keywords carry no schema
+    return true;
+}
+
+// Parses the header at the start of an in-memory file
+bool parseHeader(const char* begin, const char* end, FileIO::PLYHeader& header) {
+    const char* p = begin;
+    bool first = true;
+    bool done = false;
+
+    while (p < end && !done) {
+        const char* lineEnd = p;
+        while (lineEnd < end && *lineEnd != '\n') ++lineEnd;
+        std::string line(p, lineEnd);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        p = (lineEnd < end) ? lineEnd + 1 : end;
+
+        if (first) {
+            if (line != "ply") return false;
+            first = false;
+        }
+        else if (!parseHeaderLine(line, header, done)) {
+            return false;
+        }
+    }
+
+    header.dataOffset = p - begin;
+    return done;
+}
+
+// Reads a whole file into memory with a trailing NUL
+bool readWholeFile(const std::string& filename, std::vector<char>& buffer) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
     if (!file.is_open()) {
         std::cerr << "Error: Could not open file " << filename << std::endl;
         return false;
     }
 
-    // Clear existing data
-    vertices.clear();
-    faces.clear();
-
-    // Read header
-    int nVertices = 0, nFaces = 0;
-    if (!readPLYHeader(file, nVertices, nFaces)) {
-        std::cerr << "Error: Invalid PLY header" << std::endl;
+    std::streamsize fileSize = file.tellg();
+    file.seekg(0, std::ios::beg);
+    buffer.resize(static_cast<size_t>(fileSize) + 1);
+    if (!file.read(buffer.data(), fileSize)) {
+        std::cerr << "Error: Could not read file " << filename << std::endl;
         return false;
     }
+    buffer[fileSize] = '\0';
+    return true;
+}
+
+// Columns of interest within an element
+struct Columns {
+    int x = -1, y = -1, z = -1;
+    int indexList = -1;
+
+    explicit Columns(const FileIO::PLYElement& element) {
+        x = element.findProperty("x");
+        y = element.findProperty("y");
+        z = element.findProperty("z");
+        indexList = element.findProperty("vertex_indices");
+        if (indexList < 0) indexList = element.findProperty("vertex_index");
+        if (indexList >= 0 && !element.properties[indexList].isList) indexList = -1;
+    }
+};
 
-    // Read vertices
-    for (int i = 0; i < nVertices; i++) {
-        float x, y, z;
-        file.read(reinterpret_cast<char*>(&x), sizeof(float));
-        file.read(reinterpret_cast<char*>(&y), sizeof(float));
-        file.read(reinterpret_cast<char*>(&z), sizeof(float));
-        vertices.emplace_back(x, y, z);
+template <typename T>
+T loadRaw(const unsigned char* p, bool swap) {
+    T value;
+    if (swap) {
+        unsigned char bytes[sizeof(T)];
+        for (size_t i = 0; i < sizeof(T); i++) bytes[i] = p[sizeof(T) - 1 - i];
+        std::memcpy(&value, bytes, sizeof(T));
+    } else {
+        std::memcpy(&value, p, sizeof(T));
     }
+    return value;
+}
 
-    // Read faces
-    for (int i = 0; i < nFaces; i++) {
-        unsigned char nVerticesInFace;
-        file.read(reinterpret_cast<char*>(&nVerticesInFace), sizeof(unsigned char));
-        
-        if (nVerticesInFace != 3) {
+double readBinaryValue(const unsigned char* p, FileIO::PLYType type, bool swap) {
+    using T = FileIO::PLYType;
+    switch (type) {
+        case T::Int8:    return loadRaw<int8_t>(p, swap);
+        case T::UInt8:   return loadRaw<uint8_t>(p, swap);
+        case T::Int16:   return loadRaw<int16_t>(p, swap);
+        case T::UInt16:  return loadRaw<uint16_t>(p, swap);
+        case T::Int32:   return loadRaw<int32_t>(p, swap);
+        case T::UInt32:  return loadRaw<uint32_t>(p, swap);
+        case T::Float32: return loadRaw<float>(p, swap);
+        case T::Float64: return loadRaw<double>(p, swap);
+    }
+    return 0.0;
+}
+
+// List length stored at p. Negative, fractional or NaN counts, and lists
+// longer than the `available` bytes left, are rejected before the cast.
+bool readListCount(const unsigned char* p, FileIO::PLYType countType, bool swap,
+                   size_t valueSize, size_t available, size_t& count) {
+    const double raw = readBinaryValue(p, countType, swap);
+    if (!(raw >= 0.0) || raw != std::floor(raw)) return false;
+    if (raw > static_cast<double>(available / valueSize)) return false;
+    count = static_cast<size_t>(raw);
+    return true;
+}
+
+// Vertex index stored at p. Negative, fractional or NaN indices, and those
+// past the last vertex, are rejected before the cast.
+bool readFaceIndex(const unsigned char* p, FileIO::PLYType type, bool swap, size_t nVertices,
+                   unsigned int& index) {
+    const double raw = readBinaryValue(p, type, swap);
+    if (!(raw >= 0.0) || raw >= static_cast<double>(nVertices) || raw != std::floor(raw)) return false;
+    index = static_cast<unsigned int>(raw);
+    return true;
+}
+
+void swapFloatsInPlace(std::vector<Vector3>& vertices) {
+    for (auto& v : vertices) {
+        v.x = loadRaw<float>(reinterpret_cast<const unsigned char*>(&v.x), true);
+        v.y = loadRaw<float>(reinterpret_cast<const unsigned char*>(&v.y), true);
+        v.z = loadRaw<float>(reinterpret_cast<const unsigned char*>(&v.z), true);
+    }
+}
+
+// Packed vertex block with float x/y/z laid out back to back in every row:
+// copied with one memcpy per row, or one for the whole block if rows are bare xyz
+bool readPackedVertices(const unsigned char* p, const unsigned char* end,
+                        const FileIO::PLYElement& element, const Columns& columns,
+                        bool swap, std::vector<Vector3>& vertices,
+                        const unsigned char*& next) {
+    static_assert(sizeof(Vector3) == 3 * sizeof(float), "Vector3 must be tightly packed");
+
+    size_t stride = element.fixedStride();
+    size_t offset = 0;
+    for (int i = 0; i < columns.x; i++) offset += FileIO::typeSize(element.properties[i].type);
+
+    if (static_cast<size_t>(end - p) < stride * element.count) return false;
+
+    vertices.resize(element.count);
+    if (stride == sizeof(Vector3)) {
+        std::memcpy(vertices.data(), p, stride * element.count);
+    } else {
+        const unsigned char* row = p + offset;
+        for (size_t i = 0; i < element.count; i++, row += stride) {
+            std::memcpy(&vertices[i], row, sizeof(Vector3));
+        }
+    }
+    if (swap) swapFloatsInPlace(vertices);
+
+    next = p + stride * element.count;
+    return true;
+}
+
+// Face block whose only property is "list uchar int|uint": fixed 13-byte rows
+bool readTriangleBlock(const unsigned char* p, const unsigned char* end,
+                       const FileIO::PLYElement& element, bool swap, size_t nVertices,
+                       std::vector<Face>& faces, const unsigned char*& next) {
+    const size_t rowSize = 1 + 3 * sizeof(uint32_t);
+    if (static_cast<size_t>(end - p) < rowSize * element.count) return false;
+
+    faces.reserve(element.count);
+    for (size_t row = 0; row < element.count; row++, p += rowSize) {
+        if (p[0] != 3) {
             std::cerr << "Error: Only triangular faces are supported" << std::endl;
             return false;
         }
-
-        unsigned int v1, v2, v3;
-        file.read(reinterpret_cast<char*>(&v1), sizeof(unsigned int));
-        file.read(reinterpret_cast<char*>(&v2), sizeof(unsigned int));
-        file.read(reinterpret_cast<char*>(&v3), sizeof(unsigned int));
-        
+        const uint32_t v1 = loadRaw<uint32_t>(p + 1, swap);
+        const uint32_t v2 = loadRaw<uint32_t>(p + 5, swap);
+        const uint32_t v3 = loadRaw<uint32_t>(p + 9, swap);
+        if (v1 >= nVertices || v2 >= nVertices || v3 >= nVertices) {
+            std::cerr << "Error: Face " << row << " references a missing vertex" << std::endl;
+            return false;
+        }
         faces.emplace_back(v1, v2, v3);
     }
 
-    std::cout << "Loaded PLY file: " << filename << std::endl;
-    std::cout << "Vertices: " << vertices.size() << std::endl;
-    std::cout << "Faces: " << faces.size() << std::endl;
+    next = p;
+    return true;
+}
+
+// Walks one element row by row, decoding x/y/z and triangle lists where present
+bool readBinaryRows(const unsigned char* p, const unsigned char* end,
+                    const FileIO::PLYElement& element, const Columns& columns,
+                    bool isVertex, bool isFace, bool swap, size_t nVertices,
+                    std::vector<Vector3>& vertices, std::vector<Face>& faces,
+                    const unsigned char*& next) {
+    for (size_t row = 0; row < element.count; row++) {
+        float position[3] = {0.0f, 0.0f, 0.0f};
+
+        for (size_t i = 0; i < element.properties.size(); i++) {
+            const auto& property = element.properties[i];
+            const int column = static_cast<int>(i);
+            const size_t valueSize = FileIO::typeSize(property.type);
+
+            if (property.isList) {
+                const size_t countSize = FileIO::typeSize(property.countType);
+                if (static_cast<size_t>(end - p) < countSize) return false;
+                size_t count = 0;
+                if (!readListCount(p, property.countType, swap, valueSize,
+                                   static_cast<size_t>(end - p) - countSize, count)) return false;
+                p += countSize;
+
+                if (isFace && column == columns.indexList) {
+                    if (count != 3) {
+                        std::cerr << "Error: Only triangular faces are supported" << std::endl;
+                        return false;
+                    }
+                    unsigned int index[3];
+                    for (int k = 0; k < 3; k++) {
+                        if (!readFaceIndex(p + k * valueSize, property.type, swap, nVertices, index[k])) {
+                            std::cerr << "Error: Face " << row << " references a missing vertex" << std::endl;
+                            return false;
+                        }
+                    }
+                    faces.emplace_back(index[0], index[1], index[2]);
+                }
+                p += count * valueSize;
+            } else {
+                if (static_cast<size_t>(end - p) < valueSize) return false;
+                if (isVertex && (column == columns.x || column == columns.y || column == columns.z)) {
+                    float value = static_cast<float>(readBinaryValue(p, property.type, swap));
+                    if (column == columns.x) position[0] = value;
+                    else if (column == columns.y) position[1] = value;
+                    else position[2] = value;
+                }
+                p += valueSize;
+            }
+        }
+
+        if (isVertex) vertices.emplace_back(position[0], position[1], position[2]);
+    }
+
+    next = p;
+    return true;
+}
+
+bool loadBinaryBody(const unsigned char* p, const unsigned char* end,
+                    const FileIO::PLYHeader& header,
+                    std::vector<Vector3>& vertices, std::vector<Face>& faces) {
+    const bool fileIsLittle = (header.format == FileIO::PLYFormat::BinaryLittleEndian);
+    const bool swap = (fileIsLittle != hostIsLittleEndian());
+
+    vertices.clear();
+    faces.clear();
+
+    const FileIO::PLYElement* vertexElement = header.findElement("vertex");
+    const size_t nVertices = vertexElement ? vertexElement->count : 0;
+
+    for (const auto& element : header.elements) {
+        const bool isVertex = (&element == vertexElement);
+        const bool isFace = (element.name == "face");
+        const Columns columns(element);
+
+        if (isVertex && (columns.x < 0 || columns.y < 0 || columns.z < 0)) {
+            std::cerr << "Error: Vertex element lacks x/y/z properties" << std::endl;
+            return false;
+        }
+
+        bool ok;
+        const bool packedXYZ = isVertex && element.fixedStride() > 0 &&
+            columns.y == columns.x + 1 && columns.z == columns.x + 2 &&
+            element.properties[columns.x].type == FileIO::PLYType::Float32 &&
+            element.properties[columns.y].type == FileIO::PLYType::Float32 &&
+            element.properties[columns.z].type == FileIO::PLYType::Float32;
+
+        const bool packedTriangles = isFace && element.properties.size() == 1 &&
+            columns.indexList == 0 &&
+            element.properties[0].countType == FileIO::PLYType::UInt8 &&
+            (element.properties[0].type == FileIO::PLYType::Int32 ||
+             element.properties[0].type == FileIO::PLYType::UInt32);
 
+        if (packedXYZ) {
+            ok = readPackedVertices(p, end, element, columns, swap, vertices, p);
+        }
+        else if (packedTriangles) {
+            // Rows are only fixed-size if every face is a triangle; readTriangleBlock checks
+            ok = readTriangleBlock(p, end, element, swap, nVertices, faces, p);
+        }
+        else if (!isVertex && !isFace && element.fixedStride() > 0) {
+            // Fixed-size rows of an element we don't use: skip the whole block
+            const size_t blockSize = element.fixedStride() * element.count;
+            ok = static_cast<size_t>(end - p) >= blockSize;
+            if (ok) p += blockSize;
+        }
+        else {
+            if (isVertex) vertices.reserve(element.count);
+            else if (isFace) faces.reserve(element.count);
+            ok = readBinaryRows(p, end, element, columns, isVertex, isFace, swap,
+                                nVertices, vertices, faces, p);
+        }
+
+        if (!ok) {
+            std::cerr << "Error: Malformed or truncated " << element.name << " data" << std::endl;
+            return false;
+        }
+    }
     return true;
 }
 
-bool FileIO::readPLYHeader(std::ifstream& file, int& nVertices, int& nFaces) {
+// Scans the ASCII body, keeping x/y/z and triangle lists and skipping the rest
+bool loadAsciiBody(const char* p, const char* end, const FileIO::PLYHeader& header,
+                   std::vector<Vector3>& vertices, std::vector<Face>& faces) {
+    vertices.clear();
+    faces.clear();
+
+    const FileIO::PLYElement* vertexElement = header.findElement("vertex");
+    const FileIO::PLYElement* faceElement = header.findElement("face");
+    const size_t nVertices = vertexElement ? vertexElement->count : 0;
+    vertices.reserve(nVertices);
+    if (faceElement) faces.reserve(faceElement->count);
+
+    for (const auto& element : header.elements) {
+        const bool isVertex = (&element == vertexElement);
+        const bool isFace = (element.name == "face");
+        const Columns columns(element);
+
+        if (isVertex && (columns.x < 0 || columns.y < 0 || columns.z < 0)) {
+            std::cerr << "Error: Vertex element lacks x/y/z properties" << std::endl;
+            return false;
+        }
+
+        for (size_t row = 0; row < element.count; row++) {
+            float position[3] = {0.0f, 0.0f, 0.0f};
+
+            for (size_t i = 0; i < element.properties.size(); i++) {
+                const int column = static_cast<int>(i);
+
+                if (element.properties[i].isList) {
+                    unsigned int count = 0;
+                    p = parseUInt(p, end, count);
+                    if (!p) break;
+
+                    if (isFace && column == columns.indexList) {
+                        if (count != 3) {
+                            std::cerr << "Error: Only triangular faces are supported" << std::endl;
+                            return false;
+                        }
+                        unsigned int v1, v2, v3;
+                        if (!(p = parseUInt(p, end, v1)) ||
+                            !(p = parseUInt(p, end, v2)) ||
+                            !(p = parseUInt(p, end, v3))) break;
+                        if (v1 >= nVertices || v2 >= nVertices || v3 >= nVertices) {
+                            std::cerr << "Error: Face " << row << " references a missing vertex" << std::endl;
+                            return false;
+                        }
+                        faces.emplace_back(v1, v2, v3);
+                    } else {
+                        for (unsigned int k = 0; k < count && p; k++) p = skipToken(p, end);
+                    }
+                }
+                else if (isVertex && (column == columns.x || column == columns.y || column == columns.z)) {
+                    float value;
+                    p = parseFloat(p, end, value);
+                    if (column == columns.x) position[0] = value;
+                    else if (column == columns.y) position[1] = value;
+                    else position[2] = value;
+                }
+                else {
+                    p = skipToken(p, end);
+                }
+
+                if (!p) break;
+            }
+
+            if (!p) {
+                std::cerr << "Error: Malformed or truncated " << element.name
+                          << " data at row " << row << std::endl;
+                return false;
+            }
+
+            if (isVertex) vertices.emplace_back(position[0], position[1], position[2]);
+        }
+    }
+    return true;
+}
+
+template <typename T>
+void storeRaw(unsigned char* p, T value, bool swap) {
+    std::memcpy(p, &value, sizeof(T));
+    if (swap) {
+        for (size_t i = 0; i < sizeof(T) / 2; i++) std::swap(p[i], p[sizeof(T) - 1 - i]);
+    }
+}
+
+} // namespace
+
+int FileIO::PLYElement::findProperty(const std::string& propertyName) const {
+    for (size_t i = 0; i < properties.size(); i++) {
+        if (properties[i].name == propertyName) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+size_t FileIO::PLYElement::fixedStride() const {
+    size_t stride = 0;
+    for (const auto& property : properties) {
+        if (property.isList) return 0;
+        stride += typeSize(property.type);
+    }
+    return stride;
+}
+
+const FileIO::PLYElement* FileIO::PLYHeader::findElement(const std::string& elementName) const {
+    for (const auto& element : elements) {
+        if (element.name == elementName) return &element;
+    }
+    return nullptr;
+}
+
+size_t FileIO::typeSize(PLYType type) {
+    switch (type) {
+        case PLYType::Int8:
+        case PLYType::UInt8:   return 1;
+        case PLYType::Int16:
+        case PLYType::UInt16:  return 2;
+        case PLYType::Int32:
+        case PLYType::UInt32:
+        case PLYType::Float32: return 4;
+        case PLYType::Float64: return 8;
+    }
+    return 0;
+}
+
+bool FileIO::readPLYHeader(std::istream& file, PLYHeader& header) {
+    header = PLYHeader();
     std::string line;
-    
-    // Read PLY header
+
     std::getline(file, line);
+    if (!line.empty() && line.back() == '\r') line.pop_back();
     if (line != "ply") return false;
-    
-    bool inHeader = true;
-    bool binary = false;
-    
-    while (inHeader && std::getline(file, line)) {
-        std::istringstream iss(line);
-        std::string keyword;
-        iss >> keyword;
-        
-        if (keyword == "format") {
-            std::string format;
-            iss >> format;
-            binary = (format == "binary_little_endian");
-        }
-        else if (keyword == "element") {
-            std::string element;
-            int count;
-            iss >> element >> count;
-            
-            if (element == "vertex") nVertices = count;
-            else if (element == "face") nFaces = count;
-        }
-        else if (keyword == "end_header") {
-            inHeader = false;
-        }
-    }
-    
-    return !inHeader && binary;
-}
\ No newline at end of file
+
+    bool done = false;
+    while (!done && std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (!parseHeaderLine(line, header, done)) return false;
+    }
+
+    if (done) header.dataOffset = static_cast<size_t>(file.tellg());
+    return done;
+}
+
+bool FileIO::loadPLY(const std::string& filename,
+                     std::vector<Vector3>& vertices,
+                     std::vector<Face>& faces,
+                     LoadStats* stats) {
+    Trace::Scope trace("FileIO::loadPLY");
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    std::vector<char> buffer;
+    if (!readWholeFile(filename, buffer)) return false;
+
+    const char* begin = buffer.data();
+    const char* end = begin + buffer.size() - 1;
+
+    PLYHeader header;
+    if (!parseHeader(begin, end, header)) {
+        std::cerr << "Error: Invalid PLY header" << std::endl;
+        return false;
+    }
+
+    bool ok;
+    if (header.format == PLYFormat::Ascii) {
+        ok = loadAsciiBody(begin + header.dataOffset, end, header, vertices, faces);
+    } else {
+        const unsigned char* body = reinterpret_cast<const unsigned char*>(begin + header.dataOffset);
+        ok = loadBinaryBody(body, reinterpret_cast<const unsigned char*>(end), header, vertices, faces);
+    }
+    if (!ok) return false;
+
+    if (stats) {
+        auto endTime = std::chrono::high_resolution_clock::now();
+        stats->bytes = buffer.size() - 1;
+        stats->elements = vertices.size() + faces.size();
+        stats->seconds = std::chrono::duration<double>(endTime - startTime).count();
+    }
+
+    return true;
+}
+
+bool FileIO::savePLY(const std::string& filename,
+                     const std::vector<Vector3>& vertices,
+                     const std::vector<Face>& faces,
+                     PLYFormat format,
+                     const std::vector<Vector3>* normals) {
+    Trace::Scope trace("FileIO::savePLY");
+    if (normals && normals->size() != vertices.size()) {
+        std::cerr << "Error: " << normals->size() << " normals for " << vertices.size() << " vertices" << std::endl;
+        return false;
+    }
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open file " << filename << " for writing" << std::endl;
+        return false;
+    }
+
+    const char* formatName = (format == PLYFormat::Ascii) ? "ascii" :
+                             (format == PLYFormat::BinaryLittleEndian) ? "binary_little_endian" :
+                                                                         "binary_big_endian";
+    file << "ply\n"
+         << "format " << formatName << " 1.0\n"
+         << "element vertex " << vertices.size() << "\n"
+         << "property float x\n"
+         << "property float y\n"
+         << "property float z\n";
+    if (normals) {
+        file << "property float nx\n"
+             << "property float ny\n"
+             << "property float nz\n";
+    }
+    file << "element face " << faces.size() << "\n"
+         << "property list uchar int vertex_indices\n"
+         << "end_header\n";
+
+    // Rows are staged in a fixed-size buffer and flushed in large writes
+    const size_t kChunkRows = 65536;
+    std::vector<char> chunk;
+
+    if (format == PLYFormat::Ascii) {
+        chunk.resize(kChunkRows * 128);
+        size_t used = 0;
+        auto flush = [&]() { file.write(chunk.data(), used); used = 0; };
+
+        for (size_t i = 0; i < vertices.size(); i++) {
+            if (chunk.size() - used < 128) flush();
+            const Vector3& v = vertices[i];
+            if (!normals) {
+                used += std::snprintf(chunk.data() + used, chunk.size() - used, "%.9g %.9g %.9g\n", v.x, v.y, v.z);
+                continue;
+            }
+            const Vector3& n = (*normals)[i];
+            used += std::snprintf(chunk.data() + used, chunk.size() - used, "%.9g %.9g %.9g %.9g %.9g %.9g\n",
+                                  v.x, v.y, v.z, n.x, n.y, n.z);
+        }
+        for (const auto& f : faces) {
+            if (chunk.size() - used < 64) flush();
+            used += std::snprintf(chunk.data() + used, chunk.size() - used, "3 %u %u %u\n", f.v1, f.v2, f.v3);
+        }
+        flush();
+        return static_cast<bool>(file);
+    }
+
+    const bool swap = ((format == PLYFormat::BinaryLittleEndian) != hostIsLittleEndian());
+
+    // Vertex block: already packed float triples, so write it directly when
+    // there is nothing to swap or interleave
+    if (!swap && !normals) {
+        file.write(reinterpret_cast<const char*>(vertices.data()), vertices.size() * sizeof(Vector3));
+    } else {
+        const size_t vertexRowSize = (normals ? 2 : 1) * sizeof(Vector3);
+        chunk.resize(kChunkRows * vertexRowSize);
+        for (size_t start = 0; start < vertices.size(); start += kChunkRows) {
+            size_t rows = std::min(kChunkRows, vertices.size() - start);
+            unsigned char* out = reinterpret_cast<unsigned char*>(chunk.data());
+            for (size_t i = 0; i < rows; i++, out += vertexRowSize) {
+                const Vector3& v = vertices[start + i];
+                storeRaw(out, v.x, swap);
+                storeRaw(out + 4, v.y, swap);
+                storeRaw(out + 8, v.z, swap);
+                if (!normals) continue;
+                const Vector3& n = (*normals)[start + i];
+                storeRaw(out + 12, n.x, swap);
+                storeRaw(out + 16, n.y, swap);
+                storeRaw(out + 20, n.z, swap);
+            }
+            file.write(chunk.data(), rows * vertexRowSize);
+        }
+    }
+
+    // Face block: uchar count followed by three int indices
+    const size_t faceRowSize = 1 + 3 * sizeof(int32_t);
+    chunk.resize(kChunkRows * faceRowSize);
+    for (size_t start = 0; start < faces.size(); start += kChunkRows) {
+        size_t rows = std::min(kChunkRows, faces.size() - start);
+        unsigned char* out = reinterpret_cast<unsigned char*>(chunk.data());
+        for (size_t i = 0; i < rows; i++, out += faceRowSize) {
+            const Face& f = faces[start + i];
+            out[0] = 3;
+            storeRaw(out + 1, static_cast<int32_t>(f.v1), swap);
+            storeRaw(out + 5, static_cast<int32_t>(f.v2), swap);
+            storeRaw(out + 9, static_cast<int32_t>(f.v3), swap);
+        }
+        file.write(chunk.data(), rows * faceRowSize);
+    }
+
+    return static_cast<bool>(file);
+}
+
+namespace {
+
+// Rows handed to the stream callbacks per batch
+const size_t kStreamBatchRows = 65536;
+
+} // namespace
+
+PLYStreamReader::PLYStreamReader(size_t windowBytes)
+    : window(std::max<size_t>(windowBytes, 4096) + 1, '\0') {}
+
+bool PLYStreamReader::open(const std::string& path) {
+    filename = path;
+    file.close();
+    file.clear();
+    file.open(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open file " << path << std::endl;
+        return false;
+    }
+    if (!FileIO::readPLYHeader(file, header)) {
+        std::cerr << "Error: Invalid PLY header" << std::endl;
+        return false;
+    }
+    file.seekg(0, std::ios::end);
+    const std::streamoff size = file.tellg();
+    bodyBytes = size > static_cast<std::streamoff>(header.dataOffset) ? static_cast<size_t>(size) - header.dataOffset : 0;
+    return true;
+}
+
+size_t PLYStreamReader::vertexCount() const {
+    const FileIO::PLYElement* element = header.findElement("vertex");
+    return element ? element->count : 0;
+}
+
+size_t PLYStreamReader::faceCount() const {
+    const FileIO::PLYElement* element = header.findElement("face");
+    return element ? element->count : 0;
+}
+
+// Makes at least `bytes` unread bytes available, compacting the window and
+// growing it only for a single row larger than the window
+bool PLYStreamReader::fill(size_t bytes) {
+    if (end - begin >= bytes) return true;
+
+    std::memmove(window.data(), window.data() + begin, end - begin);
+    end -= begin;
+    begin = 0;
+    if (bytes + 1 > window.size()) window.resize(bytes + 1);
+
+    while (end < bytes && !atEof) {
+        file.read(window.data() + end, static_cast<std::streamsize>(window.size() - 1 - end));
+        const size_t got = static_cast<size_t>(file.gcount());
+        end += got;
+        if (got == 0) atEof = true;
+    }
+    window[end] = '\0';
+    return end >= bytes;
+}
+
+void PLYStreamReader::skip(size_t bytes) {
+    const size_t buffered = std::min(bytes, end - begin);
+    begin += buffered;
+    consumed += buffered;
+    if (bytes > buffered) {
+        file.seekg(static_cast<std::streamoff>(bytes - buffered), std::ios::cur);
+        consumed += bytes - buffered;
+    }
+}
+
+bool PLYStreamReader::nextLine(const char*& lineBegin, const char*& lineEnd) {
+    size_t scanned = begin;
+    while (true) {
+        const char* newline = static_cast<const char*>(
+            std::memchr(window.data() + scanned, '\n', end - scanned));
+        if (newline) {
+            lineBegin = window.data() + begin;
+            lineEnd = newline;
+            const size_t length = static_cast<size_t>(newline - lineBegin) + 1;
+            begin += length;
+            consumed += length;
+            return true;
+        }
+        if (atEof) {
+            // Last line without a newline
+            if (begin == end) return false;
+            lineBegin = window.data() + begin;
+            lineEnd = window.data() + end;
+            consumed += end - begin;
+            begin = end;
+            return true;
+        }
+        scanned = end - begin;
+        if (!fill(end - begin + 1) && begin == end) return false;
+        scanned += begin;
+    }
+}
+
+bool PLYStreamReader::readAsciiElement(const FileIO::PLYElement& element, bool isVertex, bool isFace,
+                                       const VertexCallback& onVertices, const FaceCallback& onFaces) {
+    const Columns columns(element);
+    const size_t nVertices = vertexCount();
+    std::vector<Vector3> vertexBatch;
+    std::vector<Face> faceBatch;
+
+    for (size_t row = 0; row < element.count; row++) {
+        const char* p;
+        const char* lineEnd;
+        if (!nextLine(p, lineEnd)) {
+            std::cerr << "Error: Malformed or truncated " << element.name << " data at row " << row << std::endl;
+            return false;
+        }
+        if (!isVertex && !isFace) continue;
+
+        float position[3] = {0.0f, 0.0f, 0.0f};
+        for (size_t i = 0; i < element.properties.size() && p; i++) {
+            const int column = static_cast<int>(i);
+            if (element.properties[i].isList) {
+                unsigned int count = 0;
+                p = parseUInt(p, lineEnd, count);
+                if (!p) break;
+                if (isFace && column == columns.indexList) {
+                    if (count != 3) {
+                        std::cerr << "Error: Only triangular faces are supported" << std::endl;
+                        return false;
+                    }
+                    unsigned int v1, v2, v3;
+                    if (!(p = parseUInt(p, lineEnd, v1)) ||
+                        !(p = parseUInt(p, lineEnd, v2)) ||
+                        !(p = parseUInt(p, lineEnd, v3))) break;
+                    if (v1 >= nVertices || v2 >= nVertices || v3 >= nVertices) {
+                        std::cerr << "Error: Face " << row << " references a missing vertex" << std::endl;
+                        return false;
+                    }
+                    faceBatch.emplace_back(v1, v2, v3);
+                } else {
+                    for (unsigned int k = 0; k < count && p; k++) p = skipToken(p, lineEnd);
+                }
+            }
+            else if (isVertex && (column == columns.x || column == columns.y || column == columns.z)) {
+                float value;
+                p = parseFloat(p, lineEnd, value);
+                if (column == columns.x) position[0] = value;
+                else if (column == columns.y) position[1] = value;
+                else position[2] = value;
+            }
+            else {
+                p = skipToken(p, lineEnd);
+            }
+        }
+        if (!p) {
+            std::cerr << "Error: Malformed " << element.name << " data at row " << row << std::endl;
+            return false;
+        }
+
+        if (isVertex) {
+            vertexBatch.emplace_back(position[0], position[1], position[2]);
+            if (vertexBatch.size() == kStreamBatchRows) {
+                if (!onVertices(vertexBatch.data(), vertexBatch.size())) return false;
+                vertexBatch.clear();
+            }
+        } else if (faceBatch.size() == kStreamBatchRows) {
+            if (!onFaces(faceBatch.data(), faceBatch.size())) return false;
+            faceBatch.clear();
+        }
+    }
+
+    if (!vertexBatch.empty() && !onVertices(vertexBatch.data(), vertexBatch.size())) return false;
+    if (!faceBatch.empty() && !onFaces(faceBatch.data(), faceBatch.size())) return false;
+    return true;
+}
+
+bool PLYStreamReader::readBinaryElement(const FileIO::PLYElement& element, bool isVertex, bool isFace,
+                                        const VertexCallback& onVertices, const FaceCallback& onFaces) {
+    const bool swap = (header.format == FileIO::PLYFormat::BinaryLittleEndian) != hostIsLittleEndian();
+    const Columns columns(element);
+    const size_t nVertices = vertexCount();
+    const size_t stride = element.fixedStride();
+    const size_t windowRows = stride > 0 ? std::max<size_t>(1, (window.size() - 1) / stride) : 0;
+
+    // Fixed-size rows we don't use: skip the whole block
+    if (!isVertex && !isFace && stride > 0) {
+        skip(stride * element.count);
+        return true;
+    }
+
+    std::vector<Vector3> vertexBatch;
+    std::vector<Face> faceBatch;
+
+    const bool packedXYZ = isVertex && stride > 0 &&
+        columns.y == columns.x + 1 && columns.z == columns.x + 2 &&
+        element.properties[columns.x].type == FileIO::PLYType::Float32 &&
+        element.properties[columns.y].type == FileIO::PLYType::Float32 &&
+        element.properties[columns.z].type == FileIO::PLYType::Float32;
+    if (packedXYZ) {
+        size_t offset = 0;
+        for (int i = 0; i < columns.x; i++) offset += FileIO::typeSize(element.properties[i].type);
+
+        for (size_t row = 0; row < element.count;) {
+            const size_t rows = std::min({element.count - row, windowRows, kStreamBatchRows});
+            if (!fill(rows * stride)) {
+                std::cerr << "Error: Malformed or truncated " << element.name << " data" << std::endl;
+                return false;
+            }
+            vertexBatch.resize(rows);
+            const char* src = window.data() + begin + offset;
+            for (size_t i = 0; i < rows; i++, src += stride) std::memcpy(&vertexBatch[i], src, sizeof(Vector3));
+            if (swap) swapFloatsInPlace(vertexBatch);
+            skip(rows * stride);
+            row += rows;
+            if (!onVertices(vertexBatch.data(), rows)) return false;
+        }
+        return true;
+    }
+
+    const bool packedTriangles = isFace && element.properties.size() == 1 &&
+        columns.indexList == 0 &&
+        element.properties[0].countType == FileIO::PLYType::UInt8 &&
+        (element.properties[0].type == FileIO::PLYType::Int32 ||
+         element.properties[0].type == FileIO::PLYType::UInt32);
+
+    for (size_t row = 0; row < element.count; row++) {
+        if (packedTriangles) {
+            const size_t rowSize = 1 + 3 * sizeof(uint32_t);
+            if (!fill(rowSize)) {
+                std::cerr << "Error: Malformed or truncated " << element.name << " data" << std::endl;
+                return false;
+            }
+            const unsigned char* p = reinterpret_cast<const unsigned char*>(window.data() + begin);
+            if (p[0] != 3) {
+                std::cerr << "Error: Only triangular faces are supported" << std::endl;
+                return false;
+            }
+            const uint32_t v1 = loadRaw<uint32_t>(p + 1, swap);
+            const uint32_t v2 = loadRaw<uint32_t>(p + 5, swap);
+            const uint32_t v3 = loadRaw<uint32_t>(p + 9, swap);
+            if (v1 >= nVertices || v2 >= nVertices || v3 >= nVertices) {
+                std::cerr << "Error: Face " << row << " references a missing vertex" << std::endl;
+                return false;
+            }
+            faceBatch.emplace_back(v1, v2, v3);
+            skip(rowSize);
+        } else {
+            // Generic row, one property at a time
+            float position[3] = {0.0f, 0.0f, 0.0f};
+            bool ok = true;
+            for (size_t i = 0; i < element.properties.size() && ok; i++) {
+                const auto& property = element.properties[i];
+                const int column = static_cast<int>(i);
+                const size_t valueSize = FileIO::typeSize(property.type);
+
+                if (property.isList) {
+                    const size_t countSize = FileIO::typeSize(property.countType);
+                    if (!(ok = fill(countSize))) break;
+                    size_t count = 0;
+                    if (!(ok = readListCount(reinterpret_cast<const unsigned char*>(window.data() + begin),
+                                             property.countType, swap, valueSize,
+                                             bodyBytes - std::min(bodyBytes, consumed + countSize), count))) break;
+                    skip(countSize);
+                    if (!(ok = fill(count * valueSize))) break;
+
+                    if (isFace && column == columns.indexList) {
+                        if (count != 3) {
+                            std::cerr << "Error: Only triangular faces are supported" << std::endl;
+                            return false;
+                        }
+                        const unsigned char* p = reinterpret_cast<const unsigned char*>(window.data() + begin);
+                        unsigned int index[3];
+                        for (int k = 0; k < 3; k++) {
+                            if (!readFaceIndex(p + k * valueSize, property.type, swap, nVertices, index[k])) {
+                                std::cerr << "Error: Face " << row << " references a missing vertex" << std::endl;
+                                return false;
+                            }
+                        }
+                        faceBatch.emplace_back(index[0], index[1], index[2]);
+                    }
+                    skip(count * valueSize);
+                } else {
+                    if (!(ok = fill(valueSize))) break;
+                    if (isVertex && (column == columns.x || column == columns.y || column == columns.z)) {
+                        const float value = static_cast<float>(readBinaryValue(
+                            reinterpret_cast<const unsigned char*>(window.data() + begin), property.type, swap));
+                        if (column == columns.x) position[0] = value;
+                        else if (column == columns.y) position[1] = value;
+                        else position[2] = value;
+                    }
+                    skip(valueSize);
+                }
+            }
+            if (!ok) {
+                std::cerr << "Error: Malformed or truncated " << element.name << " data" << std::endl;
+                return false;
+            }
+            if (isVertex) vertexBatch.emplace_back(position[0], position[1], position[2]);
+        }
+
+        if (vertexBatch.size() == kStreamBatchRows) {
+            if (!onVertices(vertexBatch.data(), vertexBatch.size())) return false;
+            vertexBatch.clear();
+        }
+        if (faceBatch.size() == kStreamBatchRows) {
+            if (!onFaces(faceBatch.data(), faceBatch.size())) return false;
+            faceBatch.clear();
+        }
+    }
+    if (!vertexBatch.empty() && !onVertices(vertexBatch.data(), vertexBatch.size())) return false;
+    if (!faceBatch.empty() && !onFaces(faceBatch.data(), faceBatch.size())) return false;
+    return true;
+}
+
+bool PLYStreamReader::read(const VertexCallback& onVertices, const FaceCallback& onFaces) {
+    if (!file.is_open()) return false;
+
+    // Rewind to the first data byte
+    file.clear();
+    file.seekg(static_cast<std::streamoff>(header.dataOffset), std::ios::beg);
+    begin = end = consumed = 0;
+    atEof = false;
+    window[0] = '\0';
+
+    const FileIO::PLYElement* vertexElement = header.findElement("vertex");
+    if (vertexElement) {
+        const Columns columns(*vertexElement);
+        if (columns.x < 0 || columns.y < 0 || columns.z < 0) {
+            std::cerr << "Error: Vertex element lacks x/y/z properties" << std::endl;
+            return false;
+        }
+    }
+
+    // Last element anyone asked for
+    size_t last = 0;
+    bool any = false;
+    for (size_t i = 0; i < header.elements.size(); i++) {
+        const auto& element = header.elements[i];
+        if ((onVertices && &element == vertexElement) || (onFaces && element.name == "face")) {
+            last = i;
+            any = true;
+        }
+    }
+    if (!any) return true;
+
+    for (size_t i = 0; i <= last; i++) {
+        const auto& element = header.elements[i];
+        const bool isVertex = onVertices && &element == vertexElement;
+        const bool isFace = onFaces && element.name == "face";
+        const bool ok = (header.format == FileIO::PLYFormat::Ascii)
+            ? readAsciiElement(element, isVertex, isFace, onVertices, onFaces)
+            : readBinaryElement(element, isVertex, isFace, onVertices, onFaces);
+        if (!ok) return false;
+    }
+    return true;
+}
@@ -1,17 +1,129 @@
 #pragma once
 #include <string>
 #include <vector>
+#include <istream>
+#include <fstream>
+#include <functional>
 #include "../mesh/mesh.hpp"
 
 class FileIO {
 public:
-    static bool loadOBJ(const std::string& filename, 
+    // Throughput figures reported by the PLY loaders
+    struct LoadStats {
+        size_t bytes = 0;      // Size of the input file
+        size_t elements = 0;   // Vertices + faces parsed
+        double seconds = 0.0;  // Wall time for read + parse
+
+        double megabytesPerSecond() const {
+            return seconds > 0.0 ? (bytes / (1024.0 * 1024.0)) / seconds : 0.0;
+        }
+        double elementsPerSecond() const {
+            return seconds > 0.0 ? elements / seconds : 0.0;
+        }
+    };
+
+    enum class PLYFormat { Ascii, BinaryLittleEndian, BinaryBigEndian };
+
+    enum class PLYType { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64 };
+
+    // One "property" line of the header
+    struct PLYProperty {
+        std::string name;
+        PLYType type = PLYType::Float32;       // Value type (list entries for lists)
+        bool isList = false;
+        PLYType countType = PLYType::UInt8;    // Only meaningful for lists
+    };
+
+    // One "element" line of the header with the properties that follow it
+    struct PLYElement {
+        std::string name;
+        size_t count = 0;
+        std::vector<PLYProperty> properties;
+
+        int findProperty(const std::string& propertyName) const;
+        // Bytes per row in binary files, or 0 if the row has list properties
+        size_t fixedStride() const;
+    };
+
+    struct PLYHeader {
+        PLYFormat format = PLYFormat::Ascii;
+        std::vector<PLYElement> elements;
+        size_t dataOffset = 0;  // Byte offset of the first data row
+
+        const PLYElement* findElement(const std::string& elementName) const;
+    };
+
+    static bool loadOBJ(const std::string& filename,
                        std::vector<Vector3>& vertices,
                        std::vector<Face>& faces);
-                       
+
+    // Loads ASCII or binary (little/big endian) PLY files, using the header's
+    // property schema to pick out x/y/z and the triangle index list
     static bool loadPLY(const std::string& filename,
                        std::vector<Vector3>& vertices,
-                       std::vector<Face>& faces);
+                       std::vector<Face>& faces,
+                       LoadStats* stats = nullptr);
+
+    // Writes float x/y/z vertices and "list uchar int" faces. Given one
+    // normal per vertex, each vertex also gets float nx/ny/nz.
+    static bool savePLY(const std::string& filename,
+                       const std::vector<Vector3>& vertices,
+                       const std::vector<Face>& faces,
+                       PLYFormat format = PLYFormat::BinaryLittleEndian,
+                       const std::vector<Vector3>* normals = nullptr);
+
+    // Parses the header and leaves the stream at the first data byte
+    static bool readPLYHeader(std::istream& file, PLYHeader& header);
+
+    static size_t typeSize(PLYType type);
+};
+
+// Reads a PLY body element by element through a fixed-size window, so the
+// file is never held in memory at once. Positions and triangles are handed
+// to callbacks in batches, in file order; other elements and properties
+// are skipped. ASCII files must have one element row per line.
+class PLYStreamReader {
+public:
+    static constexpr size_t kDefaultWindowBytes = size_t(16) << 20;  // 16 MB
+
+    // Return false to stop reading
+    using VertexCallback = std::function<bool(const Vector3* vertices, size_t count)>;
+    using FaceCallback = std::function<bool(const Face* faces, size_t count)>;
+
+    explicit PLYStreamReader(size_t windowBytes = kDefaultWindowBytes);
+
+    bool open(const std::string& filename);
+    const FileIO::PLYHeader& getHeader() const { return header; }
+    size_t vertexCount() const;
+    size_t faceCount() const;
+
+    // Streams the body from the start. A null callback skips its element,
+    // and reading stops after the last element that has a callback, so a
+    // vertex-only pass never touches the faces. Can be called again for
+    // another pass over the file.
+    bool read(const VertexCallback& onVertices, const FaceCallback& onFaces);
+
+    // Body bytes consumed by the last read()
+    size_t bytesRead() const { return consumed; }
+
 private:
-    static bool readPLYHeader(std::ifstream& file, int& nVertices, int& nFaces);
-};
\ No newline at end of file
+    std::string filename;
+    std::ifstream file;
+    FileIO::PLYHeader header;
+
+    // Unread bytes are window[begin, end); window[end] is always NUL
+    std::vector<char> window;
+    size_t begin = 0;
+    size_t end = 0;
+    size_t consumed = 0;
+    size_t bodyBytes = 0;  // File bytes after the header
+    bool atEof = false;
+
+    bool fill(size_t bytes);
+    void skip(size_t bytes);
+    bool nextLine(const char*& lineBegin, const char*& lineEnd);
+    bool readAsciiElement(const FileIO::PLYElement& element, bool isVertex, bool isFace,
+                          const VertexCallback& onVertices, const FaceCallback& onFaces);
+    bool readBinaryElement(const FileIO::PLYElement& element, bool isVertex, bool isFace,
+                           const VertexCallback& onVertices, const FaceCallback& onFaces);
+};
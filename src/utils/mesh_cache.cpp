@@ -0,0 +1,278 @@
+#include "mesh_cache.hpp"
+#include "parallel.hpp"
+#include "trace.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+
+namespace fs = std::filesystem;
+
+static_assert(sizeof(Vector3) == 12 && std::is_trivially_copyable<Vector3>::value,
+              "cache blocks store Vector3 records as they are in memory");
+static_assert(sizeof(Face) == 24 && std::is_trivially_copyable<Face>::value,
+              "cache blocks store Face records as they are in memory");
+
+namespace {
+
+const char kMagic[8] = {'M', 'E', 'S', 'H', 'C', 'A', 'C', 'H'};
+// Reads back byte-swapped on a host of the other endianness
+const uint32_t kByteOrderMark = 0x01020304u;
+const size_t kBlockAlignment = 64;
+// Checksums are computed per block of this size, in parallel
+const size_t kChecksumBlock = size_t(1) << 20;
+// The source hash reads this many evenly spaced samples of kSampleBytes
+const size_t kSampleCount = 16;
+const size_t kSampleBytes = size_t(64) << 10;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t sourceSize;
+    int64_t sourceTime;   // Modification time in file clock ticks
+    uint64_t sourceHash;
+    uint32_t flags;
+    float scale;
+    float center[3];
+    float min[3];
+    float max[3];
+    uint64_t vertexCount;
+    uint64_t faceCount;
+    uint64_t vertexOffset;
+    uint64_t faceOffset;
+    uint64_t checksum;    // Of the header with this field zero and both blocks
+};
+static_assert(sizeof(Header) == 128, "header layout is part of the format");
+
+struct SourceStamp {
+    uint64_t size = 0;
+    int64_t time = 0;
+    uint64_t hash = 0;
+};
+
+inline uint64_t mix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+uint64_t hashBytes(const unsigned char* data, size_t size, uint64_t seed) {
+    uint64_t h = mix(seed ^ size);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        h = (h ^ word) * 0x9E3779B97F4A7C15ULL;
+        h ^= h >> 32;
+    }
+    for (; i < size; i++) h = (h ^ data[i]) * 0x100000001B3ULL;
+    return mix(h);
+}
+
+// Hash of size bytes from 1 MB blocks hashed in parallel and combined in
+// order, so it does not depend on the thread count
+uint64_t hashBlocks(const void* data, size_t size, uint64_t seed) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    const size_t blocks = (size + kChecksumBlock - 1) / kChecksumBlock;
+    std::vector<uint64_t> blockHashes(blocks);
+    Parallel::forChunks(blocks, Parallel::chunkCount(blocks, Parallel::resolveThreadCount(0), 1),
+        [&](unsigned, size_t begin, size_t end) {
+            for (size_t block = begin; block < end; block++) {
+                const size_t offset = block * kChecksumBlock;
+                blockHashes[block] = hashBytes(bytes + offset, std::min(kChecksumBlock, size - offset), block);
+            }
+        });
+    uint64_t h = mix(seed ^ size);
+    for (uint64_t blockHash : blockHashes) h = mix(h ^ blockHash);
+    return h;
+}
+
+uint64_t checksumOf(Header header, const void* vertices, const void* faces) {
+    header.checksum = 0;
+    uint64_t h = hashBytes(reinterpret_cast<const unsigned char*>(&header), sizeof(header), 0);
+    h = hashBlocks(vertices, header.vertexCount * sizeof(Vector3), h);
+    return hashBlocks(faces, header.faceCount * sizeof(Face), h);
+}
+
+// Size, modification time and a hash of kSampleCount evenly spaced samples
+// (the whole file if it is smaller), so stamping a large scan reads only
+// about 1 MB of it
+bool stampSource(const std::string& source, SourceStamp& stamp) {
+    std::error_code error;
+    stamp.size = fs::file_size(source, error);
+    if (error) return false;
+    stamp.time = static_cast<int64_t>(fs::last_write_time(source, error).time_since_epoch().count());
+    if (error) return false;
+
+    std::ifstream file(source, std::ios::binary);
+    if (!file) return false;
+    std::vector<unsigned char> sample;
+    uint64_t h = mix(stamp.size);
+    const bool whole = stamp.size <= kSampleCount * kSampleBytes;
+    const size_t samples = whole ? 1 : kSampleCount;
+    for (size_t i = 0; i < samples; i++) {
+        const size_t bytes = whole ? stamp.size : kSampleBytes;
+        const uint64_t offset = whole ? 0 : (stamp.size - kSampleBytes) / (kSampleCount - 1) * i;
+        sample.resize(bytes);
+        file.seekg(static_cast<std::streamoff>(offset));
+        if (!file.read(reinterpret_cast<char*>(sample.data()), bytes)) return false;
+        h = mix(h ^ hashBytes(sample.data(), bytes, offset));
+    }
+    stamp.hash = h;
+    return true;
+}
+
+size_t alignUp(size_t offset) {
+    return (offset + kBlockAlignment - 1) / kBlockAlignment * kBlockAlignment;
+}
+
+// Read-only mapping of a whole file
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        descriptor = open(path.c_str(), O_RDONLY);
+        if (descriptor < 0) return;
+        struct stat info;
+        if (fstat(descriptor, &info) != 0 || info.st_size <= 0) return;
+        void* mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (mapped == MAP_FAILED) return;
+        data = static_cast<const unsigned char*>(mapped);
+        size = static_cast<size_t>(info.st_size);
+        // Every byte is read once, front to back
+        madvise(mapped, size, MADV_SEQUENTIAL);
+    }
+    ~MappedFile() {
+        if (data) munmap(const_cast<unsigned char*>(data), size);
+        if (descriptor >= 0) close(descriptor);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+
+private:
+    int descriptor = -1;
+};
+
+} // namespace
+
+std::string MeshCache::pathFor(const std::string& source) {
+    return source + ".meshcache";
+}
+
+bool MeshCache::read(const std::string& cachePath, const std::string& source, uint32_t flags,
+                     std::vector<Vector3>& vertices, std::vector<Face>& faces, Transform& transform) {
+    Trace::Scope trace("MeshCache::read");
+    SourceStamp stamp;
+    MappedFile file(cachePath);
+    if (!file.data || file.size < sizeof(Header) || !stampSource(source, stamp)) {
+        Trace::count("mesh_cache_misses", 1);
+        return false;
+    }
+
+    Header header;
+    std::memcpy(&header, file.data, sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+        header.byteOrder != kByteOrderMark || header.flags != flags || header.sourceSize != stamp.size ||
+        header.sourceTime != stamp.time || header.sourceHash != stamp.hash) {
+        Trace::count("mesh_cache_misses", 1);
+        return false;
+    }
+
+    // Blocks must be aligned, in order and inside the file
+    const bool laidOut = header.vertexOffset >= sizeof(Header) && header.vertexOffset <= file.size &&
+                         header.vertexOffset % kBlockAlignment == 0 &&
+                         header.faceOffset % kBlockAlignment == 0 &&
+                         header.vertexCount <= (file.size - header.vertexOffset) / sizeof(Vector3) &&
+                         header.vertexOffset + header.vertexCount * sizeof(Vector3) <= header.faceOffset &&
+                         header.faceOffset <= file.size &&
+                         header.faceCount <= (file.size - header.faceOffset) / sizeof(Face);
+    const Vector3* vertexBlock = reinterpret_cast<const Vector3*>(file.data + header.vertexOffset);
+    const Face* faceBlock = reinterpret_cast<const Face*>(file.data + header.faceOffset);
+    if (!laidOut || checksumOf(header, vertexBlock, faceBlock) != header.checksum) {
+        std::cerr << "Error: Mesh cache " << cachePath << " is corrupt; reloading " << source << std::endl;
+        Trace::count("mesh_cache_misses", 1);
+        return false;
+    }
+
+    vertices.assign(vertexBlock, vertexBlock + header.vertexCount);
+    faces.assign(faceBlock, faceBlock + header.faceCount);
+    transform.center = Vector3(header.center[0], header.center[1], header.center[2]);
+    transform.scale = header.scale;
+    transform.min = Vector3(header.min[0], header.min[1], header.min[2]);
+    transform.max = Vector3(header.max[0], header.max[1], header.max[2]);
+    Trace::count("mesh_cache_hits", 1);
+    Trace::count("bytes_mapped", static_cast<int64_t>(file.size));
+    return true;
+}
+
+bool MeshCache::write(const std::string& cachePath, const std::string& source, uint32_t flags,
+                      const std::vector<Vector3>& vertices, const std::vector<Face>& faces,
+                      const Transform& transform) {
+    Trace::Scope trace("MeshCache::write");
+    SourceStamp stamp;
+    if (!stampSource(source, stamp)) {
+        std::cerr << "Error: Could not read " << source << std::endl;
+        return false;
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byteOrder = kByteOrderMark;
+    header.sourceSize = stamp.size;
+    header.sourceTime = stamp.time;
+    header.sourceHash = stamp.hash;
+    header.flags = flags;
+    header.scale = transform.scale;
+    const Vector3* corners[3] = {&transform.center, &transform.min, &transform.max};
+    float* fields[3] = {header.center, header.min, header.max};
+    for (int i = 0; i < 3; i++) {
+        fields[i][0] = corners[i]->x;
+        fields[i][1] = corners[i]->y;
+        fields[i][2] = corners[i]->z;
+    }
+    header.vertexCount = vertices.size();
+    header.faceCount = faces.size();
+    header.vertexOffset = alignUp(sizeof(Header));
+    header.faceOffset = alignUp(header.vertexOffset + vertices.size() * sizeof(Vector3));
+    header.checksum = checksumOf(header, vertices.data(), faces.data());
+
+    // Written under a temporary name and renamed into place
+    const std::string temporaryPath = cachePath + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        const char padding[kBlockAlignment] = {};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(padding, header.vertexOffset - sizeof(header));
+        file.write(reinterpret_cast<const char*>(vertices.data()), vertices.size() * sizeof(Vector3));
+        file.write(padding, header.faceOffset - header.vertexOffset - vertices.size() * sizeof(Vector3));
+        file.write(reinterpret_cast<const char*>(faces.data()), faces.size() * sizeof(Face));
+        if (!file) {
+            std::cerr << "Error: Could not write mesh cache " << cachePath << std::endl;
+            file.close();
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+    }
+    std::error_code error;
+    fs::rename(temporaryPath, cachePath, error);
+    if (error) {
+        std::cerr << "Error: Could not write mesh cache " << cachePath << std::endl;
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
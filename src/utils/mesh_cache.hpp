@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../mesh/mesh.hpp"
+
+// Binary cache of a loaded mesh, so a restart skips parsing, centering and
+// normals.
+//
+// The file is a 128-byte header followed by the vertex block (Vector3
+// records) and the face block (Face records: indices and normal together),
+// each starting on a 64-byte boundary. The header records the format
+// version, the byte order, the size, modification time and a sampled
+// content hash of the source file, the load flags, the transform
+// loadFromPLY applied and a checksum of both blocks. A cache is used only if
+// all of these still match; otherwise it counts as a miss and the caller
+// reloads the source. Files are memory mapped, verified in parallel 1 MB
+// blocks and copied into the mesh with one bulk copy per block. Caches are
+// written to a temporary name and renamed, so a reader never sees a
+// partial file.
+class MeshCache {
+public:
+    static constexpr uint32_t kVersion = 1;
+
+    // Load options that change the cached contents
+    enum Flags : uint32_t {
+        kMortonOrder = 1,
+    };
+
+    // What loadFromPLY did to the source coordinates
+    struct Transform {
+        Vector3 center;
+        float scale = 1.0f;
+        Vector3 min, max;  // Bounds after the transform
+    };
+
+    // Default cache location: the source path with ".meshcache" appended
+    static std::string pathFor(const std::string& source);
+
+    // Fills vertices, faces and transform from cachePath if it was written
+    // from source as it is now, with the same flags. A missing or stale
+    // cache returns false quietly; a corrupt one also reports an error.
+    static bool read(const std::string& cachePath, const std::string& source, uint32_t flags,
+                     std::vector<Vector3>& vertices, std::vector<Face>& faces, Transform& transform);
+
+    static bool write(const std::string& cachePath, const std::string& source, uint32_t flags,
+                      const std::vector<Vector3>& vertices, const std::vector<Face>& faces,
+                      const Transform& transform);
+};
@@ -0,0 +1,719 @@
+#include "mesh_codec.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+namespace {
+
+const char kMagic[8] = {'M', 'E', 'S', 'H', 'P', 'A', 'C', 'K'};
+const uint32_t kNone = 0xFFFFFFFFu;
+
+// A triangle code byte holds the shared edge in its high nibble (0-14, or
+// kNoEdge) and the coded vertex in its low nibble: kNewVertex, a FIFO
+// position 1-14, or kBackReference followed by an explicit reference.
+// A triangle with no shared edge codes all three vertices, the second and
+// third in a second byte.
+const uint32_t kEdgeFifoSize = 15;
+const uint32_t kNoEdge = 15;
+const uint32_t kVertexFifoSize = 14;
+const uint32_t kNewVertex = 0;
+const uint32_t kBackReference = 15;
+
+// rANS: 12-bit probabilities, 32-bit states renormalized a byte at a time
+const uint32_t kProbBits = 12;
+const uint32_t kProbScale = 1u << kProbBits;
+const uint32_t kRansLow = 1u << 23;
+
+// Decodes are repeated until they have taken this long, keeping the best
+const double kMinTimingSeconds = 0.05;
+const int kMaxTimingRuns = 100;
+
+void put32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+void putFloat(std::vector<uint8_t>& out, float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, 4);
+    put32(out, bits);
+}
+
+inline void putVarint(std::vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+inline uint32_t load32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+inline uint32_t zigzag(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+inline int32_t unzigzag(uint32_t value) {
+    return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+// Bounds-checked reads from an encoded buffer; any overrun clears ok
+struct Reader {
+    const uint8_t* p;
+    const uint8_t* end;
+    bool ok = true;
+
+    bool has(size_t bytes) {
+        if (ok && static_cast<size_t>(end - p) >= bytes) return true;
+        ok = false;
+        return false;
+    }
+    uint8_t get8() { return has(1) ? *p++ : 0; }
+    uint16_t get16() {
+        if (!has(2)) return 0;
+        const uint16_t value = static_cast<uint16_t>(p[0] | (p[1] << 8));
+        p += 2;
+        return value;
+    }
+    uint32_t get32() {
+        if (!has(4)) return 0;
+        const uint32_t value = load32(p);
+        p += 4;
+        return value;
+    }
+    float getFloat() {
+        const uint32_t bits = get32();
+        float value;
+        std::memcpy(&value, &bits, 4);
+        return value;
+    }
+    uint32_t getVarint() {
+        uint32_t value = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            if (!has(1)) return 0;
+            const uint8_t byte = *p++;
+            value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        ok = false;
+        return 0;
+    }
+};
+
+// Scales symbol counts to frequencies summing to kProbScale, keeping every
+// present symbol at 1 or more
+void normalize(const uint32_t counts[256], size_t total, uint32_t freq[256]) {
+    uint32_t sum = 0;
+    int largest = -1;
+    for (int s = 0; s < 256; s++) {
+        freq[s] = 0;
+        if (counts[s] == 0) continue;
+        freq[s] = std::max<uint32_t>(1, static_cast<uint32_t>(uint64_t(counts[s]) * kProbScale / total));
+        sum += freq[s];
+        if (largest < 0 || counts[s] > counts[largest]) largest = s;
+    }
+    while (sum > kProbScale) {
+        int top = 0;
+        for (int s = 1; s < 256; s++) {
+            if (freq[s] > freq[top]) top = s;
+        }
+        freq[top]--;
+        sum--;
+    }
+    freq[largest] += kProbScale - sum;
+}
+
+// Appends a stream: symbol count, frequency table, then the rANS bytes
+void encodeStream(const std::vector<uint8_t>& symbols, std::vector<uint8_t>& out) {
+    put32(out, static_cast<uint32_t>(symbols.size()));
+    if (symbols.empty()) return;
+
+    uint32_t counts[256] = {};
+    for (uint8_t s : symbols) counts[s]++;
+    uint32_t freq[256], start[256];
+    normalize(counts, symbols.size(), freq);
+    int distinct = 0;
+    for (int s = 0, cumulative = 0; s < 256; s++) {
+        start[s] = cumulative;
+        cumulative += freq[s];
+        if (freq[s] > 0) distinct++;
+    }
+    out.push_back(static_cast<uint8_t>(distinct - 1));
+    for (int s = 0; s < 256; s++) {
+        if (freq[s] == 0) continue;
+        out.push_back(static_cast<uint8_t>(s));
+        out.push_back(static_cast<uint8_t>(freq[s]));
+        out.push_back(static_cast<uint8_t>(freq[s] >> 8));
+    }
+
+    // Symbols are coded last to first, alternating between two states, and
+    // the bytes written back to front so the decoder reads forward. A
+    // symbol of frequency 1 or more emits at most two bytes.
+    std::vector<uint8_t> buffer(symbols.size() * 2 + 8);
+    uint8_t* ptr = buffer.data() + buffer.size();
+    uint32_t state[2] = {kRansLow, kRansLow};
+    for (size_t i = symbols.size(); i-- > 0;) {
+        uint32_t& x = state[i & 1];
+        const uint8_t s = symbols[i];
+        const uint32_t xMax = ((kRansLow >> kProbBits) << 8) * freq[s];
+        while (x >= xMax) {
+            *--ptr = static_cast<uint8_t>(x);
+            x >>= 8;
+        }
+        x = ((x / freq[s]) << kProbBits) + (x % freq[s]) + start[s];
+    }
+    // State 0 ends up first, where the decoder reads it first
+    for (int k = 1; k >= 0; k--) {
+        ptr -= 4;
+        for (int i = 0; i < 4; i++) ptr[i] = static_cast<uint8_t>(state[k] >> (8 * i));
+    }
+
+    const size_t bytes = buffer.data() + buffer.size() - ptr;
+    put32(out, static_cast<uint32_t>(bytes));
+    out.insert(out.end(), ptr, ptr + bytes);
+}
+
+bool decodeStream(Reader& in, std::vector<uint8_t>& symbols) {
+    const uint32_t count = in.get32();
+    if (!in.ok) return false;
+    symbols.resize(count);
+    if (count == 0) return true;
+
+    uint32_t freq[256] = {}, start[256] = {};
+    const int distinct = in.get8() + 1;
+    for (int i = 0; i < distinct; i++) {
+        const uint8_t s = in.get8();
+        freq[s] = in.get16();
+    }
+    uint8_t slotSymbol[kProbScale];
+    uint32_t cumulative = 0;
+    for (int s = 0; s < 256; s++) {
+        start[s] = cumulative;
+        if (cumulative + freq[s] > kProbScale) return false;
+        std::memset(slotSymbol + cumulative, s, freq[s]);
+        cumulative += freq[s];
+    }
+    const uint32_t bytes = in.get32();
+    if (!in.ok || cumulative != kProbScale || bytes < 8 || !in.has(bytes)) return false;
+
+    const uint8_t* ptr = in.p;
+    const uint8_t* end = ptr + bytes;
+    in.p = end;
+    uint32_t state[2] = {load32(ptr), load32(ptr + 4)};
+    ptr += 8;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t& x = state[i & 1];
+        const uint32_t slot = x & (kProbScale - 1);
+        const uint8_t s = slotSymbol[slot];
+        x = freq[s] * (x >> kProbBits) + slot - start[s];
+        while (x < kRansLow) {
+            if (ptr == end) return false;
+            x = (x << 8) | *ptr++;
+        }
+        symbols[i] = s;
+    }
+    return true;
+}
+
+// FIFOs of recent edges and vertices, identical on both sides
+struct CodingState {
+    struct Edge {
+        uint32_t a = kNone, b = kNone, opposite = kNone;
+    };
+
+    Edge edges[kEdgeFifoSize];
+    uint32_t vertices[kVertexFifoSize];
+    uint32_t edgeHead = 0, vertexHead = 0;
+
+    CodingState() { std::fill(vertices, vertices + kVertexFifoSize, kNone); }
+
+    // i-th most recent entries
+    const Edge& edge(uint32_t i) const {
+        const uint32_t slot = edgeHead + kEdgeFifoSize - 1 - i;
+        return edges[slot < kEdgeFifoSize ? slot : slot - kEdgeFifoSize];
+    }
+    uint32_t vertex(uint32_t i) const {
+        const uint32_t slot = vertexHead + kVertexFifoSize - 1 - i;
+        return vertices[slot < kVertexFifoSize ? slot : slot - kVertexFifoSize];
+    }
+
+    void pushVertex(uint32_t v) {
+        vertices[vertexHead] = v;
+        if (++vertexHead == kVertexFifoSize) vertexHead = 0;
+    }
+
+    // The edges of triangle (a, b, c) as a neighbour would walk them
+    void pushTriangle(uint32_t a, uint32_t b, uint32_t c) {
+        const Edge added[3] = {{b, a, c}, {c, b, a}, {a, c, b}};
+        for (const Edge& e : added) {
+            edges[edgeHead] = e;
+            if (++edgeHead == kEdgeFifoSize) edgeHead = 0;
+        }
+    }
+};
+
+// Quantized positions, three per vertex, with the shared predictors
+struct Grid {
+    std::vector<int32_t> q;
+    int32_t steps = 0;
+
+    void previous(uint32_t next, int32_t pred[3]) const {
+        for (int a = 0; a < 3; a++) pred[a] = next > 0 ? q[3 * (next - 1) + a] : 0;
+    }
+    void copy(uint32_t v, int32_t pred[3]) const {
+        for (int a = 0; a < 3; a++) pred[a] = q[3 * v + a];
+    }
+    void parallelogram(uint32_t x, uint32_t y, uint32_t opposite, int32_t pred[3]) const {
+        for (int a = 0; a < 3; a++) {
+            const int32_t p = q[3 * x + a] + q[3 * y + a] - q[3 * opposite + a];
+            pred[a] = std::min(std::max(p, 0), steps);
+        }
+    }
+};
+
+struct Bounds {
+    float min[3] = {0.0f, 0.0f, 0.0f};
+    float max[3] = {0.0f, 0.0f, 0.0f};
+};
+
+inline float coord(const Vector3& v, int axis) {
+    return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+Bounds boundsOf(const std::vector<Vector3>& vertices) {
+    Bounds box;
+    if (vertices.empty()) return box;
+    for (int a = 0; a < 3; a++) box.min[a] = box.max[a] = coord(vertices[0], a);
+    for (const Vector3& v : vertices) {
+        for (int a = 0; a < 3; a++) {
+            box.min[a] = std::min(box.min[a], coord(v, a));
+            box.max[a] = std::max(box.max[a], coord(v, a));
+        }
+    }
+    return box;
+}
+
+// Order to code faces in: a depth-first walk across shared edges, so most
+// triangles border one coded just before and find that edge in the FIFO.
+// Each face's neighbours are stacked so the one across the edge entering
+// the FIFO last is taken first. An exhausted walk restarts at the first
+// face not yet coded.
+void walkOrder(size_t vertexCount, const std::vector<Face>& faces, std::vector<uint32_t>& order) {
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (const Face& f : faces) {
+        offsets[f.v1 + 1]++;
+        offsets[f.v2 + 1]++;
+        offsets[f.v3 + 1]++;
+    }
+    for (size_t v = 0; v < vertexCount; v++) offsets[v + 1] += offsets[v];
+    std::vector<uint32_t> incident(offsets.back());
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (uint32_t i = 0; i < faces.size(); i++) {
+        incident[fill[faces[i].v1]++] = i;
+        incident[fill[faces[i].v2]++] = i;
+        incident[fill[faces[i].v3]++] = i;
+    }
+
+    std::vector<uint8_t> coded(faces.size(), 0);
+    std::vector<uint32_t> stack;
+    order.clear();
+    order.reserve(faces.size());
+    uint32_t restart = 0;
+    while (order.size() < faces.size()) {
+        if (stack.empty()) {
+            while (coded[restart]) restart++;
+            stack.push_back(restart);
+        }
+        const uint32_t i = stack.back();
+        stack.pop_back();
+        if (coded[i]) continue;
+        coded[i] = 1;
+        order.push_back(i);
+
+        // A neighbour across edge x -> y runs y -> x
+        const uint32_t corner[3] = {faces[i].v1, faces[i].v2, faces[i].v3};
+        for (int e = 0; e < 3; e++) {
+            const uint32_t x = corner[e], y = corner[(e + 1) % 3];
+            for (uint32_t k = offsets[y]; k < offsets[y + 1]; k++) {
+                const uint32_t g = incident[k];
+                if (coded[g]) continue;
+                const Face& f = faces[g];
+                if ((f.v1 == y && f.v2 == x) || (f.v2 == y && f.v3 == x) || (f.v3 == y && f.v1 == x)) {
+                    stack.push_back(g);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+bool MeshCodec::encode(const std::vector<Vector3>& vertices, const std::vector<Face>& faces, int bits,
+                       std::vector<uint8_t>& out, std::vector<uint32_t>* newIndexOf,
+                       std::vector<uint32_t>* faceSource) {
+    if (bits < kMinBits || bits > kMaxBits) {
+        std::cerr << "Error: MeshCodec bit depth must be between " << kMinBits << " and " << kMaxBits << std::endl;
+        return false;
+    }
+    if (vertices.size() >= kNone || faces.size() >= kNone) {
+        std::cerr << "Error: Mesh too large for MeshCodec" << std::endl;
+        return false;
+    }
+    for (const Face& f : faces) {
+        if (f.v1 >= vertices.size() || f.v2 >= vertices.size() || f.v3 >= vertices.size()) {
+            std::cerr << "Error: Face index out of range" << std::endl;
+            return false;
+        }
+    }
+    Trace::Scope trace("MeshCodec::encode");
+
+    const Bounds box = boundsOf(vertices);
+    Grid grid;
+    grid.steps = static_cast<int32_t>((1u << bits) - 1);
+    grid.q.resize(3 * vertices.size());
+    double toGrid[3];
+    for (int a = 0; a < 3; a++) {
+        const double extent = double(box.max[a]) - box.min[a];
+        toGrid[a] = extent > 0.0 ? grid.steps / extent : 0.0;
+    }
+
+    std::vector<uint32_t> newIndex(vertices.size(), kNone);
+    std::vector<uint8_t> codes, references, residuals;
+    codes.reserve(faces.size() + faces.size() / 4);
+    residuals.reserve(vertices.size() * 6);
+    CodingState state;
+    uint32_t next = 0;
+
+    // Numbers a new vertex and stores its residual from pred
+    auto addVertex = [&](uint32_t source, const int32_t pred[3]) {
+        const uint32_t id = next++;
+        newIndex[source] = id;
+        const Vector3& v = vertices[source];
+        for (int a = 0; a < 3; a++) {
+            const double cell = std::floor((double(coord(v, a)) - box.min[a]) * toGrid[a] + 0.5);
+            const int32_t value = static_cast<int32_t>(std::min<double>(std::max(cell, 0.0), grid.steps));
+            grid.q[3 * id + a] = value;
+            putVarint(residuals, zigzag(value - pred[a]));
+        }
+        return id;
+    };
+
+    // Codes one corner and returns its nibble
+    auto codeVertex = [&](uint32_t source, const int32_t pred[3]) -> uint32_t {
+        uint32_t id = newIndex[source];
+        if (id == kNone) {
+            state.pushVertex(addVertex(source, pred));
+            return kNewVertex;
+        }
+        for (uint32_t i = 0; i < kVertexFifoSize; i++) {
+            if (state.vertex(i) == id) return i + 1;
+        }
+        putVarint(references, next - 1 - id);
+        state.pushVertex(id);
+        return kBackReference;
+    };
+
+    std::vector<uint32_t> order;
+    walkOrder(vertices.size(), faces, order);
+
+    int32_t pred[3];
+    for (uint32_t f : order) {
+        const Face& face = faces[f];
+        const uint32_t source[3] = {face.v1, face.v2, face.v3};
+        const uint32_t id[3] = {newIndex[face.v1], newIndex[face.v2], newIndex[face.v3]};
+
+        // Most recent FIFO edge the triangle shares, and the rotation that
+        // puts it first
+        uint32_t edge = kNoEdge, rotation = 0;
+        for (uint32_t i = 0; i < kEdgeFifoSize && edge == kNoEdge; i++) {
+            const CodingState::Edge& e = state.edge(i);
+            if (e.a == kNone) break;
+            for (uint32_t r = 0; r < 3; r++) {
+                if (id[r] == e.a && id[(r + 1) % 3] == e.b) {
+                    edge = i;
+                    rotation = r;
+                    break;
+                }
+            }
+        }
+
+        uint32_t a, b, c;
+        if (edge != kNoEdge) {
+            const CodingState::Edge& e = state.edge(edge);
+            a = e.a;
+            b = e.b;
+            grid.parallelogram(a, b, e.opposite, pred);
+            const uint32_t third = source[(rotation + 2) % 3];
+            codes.push_back(static_cast<uint8_t>(edge << 4 | codeVertex(third, pred)));
+            c = newIndex[third];
+        } else {
+            grid.previous(next, pred);
+            const uint32_t first = codeVertex(source[0], pred);
+            a = newIndex[source[0]];
+            grid.copy(a, pred);
+            const uint32_t second = codeVertex(source[1], pred);
+            b = newIndex[source[1]];
+            grid.copy(b, pred);
+            const uint32_t third = codeVertex(source[2], pred);
+            c = newIndex[source[2]];
+            codes.push_back(static_cast<uint8_t>(kNoEdge << 4 | first));
+            codes.push_back(static_cast<uint8_t>(second << 4 | third));
+        }
+        state.pushTriangle(a, b, c);
+    }
+
+    // Vertices no face uses, each predicted by the one before
+    for (uint32_t v = 0; v < vertices.size(); v++) {
+        if (newIndex[v] != kNone) continue;
+        grid.previous(next, pred);
+        addVertex(v, pred);
+    }
+
+    out.assign(kMagic, kMagic + sizeof(kMagic));
+    put32(out, kVersion);
+    put32(out, static_cast<uint32_t>(bits));
+    put32(out, static_cast<uint32_t>(vertices.size()));
+    put32(out, static_cast<uint32_t>(faces.size()));
+    for (int a = 0; a < 3; a++) putFloat(out, box.min[a]);
+    for (int a = 0; a < 3; a++) putFloat(out, box.max[a]);
+    encodeStream(codes, out);
+    encodeStream(references, out);
+    encodeStream(residuals, out);
+
+    if (newIndexOf) newIndexOf->swap(newIndex);
+    if (faceSource) faceSource->swap(order);
+    Trace::count("codec_triangle_code_bytes", static_cast<int64_t>(codes.size()));
+    Trace::count("codec_residual_bytes", static_cast<int64_t>(residuals.size()));
+    Trace::count("codec_encoded_bytes", static_cast<int64_t>(out.size()));
+    return true;
+}
+
+bool MeshCodec::decode(const uint8_t* data, size_t size,
+                       std::vector<Vector3>& vertices, std::vector<Face>& faces) {
+    Trace::Scope trace("MeshCodec::decode");
+    Reader in{data, data + size};
+    if (!in.has(sizeof(kMagic)) || std::memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+        std::cerr << "Error: Not a MeshCodec stream" << std::endl;
+        return false;
+    }
+    in.p += sizeof(kMagic);
+    const uint32_t version = in.get32();
+    const uint32_t bits = in.get32();
+    const uint32_t vertexCount = in.get32();
+    const uint32_t faceCount = in.get32();
+    Bounds box;
+    for (int a = 0; a < 3; a++) box.min[a] = in.getFloat();
+    for (int a = 0; a < 3; a++) box.max[a] = in.getFloat();
+    if (!in.ok || version != kVersion || bits < kMinBits || bits > kMaxBits) {
+        std::cerr << "Error: Unsupported MeshCodec stream" << std::endl;
+        return false;
+    }
+
+    std::vector<uint8_t> codes, references, residualBytes;
+    if (!decodeStream(in, codes) || !decodeStream(in, references) || !decodeStream(in, residualBytes)) {
+        std::cerr << "Error: Corrupt MeshCodec stream" << std::endl;
+        return false;
+    }
+
+    Grid grid;
+    grid.steps = static_cast<int32_t>((1u << bits) - 1);
+    grid.q.resize(3 * size_t(vertexCount));
+    Reader refs{references.data(), references.data() + references.size()};
+    Reader residuals{residualBytes.data(), residualBytes.data() + residualBytes.size()};
+    CodingState state;
+    uint32_t next = 0;
+    bool ok = true;
+
+    auto addVertex = [&](const int32_t pred[3]) {
+        if (next >= vertexCount) {
+            ok = false;
+            return 0u;
+        }
+        const uint32_t id = next++;
+        for (int a = 0; a < 3; a++) {
+            // Wrapping add: a corrupt residual must not overflow, and lands
+            // outside the grid
+            const int32_t value = static_cast<int32_t>(static_cast<uint32_t>(pred[a]) +
+                                                       static_cast<uint32_t>(unzigzag(residuals.getVarint())));
+            if (value < 0 || value > grid.steps) ok = false;
+            grid.q[3 * id + a] = value;
+        }
+        return id;
+    };
+
+    auto decodeVertex = [&](uint32_t nibble, const int32_t pred[3]) -> uint32_t {
+        if (nibble == kNewVertex) {
+            const uint32_t id = addVertex(pred);
+            state.pushVertex(id);
+            return id;
+        }
+        if (nibble != kBackReference) {
+            const uint32_t id = state.vertex(nibble - 1);
+            if (id == kNone) ok = false;
+            return id == kNone ? 0 : id;
+        }
+        const uint32_t back = refs.getVarint();
+        if (back >= next) {
+            ok = false;
+            return 0;
+        }
+        const uint32_t id = next - 1 - back;
+        state.pushVertex(id);
+        return id;
+    };
+
+    faces.clear();
+    faces.reserve(faceCount);
+    const uint8_t* code = codes.data();
+    const uint8_t* codesEnd = code + codes.size();
+    int32_t pred[3];
+    for (uint32_t f = 0; f < faceCount && ok; f++) {
+        if (code == codesEnd) {
+            ok = false;
+            break;
+        }
+        const uint32_t edge = *code >> 4;
+        const uint32_t nibble = *code++ & 15;
+        uint32_t a, b, c;
+        if (edge != kNoEdge) {
+            const CodingState::Edge& e = state.edge(edge);
+            if (e.a == kNone) {
+                ok = false;
+                break;
+            }
+            a = e.a;
+            b = e.b;
+            grid.parallelogram(a, b, e.opposite, pred);
+            c = decodeVertex(nibble, pred);
+        } else {
+            if (code == codesEnd) {
+                ok = false;
+                break;
+            }
+            const uint32_t more = *code++;
+            grid.previous(next, pred);
+            a = decodeVertex(nibble, pred);
+            grid.copy(a, pred);
+            b = decodeVertex(more >> 4, pred);
+            grid.copy(b, pred);
+            c = decodeVertex(more & 15, pred);
+        }
+        faces.emplace_back(a, b, c);
+        state.pushTriangle(a, b, c);
+    }
+    while (ok && next < vertexCount) {
+        grid.previous(next, pred);
+        addVertex(pred);
+    }
+    if (!ok || !refs.ok || !residuals.ok) {
+        std::cerr << "Error: Corrupt MeshCodec stream" << std::endl;
+        faces.clear();
+        return false;
+    }
+
+    float step[3];
+    for (int a = 0; a < 3; a++) step[a] = (box.max[a] - box.min[a]) / grid.steps;
+    vertices.resize(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; v++) {
+        vertices[v] = Vector3(box.min[0] + grid.q[3 * v] * step[0],
+                              box.min[1] + grid.q[3 * v + 1] * step[1],
+                              box.min[2] + grid.q[3 * v + 2] * step[2]);
+    }
+    return true;
+}
+
+bool MeshCodec::roundTrip(const std::vector<Vector3>& vertices, const std::vector<Face>& faces, int bits,
+                          Report& report, std::vector<uint8_t>* encoded) {
+    Trace::Scope trace("MeshCodec::roundTrip");
+    report = Report();
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<uint8_t> local;
+    std::vector<uint8_t>& data = encoded ? *encoded : local;
+    std::vector<uint32_t> newIndexOf, faceSource;
+    auto start = Clock::now();
+    if (!encode(vertices, faces, bits, data, &newIndexOf, &faceSource)) return false;
+    report.encodeSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    report.rawBytes = vertices.size() * sizeof(Vector3) + faces.size() * sizeof(Face);
+    report.encodedBytes = data.size();
+    report.ratio = data.empty() ? 0.0 : static_cast<double>(report.rawBytes) / data.size();
+
+    std::vector<Vector3> decodedVertices;
+    std::vector<Face> decodedFaces;
+    double spent = 0.0;
+    report.decodeSeconds = std::numeric_limits<double>::max();
+    for (int run = 0; run < kMaxTimingRuns && spent < kMinTimingSeconds; run++) {
+        start = Clock::now();
+        if (!decode(data.data(), data.size(), decodedVertices, decodedFaces)) return false;
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        report.decodeSeconds = std::min(report.decodeSeconds, seconds);
+        spent += seconds;
+    }
+    report.decodeMBps = report.decodeSeconds > 0.0 ? report.rawBytes / report.decodeSeconds / 1e6 : 0.0;
+
+    // Per-axis bound: half a step, plus rounding in min + q * step
+    const Bounds box = boundsOf(vertices);
+    const double steps = double((1u << bits) - 1);
+    float bound[3], slack[3];
+    for (int a = 0; a < 3; a++) {
+        bound[a] = static_cast<float>((double(box.max[a]) - box.min[a]) / steps * 0.5);
+        slack[a] = 4.0f * std::numeric_limits<float>::epsilon() *
+                   std::max(std::abs(box.min[a]), std::abs(box.max[a]));
+        report.errorBound = std::max(report.errorBound, bound[a]);
+    }
+
+    report.withinBound = decodedVertices.size() == vertices.size();
+    for (size_t v = 0; v < vertices.size() && report.withinBound; v++) {
+        const Vector3& decoded = decodedVertices[newIndexOf[v]];
+        for (int a = 0; a < 3; a++) {
+            const float error = std::abs(coord(decoded, a) - coord(vertices[v], a));
+            report.maxError = std::max(report.maxError, error);
+            if (error > bound[a] + slack[a]) report.withinBound = false;
+        }
+    }
+
+    report.facesMatch = decodedFaces.size() == faces.size();
+    for (size_t f = 0; f < faces.size() && report.facesMatch; f++) {
+        const Face& source = faces[faceSource[f]];
+        const uint32_t expected[3] = {newIndexOf[source.v1], newIndexOf[source.v2], newIndexOf[source.v3]};
+        const uint32_t got[3] = {decodedFaces[f].v1, decodedFaces[f].v2, decodedFaces[f].v3};
+        bool rotated = false;
+        for (int r = 0; r < 3 && !rotated; r++) {
+            rotated = got[0] == expected[r] && got[1] == expected[(r + 1) % 3] && got[2] == expected[(r + 2) % 3];
+        }
+        report.facesMatch = rotated;
+    }
+
+    Trace::gauge("codec_ratio", report.ratio);
+    Trace::gauge("codec_decode_mb_s", report.decodeMBps);
+    return true;
+}
+
+bool MeshCodec::writeFile(const std::string& path, const std::vector<uint8_t>& data) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open file " << path << " for writing" << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    return static_cast<bool>(file);
+}
+
+bool MeshCodec::readFile(const std::string& path, std::vector<uint8_t>& data) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open file " << path << std::endl;
+        return false;
+    }
+    data.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(data.data()), data.size());
+    return static_cast<bool>(file);
+}
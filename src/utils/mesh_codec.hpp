@@ -0,0 +1,69 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../mesh/mesh.hpp"
+
+// Compact encoding of a mesh's positions and triangles, for storing many
+// simplified levels of detail.
+//
+// Positions are quantized to `bits` per axis inside the mesh's bounding
+// box, so each decoded coordinate is within half a quantization step of
+// its source. Triangles are coded in the order of a depth-first walk across
+// shared edges, each against a FIFO of edges from recent triangles: a
+// triangle sharing one of them costs one byte naming the edge and its third
+// vertex, and is rotated to start with the shared edge. The third vertex is the next new vertex, one of a FIFO of
+// recent vertices, or an explicit back reference. Vertices are numbered in
+// the order triangles first use them (unused vertices last), and a new
+// vertex reached across a shared edge is predicted by the parallelogram
+// rule from the triangle on the other side; only the residual is stored.
+// The three resulting byte streams (triangle codes, back references and
+// position residuals) are entropy coded with an order-0 rANS coder running
+// two interleaved states.
+//
+// Decoding returns the vertices and triangles in their coded order, the
+// triangles possibly rotated but with the same winding; face normals are
+// left for the caller to compute. The format is little-endian
+// on every host.
+class MeshCodec {
+public:
+    static constexpr uint32_t kVersion = 1;
+    static constexpr int kDefaultBits = 14;
+    static constexpr int kMinBits = 1;
+    static constexpr int kMaxBits = 24;
+
+    struct Report {
+        size_t rawBytes = 0;       // Vertex and Face arrays as held in memory
+        size_t encodedBytes = 0;
+        double ratio = 0.0;        // rawBytes / encodedBytes
+        double encodeSeconds = 0.0;
+        double decodeSeconds = 0.0;  // Best of several decodes
+        double decodeMBps = 0.0;     // rawBytes produced per second
+        float maxError = 0.0f;       // Largest per-axis position error
+        float errorBound = 0.0f;     // Half a quantization step on the widest axis
+        bool facesMatch = false;
+        bool withinBound = false;
+    };
+
+    // Encodes the mesh into out. newIndexOf, if given, receives the decoded
+    // index of each input vertex, and faceSource the input face each decoded
+    // face came from. Fails on bits outside [kMinBits, kMaxBits] or face
+    // indices past the vertex array.
+    static bool encode(const std::vector<Vector3>& vertices, const std::vector<Face>& faces, int bits,
+                       std::vector<uint8_t>& out, std::vector<uint32_t>* newIndexOf = nullptr,
+                       std::vector<uint32_t>* faceSource = nullptr);
+
+    static bool decode(const uint8_t* data, size_t size,
+                       std::vector<Vector3>& vertices, std::vector<Face>& faces);
+
+    // Encodes, decodes and compares the result with the input: every
+    // position within the quantization bound and every triangle the same
+    // up to rotation. Fills report; returns false if encoding or decoding
+    // failed.
+    static bool roundTrip(const std::vector<Vector3>& vertices, const std::vector<Face>& faces, int bits,
+                          Report& report, std::vector<uint8_t>* encoded = nullptr);
+
+    static bool writeFile(const std::string& path, const std::vector<uint8_t>& data);
+    static bool readFile(const std::string& path, std::vector<uint8_t>& data);
+};
@@ -0,0 +1,50 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace Parallel {
+
+// Resolves a requested thread count, where 0 means one per hardware thread
+inline unsigned resolveThreadCount(unsigned requested) {
+    if (requested > 0) return requested;
+    unsigned hardware = std::thread::hardware_concurrency();
+    return hardware > 0 ? hardware : 1;
+}
+
+// Number of chunks to split count items into: at most `threads`, and no
+// chunk smaller than minChunk items so small inputs stay on one thread
+inline unsigned chunkCount(size_t count, unsigned threads, size_t minChunk) {
+    size_t byWork = (count + minChunk - 1) / std::max<size_t>(minChunk, 1);
+    return static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(threads, byWork)));
+}
+
+// First item of a chunk; boundaries depend only on count and chunks
+inline size_t chunkBegin(size_t count, unsigned chunks, unsigned chunk) {
+    return count / chunks * chunk + std::min<size_t>(chunk, count % chunks);
+}
+
+// Splits [0, count) into `chunks` contiguous ranges and calls
+// fn(chunk, begin, end) for each on its own thread. Chunk 0 runs on
+// the calling thread; returns once every chunk has finished.
+template <typename F>
+void forChunks(size_t count, unsigned chunks, F&& fn) {
+    if (chunks <= 1) {
+        fn(0u, size_t(0), count);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(chunks - 1);
+    for (unsigned chunk = 1; chunk < chunks; chunk++) {
+        workers.emplace_back([&fn, count, chunks, chunk]() {
+            fn(chunk, chunkBegin(count, chunks, chunk), chunkBegin(count, chunks, chunk + 1));
+        });
+    }
+    fn(0u, size_t(0), chunkBegin(count, chunks, 1));
+
+    for (auto& worker : workers) worker.join();
+}
+
+} // namespace Parallel
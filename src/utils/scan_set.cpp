@@ -0,0 +1,151 @@
+#include "scan_set.hpp"
+#include "file_io.hpp"
+#include "parallel.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
+#include "../mesh/vertex_kernels.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+bool ScanSet::loadConf(const std::string& confPath) {
+    std::ifstream file(confPath);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open file " << confPath << std::endl;
+        return false;
+    }
+
+    const std::filesystem::path directory = std::filesystem::path(confPath).parent_path();
+    scans.clear();
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        std::istringstream iss(line);
+        std::string keyword;
+        if (!(iss >> keyword) || (keyword != "bmesh" && keyword != "mesh")) continue;
+
+        Scan scan;
+        std::string name;
+        if (!(iss >> name >> scan.translation.x >> scan.translation.y >> scan.translation.z >>
+              scan.rotation[0] >> scan.rotation[1] >> scan.rotation[2] >> scan.rotation[3])) {
+            std::cerr << "Error: Malformed scan entry at " << confPath << ":" << lineNumber << std::endl;
+            return false;
+        }
+        scan.path = (directory / name).string();
+        scans.push_back(scan);
+    }
+
+    if (scans.empty()) {
+        std::cerr << "Error: No scans listed in " << confPath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void ScanSet::rotationMatrix(const float quaternion[4], float matrix[9]) {
+    double x = quaternion[0], y = quaternion[1], z = quaternion[2], w = quaternion[3];
+    const double length = std::sqrt(x * x + y * y + z * z + w * w);
+    if (length > 0.0) {
+        x /= length; y /= length; z /= length; w /= length;
+    } else {
+        w = 1.0;
+    }
+
+    // Transpose of the usual quaternion matrix: the .conf quaternions rotate
+    // the shared frame into the scan's, so points are turned by the conjugate
+    matrix[0] = static_cast<float>(1.0 - 2.0 * (y * y + z * z));
+    matrix[1] = static_cast<float>(2.0 * (x * y + z * w));
+    matrix[2] = static_cast<float>(2.0 * (x * z - y * w));
+    matrix[3] = static_cast<float>(2.0 * (x * y - z * w));
+    matrix[4] = static_cast<float>(1.0 - 2.0 * (x * x + z * z));
+    matrix[5] = static_cast<float>(2.0 * (y * z + x * w));
+    matrix[6] = static_cast<float>(2.0 * (x * z + y * w));
+    matrix[7] = static_cast<float>(2.0 * (y * z - x * w));
+    matrix[8] = static_cast<float>(1.0 - 2.0 * (x * x + y * y));
+}
+
+bool ScanSet::load(std::vector<Vector3>& points) {
+    Trace::Scope trace("ScanSet::load");
+    auto startTime = std::chrono::steady_clock::now();
+    stats = Stats();
+    stats.scans = scans.size();
+
+    // Each task reads one scan and aligns it in its own position arrays
+    std::vector<PositionArrays> aligned(scans.size());
+    std::vector<char> loaded(scans.size(), 0);
+    const unsigned threads = std::max(1u, std::min<unsigned>(
+        Parallel::resolveThreadCount(threadCount), static_cast<unsigned>(scans.size())));
+    ThreadPool pool(threads);
+
+    for (size_t i = 0; i < scans.size(); i++) {
+        pool.submit([this, i, &aligned, &loaded]() {
+            Trace::Scope scanTrace("ScanSet::loadScan");
+            auto scanStart = std::chrono::steady_clock::now();
+            Scan& scan = scans[i];
+
+            std::vector<Vector3> vertices;
+            std::vector<Face> faces;
+            FileIO::LoadStats loadStats;
+            if (!FileIO::loadPLY(scan.path, vertices, faces, &loadStats)) return;
+
+            float matrix[9];
+            rotationMatrix(scan.rotation, matrix);
+            PositionArrays& positions = aligned[i];
+            positions.assign(vertices);
+            VertexKernels::rigidTransform(positions.x.data(), positions.y.data(), positions.z.data(),
+                                          positions.size(), matrix, scan.translation);
+
+            scan.vertexCount = positions.size();
+            scan.bytes = loadStats.bytes;
+            scan.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - scanStart).count();
+            loaded[i] = 1;
+        });
+    }
+    pool.wait();
+
+    std::vector<size_t> offsets(scans.size() + 1, 0);
+    for (size_t i = 0; i < scans.size(); i++) {
+        if (!loaded[i]) {
+            std::cerr << "Error: Could not load scan " << scans[i].path << std::endl;
+            return false;
+        }
+        offsets[i + 1] = offsets[i] + scans[i].vertexCount;
+        stats.bytes += scans[i].bytes;
+    }
+
+    // Concatenate in .conf order, one copy task per scan
+    points.resize(offsets.back());
+    for (size_t i = 0; i < scans.size(); i++) {
+        pool.submit([i, &aligned, &offsets, &points]() {
+            const PositionArrays& positions = aligned[i];
+            Vector3* out = points.data() + offsets[i];
+            for (size_t k = 0; k < positions.size(); k++) {
+                out[k] = Vector3(positions.x[k], positions.y[k], positions.z[k]);
+            }
+            aligned[i] = PositionArrays();  // Release the scan's copy early
+        });
+    }
+    pool.wait();
+
+    stats.vertices = points.size();
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    Trace::count("scans_loaded", static_cast<int64_t>(stats.scans));
+    Trace::count("vertices_loaded", static_cast<int64_t>(stats.vertices));
+    Trace::count("bytes_read", static_cast<int64_t>(stats.bytes));
+    Trace::sampleMemory();
+    return true;
+}
+
+bool ScanSet::load(Mesh& output) {
+    std::vector<Vector3> points;
+    if (!load(points)) return false;
+    output.setVertices(std::move(points));
+    output.setFaces(std::vector<Face>());
+    return true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "../mesh/mesh.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// A set of range scans plus the rigid transforms that align them, as
+// described by a Stanford .conf file such as models/bunny/data/bun.conf:
+//
+//   camera tx ty tz qx qy qz qw
+//   bmesh bun045.ply tx ty tz qx qy qz qw
+//
+// Each bmesh (or mesh) line names a scan, relative to the .conf file, and
+// the translation and unit quaternion that take it into the shared frame.
+// load() reads every scan on a thread pool, moves its points into place
+// with the rigidTransform kernel and concatenates them in .conf order. The
+// scans are raw range images (is_mesh 0): only their vertices are kept, so
+// the merged mesh has no faces, which VertexClustering handles as a point
+// cloud.
+class ScanSet {
+public:
+    struct Scan {
+        std::string path;
+        Vector3 translation;
+        float rotation[4] = {0.0f, 0.0f, 0.0f, 1.0f};  // Quaternion x, y, z, w
+        size_t vertexCount = 0;   // Filled in by load()
+        size_t bytes = 0;
+        double seconds = 0.0;     // Read, parse and transform
+    };
+
+    struct Stats {
+        size_t scans = 0;
+        size_t vertices = 0;
+        size_t bytes = 0;
+        double seconds = 0.0;     // Wall time of the whole load
+    };
+
+    // Parses a .conf file; the camera line and unknown keywords are ignored
+    bool loadConf(const std::string& confPath);
+
+    // 0 threads uses one per hardware thread
+    void setThreadCount(unsigned threads) { threadCount = threads; }
+
+    // Loads all scans and writes their aligned points, in .conf order.
+    // Returns false if any scan cannot be read.
+    bool load(std::vector<Vector3>& points);
+    // Same, replacing the mesh's contents with the points and no faces
+    bool load(Mesh& output);
+
+    const std::vector<Scan>& getScans() const { return scans; }
+    const Stats& getStats() const { return stats; }
+
+    // Row-major matrix that aligns a scan with the .conf quaternion (x, y, z, w),
+    // normalized first; applied as p' = matrix * p + translation
+    static void rotationMatrix(const float quaternion[4], float matrix[9]);
+
+private:
+    std::vector<Scan> scans;
+    unsigned threadCount = 0;
+    Stats stats;
+};
@@ -0,0 +1,52 @@
+#include "thread_pool.hpp"
+#include "parallel.hpp"
+
+ThreadPool::ThreadPool(unsigned threadCount) {
+    const unsigned threads = Parallel::resolveThreadCount(threadCount);
+    workers.reserve(threads);
+    for (unsigned i = 0; i < threads; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    taskReady.notify_all();
+    for (auto& worker : workers) worker.join();
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    taskReady.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    allDone.wait(lock, [this]() { return tasks.empty() && running == 0; });
+}
+
+void ThreadPool::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        taskReady.wait(lock, [this]() { return stopping || !tasks.empty(); });
+        if (tasks.empty()) return;  // Stopping with nothing left to run
+
+        std::function<void()> task = std::move(tasks.front());
+        tasks.pop_front();
+        running++;
+
+        lock.unlock();
+        task();
+        lock.lock();
+
+        running--;
+        if (tasks.empty() && running == 0) allDone.notify_all();
+    }
+}
@@ -0,0 +1,245 @@
+#include "trace.hpp"
+#include <sys/resource.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Trace {
+
+std::atomic<bool> enabledFlag{false};
+
+namespace {
+
+enum class Kind : uint8_t { Complete, Counter, Gauge };
+
+struct Event {
+    const char* name;
+    uint64_t time;      // ns since enable()
+    uint64_t duration;  // Complete events only
+    double value;       // Counter delta or gauge level
+    Kind kind;
+};
+
+// Events of one thread. Buffers live until the process exits, so a
+// thread's pointer stays valid and events survive short-lived workers.
+struct ThreadBuffer {
+    uint32_t thread = 0;
+    std::vector<Event> events;
+};
+
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+std::atomic<int64_t> epochNs{0};
+thread_local ThreadBuffer* localBuffer = nullptr;
+
+int64_t steadyNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+ThreadBuffer& threadBuffer() {
+    if (!localBuffer) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        buffers.emplace_back(new ThreadBuffer());
+        localBuffer = buffers.back().get();
+        localBuffer->thread = static_cast<uint32_t>(buffers.size());
+    }
+    return *localBuffer;
+}
+
+void record(const char* name, uint64_t time, uint64_t duration, double value, Kind kind) {
+    threadBuffer().events.push_back({name, time, duration, value, kind});
+}
+
+double residentMegabytes() {
+#ifdef __linux__
+    // Second field of statm is the resident page count
+    long pages = 0;
+    if (FILE* file = std::fopen("/proc/self/statm", "r")) {
+        if (std::fscanf(file, "%*s %ld", &pages) != 1) pages = 0;
+        std::fclose(file);
+    }
+    return pages * static_cast<double>(sysconf(_SC_PAGESIZE)) / (1024.0 * 1024.0);
+#else
+    return 0.0;
+#endif
+}
+
+double peakResidentMegabytes() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / (1024.0 * 1024.0);  // Bytes
+#else
+    return usage.ru_maxrss / 1024.0;             // Kilobytes
+#endif
+}
+
+std::string jsonString(const char* text) {
+    std::string out = "\"";
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') out += '\\';
+        if (static_cast<unsigned char>(*c) >= 0x20) out += *c;
+    }
+    return out + "\"";
+}
+
+// Every recorded event with the thread it came from, in time order
+struct TaggedEvent {
+    Event event;
+    uint32_t thread;
+};
+
+std::vector<TaggedEvent> collect() {
+    std::vector<TaggedEvent> all;
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (const auto& buffer : buffers) {
+        for (const Event& event : buffer->events) all.push_back({event, buffer->thread});
+    }
+    std::stable_sort(all.begin(), all.end(), [](const TaggedEvent& a, const TaggedEvent& b) {
+        return a.event.time < b.event.time;
+    });
+    return all;
+}
+
+} // namespace
+
+void enable() {
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (auto& buffer : buffers) buffer->events.clear();
+    }
+    epochNs.store(steadyNs(), std::memory_order_relaxed);
+    enabledFlag.store(true, std::memory_order_relaxed);
+}
+
+void disable() {
+    enabledFlag.store(false, std::memory_order_relaxed);
+}
+
+uint64_t now() {
+    return static_cast<uint64_t>(steadyNs() - epochNs.load(std::memory_order_relaxed));
+}
+
+void Scope::finish() {
+    const uint64_t finish = now();
+    record(name, start, finish - start, 0.0, Kind::Complete);
+}
+
+void count(const char* name, int64_t value) {
+    if (!enabled()) return;
+    record(name, now(), 0, static_cast<double>(value), Kind::Counter);
+}
+
+void gauge(const char* name, double value) {
+    if (!enabled()) return;
+    record(name, now(), 0, value, Kind::Gauge);
+}
+
+void sampleMemory() {
+    if (!enabled()) return;
+    const uint64_t time = now();
+    record("rss_mb", time, 0, residentMegabytes(), Kind::Gauge);
+    record("peak_rss_mb", time, 0, peakResidentMegabytes(), Kind::Gauge);
+}
+
+bool writeChromeTrace(const std::string& path) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Error: Could not write trace " << path << std::endl;
+        return false;
+    }
+
+    const std::vector<TaggedEvent> events = collect();
+    std::map<std::string, double> totals;
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << std::fixed << std::setprecision(3);
+    bool first = true;
+    for (const TaggedEvent& tagged : events) {
+        const Event& event = tagged.event;
+        out << (first ? "" : ",\n") << "{\"name\":" << jsonString(event.name)
+            << ",\"pid\":1,\"tid\":" << tagged.thread << ",\"ts\":" << event.time / 1000.0;
+        first = false;
+        if (event.kind == Kind::Complete) {
+            out << ",\"ph\":\"X\",\"dur\":" << event.duration / 1000.0 << "}";
+        } else {
+            // Counters are drawn as their running total
+            double value = event.value;
+            if (event.kind == Kind::Counter) value = totals[event.name] += event.value;
+            out << ",\"ph\":\"C\",\"args\":{\"value\":" << value << "}}";
+        }
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
+
+void printSummary(std::ostream& out) {
+    struct ScopeTotal {
+        size_t calls = 0;
+        double totalMs = 0.0;
+        double maxMs = 0.0;
+    };
+    std::map<std::string, ScopeTotal> scopes;
+    std::map<std::string, double> counters;
+    std::map<std::string, double> gaugePeaks;
+    for (const TaggedEvent& tagged : collect()) {
+        const Event& event = tagged.event;
+        if (event.kind == Kind::Complete) {
+            ScopeTotal& scope = scopes[event.name];
+            const double ms = event.duration / 1e6;
+            scope.calls++;
+            scope.totalMs += ms;
+            scope.maxMs = std::max(scope.maxMs, ms);
+        } else if (event.kind == Kind::Counter) {
+            counters[event.name] += event.value;
+        } else {
+            auto it = gaugePeaks.find(event.name);
+            if (it == gaugePeaks.end()) gaugePeaks[event.name] = event.value;
+            else it->second = std::max(it->second, event.value);
+        }
+    }
+
+    // Scopes by total time, largest first
+    std::vector<std::pair<std::string, ScopeTotal>> sorted(scopes.begin(), scopes.end());
+    std::stable_sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+        return a.second.totalMs > b.second.totalMs;
+    });
+
+    const std::ios_base::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(2);
+    out << std::left << std::setw(32) << "Scope" << std::right << std::setw(8) << "Calls"
+        << std::setw(12) << "Total ms" << std::setw(12) << "Mean ms" << std::setw(12) << "Max ms" << "\n";
+    for (const auto& entry : sorted) {
+        const ScopeTotal& scope = entry.second;
+        out << std::left << std::setw(32) << entry.first << std::right << std::setw(8) << scope.calls
+            << std::setw(12) << scope.totalMs << std::setw(12) << scope.totalMs / scope.calls
+            << std::setw(12) << scope.maxMs << "\n";
+    }
+    if (!counters.empty()) {
+        out << std::left << std::setw(32) << "Counter" << std::right << std::setw(20) << "Total" << "\n";
+        out << std::setprecision(0);
+        for (const auto& entry : counters) {
+            out << std::left << std::setw(32) << entry.first << std::right << std::setw(20) << entry.second << "\n";
+        }
+    }
+    if (!gaugePeaks.empty()) {
+        out << std::left << std::setw(32) << "Gauge" << std::right << std::setw(20) << "Peak" << "\n";
+        out << std::setprecision(2);
+        for (const auto& entry : gaugePeaks) {
+            out << std::left << std::setw(32) << entry.first << std::right << std::setw(20) << entry.second << "\n";
+        }
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
+
+} // namespace Trace
@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Lightweight instrumentation: scoped timers, counters and memory gauges.
+//
+// Everything is off until enable() is called. While off, a Scope or a
+// count() costs one relaxed atomic load and nothing is stored, so the calls
+// can stay in hot paths. While on, each thread appends events to its own
+// buffer without locking (a lock is taken once per thread to register the
+// buffer). writeChromeTrace() emits the events in the Chrome trace-event
+// format (chrome://tracing, Perfetto); printSummary() prints per-scope
+// totals, counter totals and the peak of every gauge.
+//
+// Names must be string literals or otherwise outlive the trace; only the
+// pointer is stored.
+namespace Trace {
+
+extern std::atomic<bool> enabledFlag;
+
+inline bool enabled() { return enabledFlag.load(std::memory_order_relaxed); }
+
+// Starts recording; events from an earlier run are discarded
+void enable();
+void disable();
+
+// Nanoseconds since enable()
+uint64_t now();
+
+// Times the enclosing block as one complete event
+class Scope {
+public:
+    explicit Scope(const char* name) : name(enabled() ? name : nullptr) {
+        if (this->name) start = now();
+    }
+    ~Scope() { close(); }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+    // Ends the event before the enclosing block does
+    void close() {
+        if (name) finish();
+        name = nullptr;
+    }
+
+private:
+    const char* name;
+    uint64_t start = 0;
+
+    void finish();
+};
+
+// Adds value to a running total, e.g. vertices read or faces dropped
+void count(const char* name, int64_t value);
+
+// Records the current value of a level, e.g. bytes held by a table
+void gauge(const char* name, double value);
+
+// Records the process resident set size and its peak, in MB
+void sampleMemory();
+
+// Writes every event recorded so far; false if the file cannot be written
+bool writeChromeTrace(const std::string& path);
+
+// Table of scope calls and times, counter totals and gauge peaks
+void printSummary(std::ostream& out);
+
+} // namespace Trace
@@ -18,36 +18,44 @@ public:
         if (radius < 1.0f) radius = 1.0f;
     }
 
-    void apply() const {
-        glLoadIdentity();
-        
+    float getRadius() const { return radius; }
+
+    // Eye position and view basis: forward looks at the origin, right and
+    // up are the screen axes. All three are unit length.
+    void getView(float eye[3], float forward[3], float right[3], float up[3]) const {
         // Convert spherical to Cartesian coordinates
-        float x = radius * cos(phi * 3.14159f/180.0f) * cos(theta * 3.14159f/180.0f);
-        float y = radius * sin(phi * 3.14159f/180.0f);
-        float z = radius * cos(phi * 3.14159f/180.0f) * sin(theta * 3.14159f/180.0f);
-        
-        // Create a simple look-at matrix
-        float forward[3] = {-x, -y, -z};  // Camera points toward origin
-        float up[3] = {0.0f, 1.0f, 0.0f};
-        
-        // Normalize forward vector
-        float len = sqrt(forward[0]*forward[0] + forward[1]*forward[1] + forward[2]*forward[2]);
-        forward[0] /= len;
-        forward[1] /= len;
-        forward[2] /= len;
-        
-        // Right vector = up × forward
-        float right[3] = {
-            up[1]*forward[2] - up[2]*forward[1],
-            up[2]*forward[0] - up[0]*forward[2],
-            up[0]*forward[1] - up[1]*forward[0]
-        };
-        
+        eye[0] = radius * cos(phi * 3.14159f/180.0f) * cos(theta * 3.14159f/180.0f);
+        eye[1] = radius * sin(phi * 3.14159f/180.0f);
+        eye[2] = radius * cos(phi * 3.14159f/180.0f) * sin(theta * 3.14159f/180.0f);
+
+        // Camera points toward origin
+        float len = sqrt(eye[0]*eye[0] + eye[1]*eye[1] + eye[2]*eye[2]);
+        forward[0] = -eye[0] / len;
+        forward[1] = -eye[1] / len;
+        forward[2] = -eye[2] / len;
+
+        // Right vector = up × forward with up = (0, 1, 0), normalized: its
+        // length is cos(phi), which would otherwise shrink the view
+        right[0] = forward[2];
+        right[1] = 0.0f;
+        right[2] = -forward[0];
+        len = sqrt(right[0]*right[0] + right[2]*right[2]);
+        right[0] /= len;
+        right[2] /= len;
+
         // Recompute up vector = forward × right
         up[0] = forward[1]*right[2] - forward[2]*right[1];
         up[1] = forward[2]*right[0] - forward[0]*right[2];
         up[2] = forward[0]*right[1] - forward[1]*right[0];
-        
+    }
+
+    void apply() const {
+        glLoadIdentity();
+
+        // Create a simple look-at matrix
+        float eye[3], forward[3], right[3], up[3];
+        getView(eye, forward, right, up);
+
         // Create view matrix
         float m[16] = {
             right[0], up[0], -forward[0], 0,
@@ -57,7 +65,7 @@ public:
         };
         
         glMultMatrixf(m);
-        glTranslatef(-x, -y, -z);
+        glTranslatef(-eye[0], -eye[1], -eye[2]);
     }
 
 private:
@@ -0,0 +1,412 @@
+// Regression tests for MeshCore, run by CTest.
+//
+// Usage: MeshTests [case]
+//
+// Each case builds its own small mesh in code, so no model files are
+// needed. Without an argument every case runs. Failed checks are printed
+// with their line, and the exit status is non-zero if any check failed or
+// the case is unknown.
+
+#include "mesh/mesh.hpp"
+#include "mesh/mesh_connectivity.hpp"
+#include "mesh/meshlets.hpp"
+#include "algorithms/streaming_clustering.hpp"
+#include "algorithms/vertex_clustering.hpp"
+#include "utils/file_io.hpp"
+#include "utils/mesh_codec.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(condition)                                                                   \
+    do {                                                                                   \
+        if (!(condition)) {                                                                \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition "\n"; \
+            failures++;                                                                    \
+        }                                                                                  \
+    } while (0)
+
+Mesh makeMesh(std::vector<Vector3> vertices, std::vector<Face> faces) {
+    Mesh mesh;
+    mesh.setVertices(std::move(vertices));
+    mesh.setFaces(std::move(faces));
+    return mesh;
+}
+
+// UV sphere of radius 1 with segments x segments quads
+Mesh makeSphere(int segments) {
+    std::vector<Vector3> vertices;
+    std::vector<Face> faces;
+    for (int i = 0; i <= segments; i++) {
+        const float phi = 3.14159265f * i / segments;
+        for (int j = 0; j < segments; j++) {
+            const float theta = 2.0f * 3.14159265f * j / segments;
+            vertices.emplace_back(std::sin(phi) * std::cos(theta), std::cos(phi),
+                                  std::sin(phi) * std::sin(theta));
+        }
+    }
+    for (int i = 0; i < segments; i++) {
+        for (int j = 0; j < segments; j++) {
+            const unsigned a = i * segments + j;
+            const unsigned b = i * segments + (j + 1) % segments;
+            faces.emplace_back(a, a + segments, b);
+            faces.emplace_back(b, a + segments, b + segments);
+        }
+    }
+    return makeMesh(std::move(vertices), std::move(faces));
+}
+
+// Square [-1, 1]^2 in the z = 0 plane split into n x n quads, facing +z
+Mesh makeGrid(int n) {
+    std::vector<Vector3> vertices;
+    std::vector<Face> faces;
+    for (int y = 0; y <= n; y++) {
+        for (int x = 0; x <= n; x++) {
+            vertices.emplace_back(-1.0f + 2.0f * x / n, -1.0f + 2.0f * y / n, 0.0f);
+        }
+    }
+    for (int y = 0; y < n; y++) {
+        for (int x = 0; x < n; x++) {
+            const unsigned a = y * (n + 1) + x;
+            faces.emplace_back(a, a + 1, a + n + 1);
+            faces.emplace_back(a + 1, a + n + 2, a + n + 1);
+        }
+    }
+    return makeMesh(std::move(vertices), std::move(faces));
+}
+
+bool sameFaces(const std::vector<Face>& a, const std::vector<Face>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].v1 != b[i].v1 || a[i].v2 != b[i].v2 || a[i].v3 != b[i].v3) return false;
+    }
+    return true;
+}
+
+bool sameVertices(const std::vector<Vector3>& a, const std::vector<Vector3>& b) {
+    return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(Vector3)) == 0);
+}
+
+// Every format savePLY writes loads back bit for bit, through loadPLY and
+// through the streaming reader
+void testPlyRoundTrip() {
+    const Mesh sphere = makeSphere(24);
+    const fs::path path = fs::temp_directory_path() / "mesh_tests_round_trip.ply";
+    const FileIO::PLYFormat formats[] = {FileIO::PLYFormat::Ascii, FileIO::PLYFormat::BinaryLittleEndian,
+                                         FileIO::PLYFormat::BinaryBigEndian};
+    for (FileIO::PLYFormat format : formats) {
+        CHECK(FileIO::savePLY(path.string(), sphere.getVertices(), sphere.getFaces(), format));
+
+        std::vector<Vector3> vertices;
+        std::vector<Face> faces;
+        CHECK(FileIO::loadPLY(path.string(), vertices, faces));
+        CHECK(sameVertices(vertices, sphere.getVertices()));
+        CHECK(sameFaces(faces, sphere.getFaces()));
+
+        std::vector<Vector3> streamedVertices;
+        std::vector<Face> streamedFaces;
+        PLYStreamReader reader;
+        CHECK(reader.open(path.string()));
+        CHECK(reader.read(
+            [&](const Vector3* v, size_t count) {
+                streamedVertices.insert(streamedVertices.end(), v, v + count);
+                return true;
+            },
+            [&](const Face* f, size_t count) {
+                streamedFaces.insert(streamedFaces.end(), f, f + count);
+                return true;
+            }));
+        CHECK(sameVertices(streamedVertices, sphere.getVertices()));
+        CHECK(sameFaces(streamedFaces, sphere.getFaces()));
+    }
+    fs::remove(path);
+}
+
+// Writes a binary little-endian PLY of one triangle over three vertices,
+// with its indices stored as listType
+void writeTriangle(const fs::path& path, const char* listType, const void* indices, size_t indexBytes) {
+    std::FILE* file = std::fopen(path.string().c_str(), "wb");
+    if (!file) return;
+    std::fprintf(file,
+                 "ply\nformat binary_little_endian 1.0\n"
+                 "element vertex 3\nproperty float x\nproperty float y\nproperty float z\n"
+                 "element face 1\nproperty list uchar %s vertex_indices\nend_header\n",
+                 listType);
+    const float vertices[9] = {0, 0, 0, 1, 0, 0, 0, 1, 0};
+    std::fwrite(vertices, sizeof(vertices), 1, file);
+    const uint8_t count = 3;
+    std::fwrite(&count, 1, 1, file);
+    std::fwrite(indices, indexBytes, 1, file);
+    std::fclose(file);
+}
+
+bool loadsBothWays(const fs::path& path) {
+    std::vector<Vector3> vertices;
+    std::vector<Face> faces;
+    const bool loaded = FileIO::loadPLY(path.string(), vertices, faces);
+    PLYStreamReader reader;
+    const bool streamed = reader.open(path.string()) &&
+                          reader.read(nullptr, [](const Face*, size_t) { return true; });
+    CHECK(loaded == streamed);
+    return loaded;
+}
+
+// Face indices outside [0, vertices) or not whole numbers fail the load
+// instead of being cast
+void testPlyBadIndices() {
+    const fs::path path = fs::temp_directory_path() / "mesh_tests_bad_indices.ply";
+
+    const int32_t good[3] = {0, 1, 2};
+    writeTriangle(path, "int", good, sizeof(good));
+    CHECK(loadsBothWays(path));
+
+    const int32_t negative[3] = {0, -1, 2};
+    writeTriangle(path, "int", negative, sizeof(negative));
+    CHECK(!loadsBothWays(path));
+
+    const float floats[3] = {0.0f, 1.0f, 2.0f};
+    writeTriangle(path, "float", floats, sizeof(floats));
+    CHECK(loadsBothWays(path));
+
+    const float bad[][3] = {{0.0f, 0.5f, 2.0f}, {0.0f, -1.0f, 2.0f}, {0.0f, 1.0f, 1e10f}, {0.0f, 1.0f, NAN}};
+    for (const auto& indices : bad) {
+        writeTriangle(path, "float", indices, sizeof(indices));
+        CHECK(!loadsBothWays(path));
+    }
+    fs::remove(path);
+}
+
+// Clustering output is the same bit for bit whatever the thread count; the
+// sphere is large enough to split into several chunks
+void testClusteringThreadInvariance() {
+    const Mesh sphere = makeSphere(300);
+    const int gridSizes[] = {8, 64, 200};
+    for (int gridSize : gridSizes) {
+        VertexClustering single(gridSize);
+        single.setThreadCount(1);
+        const Mesh reference = single.simplify(sphere);
+        CHECK(reference.getFaceCount() > 0);
+
+        for (unsigned threads : {2u, 3u, 4u, 8u}) {
+            VertexClustering clustering(gridSize);
+            clustering.setThreadCount(threads);
+            const Mesh result = clustering.simplify(sphere);
+            CHECK(sameVertices(result.getVertices(), reference.getVertices()));
+            CHECK(sameFaces(result.getFaces(), reference.getFaces()));
+        }
+    }
+}
+
+// Streaming from a file gives the same mesh as clustering in memory, and
+// both drop faces repeated in the opposite winding
+void testStreamingMatchesClustering() {
+    const Mesh sphere = makeSphere(120);
+    std::vector<Face> faces = sphere.getFaces();
+    for (size_t f = 0; f < sphere.getFaceCount(); f += 3) {
+        const Face& face = sphere.getFaces()[f];
+        faces.emplace_back(face.v1, face.v3, face.v2);
+    }
+    const Mesh doubled = makeMesh(sphere.getVertices(), faces);
+    const fs::path path = fs::temp_directory_path() / "mesh_tests_streaming.ply";
+    CHECK(FileIO::savePLY(path.string(), doubled.getVertices(), doubled.getFaces(),
+                          FileIO::PLYFormat::BinaryLittleEndian));
+
+    for (int gridSize : {16, 64, 256}) {
+        VertexClustering clustering(gridSize);
+        const Mesh reference = clustering.simplify(doubled);
+
+        StreamingClustering streaming(gridSize);
+        Mesh result;
+        CHECK(streaming.simplify(path.string(), result));
+        CHECK(sameVertices(result.getVertices(), reference.getVertices()));
+        CHECK(sameFaces(result.getFaces(), reference.getFaces()));
+        CHECK(streaming.getStats().duplicateFaces > 0);
+    }
+    fs::remove(path);
+}
+
+// A file listing its faces before its vertices is rejected, not clustered
+// into an empty mesh
+void testStreamingFacesFirst() {
+    const fs::path path = fs::temp_directory_path() / "mesh_tests_faces_first.ply";
+    std::FILE* file = std::fopen(path.string().c_str(), "w");
+    CHECK(file != nullptr);
+    if (!file) return;
+    std::fputs("ply\nformat ascii 1.0\n"
+               "element face 2\nproperty list uchar int vertex_indices\n"
+               "element vertex 4\nproperty float x\nproperty float y\nproperty float z\n"
+               "end_header\n"
+               "3 0 1 2\n3 0 2 3\n"
+               "0 0 0\n1 0 0\n1 1 0\n0 1 0\n",
+               file);
+    std::fclose(file);
+
+    StreamingClustering streaming(16);
+    Mesh result;
+    CHECK(!streaming.simplify(path.string(), result));
+    fs::remove(path);
+}
+
+// Decoded meshes keep the faces and stay within the quantization bound
+void testCodecRoundTrip() {
+    const Mesh sphere = makeSphere(64);
+    for (int bits : {8, MeshCodec::kDefaultBits, 20}) {
+        MeshCodec::Report report;
+        CHECK(MeshCodec::roundTrip(sphere.getVertices(), sphere.getFaces(), bits, report));
+        CHECK(report.facesMatch);
+        CHECK(report.withinBound);
+        CHECK(report.maxError > 0.0f);
+        CHECK(report.encodedBytes > 0 && report.encodedBytes < report.rawBytes);
+    }
+
+    // Truncated data is rejected rather than misread
+    std::vector<uint8_t> encoded;
+    MeshCodec::encode(sphere.getVertices(), sphere.getFaces(), MeshCodec::kDefaultBits, encoded);
+    std::vector<Vector3> vertices;
+    std::vector<Face> faces;
+    CHECK(MeshCodec::decode(encoded.data(), encoded.size(), vertices, faces));
+    CHECK(!MeshCodec::decode(encoded.data(), encoded.size() / 2, vertices, faces));
+}
+
+// Edge and boundary counts of small meshes whose answers are known
+void testConnectivityCounts() {
+    // Two triangles sharing one edge: 5 edges, 4 of them on the boundary
+    const std::vector<Face> quad = {Face(0, 1, 2), Face(0, 2, 3)};
+    const MeshConnectivity square(4, quad, 1);
+    CHECK(square.edgeCount() == 5);
+    CHECK(square.boundaryEdgeCount() == 4);
+    CHECK(square.nonManifoldEdgeCount() == 0);
+    const uint32_t diagonal = square.findEdge(2, 0);
+    CHECK(diagonal != MeshConnectivity::kNone);
+    if (diagonal != MeshConnectivity::kNone) {
+        CHECK(square.edge(diagonal).face0 == 0 && square.edge(diagonal).face1 == 1);
+        CHECK(!(square.edgeFlags(diagonal) & MeshConnectivity::kBoundary));
+    }
+    CHECK(square.findEdge(1, 3) == MeshConnectivity::kNone);
+    CHECK(square.facesOf(0).size() == 2 && square.facesOf(1).size() == 1);
+
+    // Closed tetrahedron: 6 edges, none on the boundary
+    const std::vector<Face> tetrahedron = {Face(0, 2, 1), Face(0, 1, 3), Face(1, 2, 3), Face(0, 3, 2)};
+    const MeshConnectivity closed(4, tetrahedron, 1);
+    CHECK(closed.edgeCount() == 6);
+    CHECK(closed.boundaryEdgeCount() == 0);
+
+    // A third face on an edge makes it non-manifold
+    const std::vector<Face> fin = {Face(0, 1, 2), Face(0, 2, 3), Face(0, 2, 4)};
+    const MeshConnectivity finned(5, fin, 1);
+    CHECK(finned.edgeCount() == 7);
+    CHECK(finned.nonManifoldEdgeCount() == 1);
+
+    // The sphere's seam is shared, but each pole is a ring of separate
+    // vertices whose edges have one face each
+    const Mesh sphere = makeSphere(16);
+    const MeshConnectivity& connectivity = sphere.getConnectivity();
+    CHECK(connectivity.edgeCount() == 16 * 16 * 3 + 16);
+    CHECK(connectivity.boundaryEdgeCount() == 2 * 16);
+    CHECK(connectivity.faceCount() == sphere.getFaceCount());
+}
+
+// Culling a flat grid from in front, from behind and looking away
+void testMeshletCull() {
+    Mesh grid = makeGrid(40);
+    grid.buildMeshlets(1);
+    const Meshlets* meshlets = grid.getMeshlets();
+    CHECK(meshlets != nullptr);
+    if (!meshlets) return;
+    CHECK(meshlets->size() > 1);
+
+    size_t faces = 0;
+    for (const Meshlets::Meshlet& m : meshlets->get()) {
+        CHECK(m.firstFace == faces);
+        CHECK(m.faceCount <= Meshlets::kMaxFaces && m.vertexCount <= Meshlets::kMaxVertices);
+        faces += m.faceCount;
+    }
+    CHECK(faces == grid.getFaceCount());
+
+    ViewFrustum front;
+    front.eye = Vector3(0.0f, 0.0f, 5.0f);
+    front.forward = Vector3(0.0f, 0.0f, -1.0f);
+    std::vector<uint32_t> visible;
+    Meshlets::CullStats stats = meshlets->cull(front, visible, 1);
+    CHECK(stats.visible == meshlets->size());
+    CHECK(stats.visibleFaces == grid.getFaceCount());
+    CHECK(visible.size() == meshlets->size());
+
+    // From behind every patch faces away
+    ViewFrustum behind = front;
+    behind.eye = Vector3(0.0f, 0.0f, -5.0f);
+    behind.forward = Vector3(0.0f, 0.0f, 1.0f);
+    behind.right = Vector3(-1.0f, 0.0f, 0.0f);
+    stats = meshlets->cull(behind, visible, 1);
+    CHECK(stats.visible == 0 && visible.empty());
+    CHECK(stats.backfacing == meshlets->size());
+
+    // Looking away from the grid leaves it outside the frustum
+    ViewFrustum away = front;
+    away.forward = Vector3(0.0f, 0.0f, 1.0f);
+    away.right = Vector3(-1.0f, 0.0f, 0.0f);
+    stats = meshlets->cull(away, visible, 1);
+    CHECK(stats.outsideFrustum == meshlets->size());
+
+    // A narrow view of one corner keeps that corner and drops the far one
+    ViewFrustum corner = front;
+    corner.eye = Vector3(-0.9f, -0.9f, 1.0f);
+    corner.tanHalfFovY = 0.05f;
+    stats = meshlets->cull(corner, visible, 1);
+    CHECK(stats.visible > 0 && stats.visible < meshlets->size());
+    bool hasCorner = false, hasFarCorner = false;
+    for (uint32_t i : visible) {
+        const Meshlets::Meshlet& m = meshlets->get()[i];
+        const float dx = m.center.x + 0.9f, dy = m.center.y + 0.9f;
+        if (std::sqrt(dx * dx + dy * dy) <= m.radius) hasCorner = true;
+        if (m.center.x - m.radius > 0.5f && m.center.y - m.radius > 0.5f) hasFarCorner = true;
+    }
+    CHECK(hasCorner);
+    CHECK(!hasFarCorner);
+}
+
+struct Case {
+    const char* name;
+    void (*run)();
+};
+
+const Case kCases[] = {
+    {"ply_round_trip", testPlyRoundTrip},
+    {"ply_bad_indices", testPlyBadIndices},
+    {"clustering_thread_invariance", testClusteringThreadInvariance},
+    {"streaming_matches_clustering", testStreamingMatchesClustering},
+    {"streaming_faces_first", testStreamingFacesFirst},
+    {"codec_round_trip", testCodecRoundTrip},
+    {"connectivity_counts", testConnectivityCounts},
+    {"meshlet_cull", testMeshletCull},
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const std::string only = argc > 1 ? argv[1] : "";
+    bool ran = false;
+    for (const Case& test : kCases) {
+        if (!only.empty() && only != test.name) continue;
+        const int before = failures;
+        test.run();
+        std::cout << (failures == before ? "PASS " : "FAIL ") << test.name << "\n";
+        ran = true;
+    }
+    if (!ran) {
+        std::cerr << "Error: Unknown test case " << only << std::endl;
+        return 1;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,561 @@
+// Headless batch simplification. Needs no window or GL context.
+//
+// Usage: MeshBatch [options] <input.ply | scans.conf | glob>...
+//
+//   --algorithm clustering|streaming|quadric|points
+//                                    Simplifier to run (default clustering)
+//   --grid N                         Clustering grid cells per axis (default 16)
+//   --target-faces N                 Clustering: pick the largest grid with at most N faces
+//   --target-error E                 Clustering: pick the smallest grid whose Hausdorff distance
+//                                    is at most E times the bounding box diagonal
+//   --keep-duplicates                Clustering: keep faces that repeat an earlier face's cells
+//   --drop-unreferenced              Clustering: drop cells no face uses
+//   --bbox x0,y0,z0,x1,y1,z1         Fixed grid box for streaming (default: a vertex pre-pass)
+//   --faces N                        Quadric target face count
+//   --ratio R                        Quadric target as a fraction of the input faces (default 0.1)
+//   --max-error E                    Quadric error bound
+//   --voxel S                        Points: average the points in cubes of edge S first
+//   --samples N                      Points: keep N evenly spread points (Poisson disk)
+//   --normals                        Points: estimate a normal per point and write nx/ny/nz
+//   --neighbours K                   Points: neighbours per normal fit (default 16)
+//   --output-dir DIR                 Where to write results (default: next to each input)
+//   --suffix S                       Appended to the output file stem (default _simplified)
+//   --format ascii|binary|binary_be  Output PLY encoding (default binary)
+//   --morton                         Sort the input along a Morton curve after loading
+//   --jobs N                         Files processed concurrently (default: hardware threads)
+//   --error                          Measure Hausdorff/mean/RMS distance to the input (see MeshError)
+//   --optimize-cache                 Reorder the output for the vertex cache (see VertexCacheOptimizer)
+//   --pack BITS                      Also write a compressed .meshpack at BITS per axis (see MeshCodec)
+//   --trace FILE                     Write a Chrome trace of every phase (see Trace)
+//   --verbose                        Print the trace summary table to stderr
+//
+// streaming clusters straight from the file without loading the mesh (see
+// StreamingClustering); its load time is part of simplify_ms and load_ms is 0.
+// A .conf input is a set of range scans (see ScanSet), loaded in parallel,
+// aligned and clustered as one point cloud; streaming does not take them.
+// points thins the input as a point cloud and drops any faces (see
+// PointCloudSimplifier): --voxel, then --samples, then --normals, each
+// skipped when not given. It suits face-less scans (.conf sets or single
+// is_mesh 0 PLY files).
+// clustering reports the faces it removed as degenerate or duplicate, and
+// with --drop-unreferenced the vertices it removed (see VertexClustering).
+// --target-faces and --target-error replace --grid with a GridSearch over
+// grids 4 to 256; the chosen grid is reported as grid_size.
+// --error adds the distances between input and output surfaces to the
+// output line; streaming never holds the input mesh, so it skips them.
+// --optimize-cache reorders the output's faces and vertices before it is
+// written and reports the simulated cache miss ratios (ACMR, ATVR) before
+// and after.
+// --pack writes the output again as a .meshpack beside the PLY, decodes it
+// back and reports its size, compression ratio against the in-memory
+// arrays, best decode speed and largest position error against the
+// quantization bound (pack_ok is false if a face or position did not
+// survive). Each file spends at least 50 ms timing decodes.
+// Globs may use * and ? in the file name part. Meshes keep their original
+// coordinates. Each file produces one JSON object per line on stdout with its
+// counts and load/simplify/write times; everything else goes to stderr. The
+// exit code is nonzero if any file failed.
+
+#include "mesh/mesh.hpp"
+#include "algorithms/vertex_clustering.hpp"
+#include "algorithms/quadric_simplification.hpp"
+#include "algorithms/streaming_clustering.hpp"
+#include "algorithms/mesh_error.hpp"
+#include "algorithms/grid_search.hpp"
+#include "algorithms/vertex_cache_optimizer.hpp"
+#include "algorithms/point_cloud_simplifier.hpp"
+#include "utils/file_io.hpp"
+#include "utils/mesh_codec.hpp"
+#include "utils/parallel.hpp"
+#include "utils/scan_set.hpp"
+#include "utils/trace.hpp"
+#include "utils/thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+enum class Algorithm { Clustering, Streaming, Quadric, Points };
+
+struct Options {
+    Algorithm algorithm = Algorithm::Clustering;
+    int gridSize = 16;
+    size_t searchFaces = 0;
+    double searchError = 0.0;
+    bool keepDuplicates = false;
+    bool dropUnreferenced = false;
+    bool hasBoundingBox = false;
+    Vector3 boxMin, boxMax;
+    size_t targetFaces = 0;
+    double ratio = 0.1;
+    double maxError = std::numeric_limits<double>::max();
+    float voxelSize = 0.0f;
+    size_t pointSamples = 0;
+    bool normals = false;
+    int neighbours = PointCloudSimplifier::kDefaultNeighbours;
+    std::string outputDir;
+    std::string suffix = "_simplified";
+    FileIO::PLYFormat format = FileIO::PLYFormat::BinaryLittleEndian;
+    unsigned jobs = 0;
+    bool measureError = false;
+    bool optimizeCache = false;
+    bool morton = false;
+    int packBits = 0;
+    bool verbose = false;
+    std::string tracePath;
+    std::vector<std::string> inputs;
+};
+
+struct FileResult {
+    std::string input;
+    std::string output;
+    std::string error;
+    size_t inputVertices = 0, inputFaces = 0;
+    size_t outputVertices = 0, outputFaces = 0;
+    double loadMs = 0.0, simplifyMs = 0.0, writeMs = 0.0;
+    int gridSize = 0;              // Grid chosen by a search, else 0
+    int searchEvaluations = 0;
+    bool hasCleanupStats = false;
+    VertexClustering::Stats cleanup;
+    bool hasError = false;
+    MeshError::Result distances;
+    bool hasCacheStats = false;
+    VertexCacheOptimizer::Stats cacheStats;
+    bool hasPack = false;
+    MeshCodec::Report pack;
+    float poissonRadius = 0.0f;    // Set when points subsampled
+    std::vector<Vector3> normals;  // Per output vertex, when points estimated them
+};
+
+using Clock = std::chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void printUsage() {
+    std::cerr << "Usage: MeshBatch [--algorithm clustering|streaming|quadric|points] [--grid N]\n"
+              << "                 [--target-faces N] [--target-error E]\n"
+              << "                 [--keep-duplicates] [--drop-unreferenced]\n"
+              << "                 [--bbox x0,y0,z0,x1,y1,z1] [--faces N] [--ratio R]\n"
+              << "                 [--max-error E] [--voxel S] [--samples N] [--normals]\n"
+              << "                 [--neighbours K] [--output-dir DIR] [--suffix S]\n"
+              << "                 [--format ascii|binary|binary_be] [--jobs N] [--error]\n"
+              << "                 [--morton] [--optimize-cache] [--pack BITS] [--trace FILE]\n"
+              << "                 [--verbose]\n"
+              << "                 <input.ply | scans.conf | glob>...\n";
+}
+
+bool parseArguments(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--algorithm" && hasValue) {
+            std::string name = argv[++i];
+            if (name == "clustering") options.algorithm = Algorithm::Clustering;
+            else if (name == "streaming") options.algorithm = Algorithm::Streaming;
+            else if (name == "quadric") options.algorithm = Algorithm::Quadric;
+            else if (name == "points") options.algorithm = Algorithm::Points;
+            else {
+                std::cerr << "Error: Unknown algorithm " << name << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--grid" && hasValue) options.gridSize = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--target-faces" && hasValue) {
+            options.searchFaces = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--target-error" && hasValue) options.searchError = std::atof(argv[++i]);
+        else if (arg == "--keep-duplicates") options.keepDuplicates = true;
+        else if (arg == "--drop-unreferenced") options.dropUnreferenced = true;
+        else if (arg == "--bbox" && hasValue) {
+            float v[6];
+            if (std::sscanf(argv[++i], "%f,%f,%f,%f,%f,%f", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5]) != 6) {
+                std::cerr << "Error: --bbox expects six comma-separated numbers" << std::endl;
+                return false;
+            }
+            options.boxMin = Vector3(v[0], v[1], v[2]);
+            options.boxMax = Vector3(v[3], v[4], v[5]);
+            options.hasBoundingBox = true;
+        }
+        else if (arg == "--faces" && hasValue) options.targetFaces = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--ratio" && hasValue) options.ratio = std::atof(argv[++i]);
+        else if (arg == "--max-error" && hasValue) options.maxError = std::atof(argv[++i]);
+        else if (arg == "--voxel" && hasValue) options.voxelSize = static_cast<float>(std::atof(argv[++i]));
+        else if (arg == "--samples" && hasValue) options.pointSamples = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--normals") options.normals = true;
+        else if (arg == "--neighbours" && hasValue) options.neighbours = std::max(3, std::atoi(argv[++i]));
+        else if (arg == "--output-dir" && hasValue) options.outputDir = argv[++i];
+        else if (arg == "--suffix" && hasValue) options.suffix = argv[++i];
+        else if (arg == "--format" && hasValue) {
+            std::string name = argv[++i];
+            if (name == "ascii") options.format = FileIO::PLYFormat::Ascii;
+            else if (name == "binary") options.format = FileIO::PLYFormat::BinaryLittleEndian;
+            else if (name == "binary_be") options.format = FileIO::PLYFormat::BinaryBigEndian;
+            else {
+                std::cerr << "Error: Unknown PLY format " << name << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--jobs" && hasValue) options.jobs = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--error") options.measureError = true;
+        else if (arg == "--optimize-cache") options.optimizeCache = true;
+        else if (arg == "--morton") options.morton = true;
+        else if (arg == "--pack" && hasValue) {
+            options.packBits = std::atoi(argv[++i]);
+            if (options.packBits < MeshCodec::kMinBits || options.packBits > MeshCodec::kMaxBits) {
+                std::cerr << "Error: --pack takes " << MeshCodec::kMinBits << " to " << MeshCodec::kMaxBits
+                          << " bits" << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--trace" && hasValue) options.tracePath = argv[++i];
+        else if (arg == "--verbose") options.verbose = true;
+        else if (arg == "--help" || arg == "-h") return false;
+        else if (arg.size() > 1 && arg[0] == '-') {
+            std::cerr << "Error: Unknown option " << arg << std::endl;
+            return false;
+        }
+        else options.inputs.push_back(arg);
+    }
+    return !options.inputs.empty();
+}
+
+// Shell-style match of * and ? against a single path component
+bool wildcardMatch(const char* pattern, const char* text) {
+    const char* starPattern = nullptr;
+    const char* starText = nullptr;
+    while (*text) {
+        if (*pattern == '?' || *pattern == *text) {
+            pattern++;
+            text++;
+        } else if (*pattern == '*') {
+            starPattern = pattern++;
+            starText = text;
+        } else if (starPattern) {
+            pattern = starPattern + 1;
+            text = ++starText;
+        } else {
+            return false;
+        }
+    }
+    while (*pattern == '*') pattern++;
+    return *pattern == '\0';
+}
+
+// Expands wildcards in the file name; plain paths pass through unchanged
+// so a missing file is reported as a failed entry rather than dropped
+void expandInput(const std::string& input, std::vector<std::string>& files) {
+    fs::path path(input);
+    std::string pattern = path.filename().string();
+    if (pattern.find_first_of("*?") == std::string::npos) {
+        files.push_back(input);
+        return;
+    }
+
+    fs::path directory = path.has_parent_path() ? path.parent_path() : fs::path(".");
+    std::vector<std::string> matches;
+    std::error_code error;
+    for (fs::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+        if (!it->is_regular_file(error)) continue;
+        std::string name = it->path().filename().string();
+        if (wildcardMatch(pattern.c_str(), name.c_str())) {
+            matches.push_back((path.has_parent_path() ? directory / name : fs::path(name)).string());
+        }
+    }
+    if (matches.empty()) {
+        std::cerr << "Warning: No files match " << input << std::endl;
+    }
+    std::sort(matches.begin(), matches.end());
+    files.insert(files.end(), matches.begin(), matches.end());
+}
+
+std::string outputPathFor(const std::string& input, const Options& options) {
+    fs::path source(input);
+    fs::path directory = options.outputDir.empty() ? source.parent_path() : fs::path(options.outputDir);
+    return (directory / (source.stem().string() + options.suffix + ".ply")).string();
+}
+
+bool isScanSet(const std::string& input) {
+    return fs::path(input).extension() == ".conf";
+}
+
+void loadAndSimplify(const std::string& input, const Options& options, unsigned simplifyThreads,
+                     FileResult& result, Mesh& simplified) {
+    // Read straight through FileIO so the output keeps the source units;
+    // Mesh::loadFromPLY would normalize the mesh for display
+    auto start = Clock::now();
+    Mesh mesh;
+    if (isScanSet(input)) {
+        ScanSet scans;
+        scans.setThreadCount(simplifyThreads);
+        if (!scans.loadConf(input) || !scans.load(mesh)) {
+            result.error = "load failed";
+            return;
+        }
+    } else {
+        std::vector<Vector3> vertices;
+        std::vector<Face> faces;
+        if (!FileIO::loadPLY(input, vertices, faces)) {
+            result.error = "load failed";
+            return;
+        }
+        mesh.setVertices(std::move(vertices));
+        mesh.setFaces(std::move(faces));
+    }
+    if (options.morton) mesh.sortSpatially();
+    result.loadMs = millisecondsSince(start);
+    result.inputVertices = mesh.getVertexCount();
+    result.inputFaces = mesh.getFaceCount();
+
+    start = Clock::now();
+    if (options.algorithm == Algorithm::Clustering && (options.searchFaces > 0 || options.searchError > 0.0)) {
+        GridSearch search(mesh, GridSearch::kMinGridSize, GridSearch::kMaxGridSize, simplifyThreads);
+        GridSearch::Result chosen;
+        if (options.searchFaces > 0) {
+            search.forFaceCount(options.searchFaces, chosen);
+        } else {
+            Vector3 min, max;
+            mesh.getBoundingBox(min, max);
+            const double dx = max.x - min.x, dy = max.y - min.y, dz = max.z - min.z;
+            search.forMaxError(options.searchError * std::sqrt(dx * dx + dy * dy + dz * dz), chosen);
+        }
+        simplified = search.extract(chosen.candidate);
+        result.gridSize = chosen.gridSize;
+        result.searchEvaluations = chosen.evaluations;
+    } else if (options.algorithm == Algorithm::Points) {
+        PointCloudSimplifier points;
+        points.setThreadCount(simplifyThreads);
+        if (options.voxelSize > 0.0f) simplified = points.voxelDownsample(mesh, options.voxelSize);
+        else simplified.setVertices(mesh.getVertices());
+        if (options.pointSamples > 0) {
+            simplified = points.poissonSubsample(simplified, options.pointSamples);
+            result.poissonRadius = points.getPoissonRadius();
+        }
+        if (options.normals) result.normals = points.estimateNormals(simplified, options.neighbours);
+    } else if (options.algorithm == Algorithm::Clustering) {
+        VertexClustering clustering(options.gridSize);
+        clustering.setThreadCount(simplifyThreads);
+        clustering.setRemoveDuplicates(!options.keepDuplicates);
+        clustering.setRemoveUnreferenced(options.dropUnreferenced);
+        simplified = clustering.simplify(mesh);
+        result.cleanup = clustering.getStats();
+        result.hasCleanupStats = true;
+    } else {
+        size_t target = options.targetFaces > 0
+            ? options.targetFaces
+            : static_cast<size_t>(options.ratio * static_cast<double>(result.inputFaces));
+        QuadricSimplifier quadric(target, options.maxError);
+        simplified = quadric.simplify(mesh);
+    }
+    result.simplifyMs = millisecondsSince(start);
+
+    if (options.measureError) {
+        MeshError error(mesh, simplifyThreads);
+        result.hasError = error.evaluate(simplified, result.distances);
+    }
+}
+
+void processFile(const std::string& input, const Options& options, unsigned simplifyThreads,
+                 FileResult& result) {
+    Trace::Scope trace("MeshBatch::processFile");
+    result.input = input;
+    result.output = outputPathFor(input, options);
+
+    Mesh simplified;
+    auto start = Clock::now();
+    if (options.algorithm == Algorithm::Streaming && isScanSet(input)) {
+        result.error = "streaming needs a PLY file";
+        return;
+    }
+    if (options.algorithm == Algorithm::Streaming) {
+        StreamingClustering streaming(options.gridSize);
+        if (options.hasBoundingBox) streaming.setBoundingBox(options.boxMin, options.boxMax);
+        if (!streaming.simplify(input, simplified)) {
+            result.error = "load failed";
+            return;
+        }
+        result.simplifyMs = millisecondsSince(start);
+        result.inputVertices = streaming.getStats().inputVertices;
+        result.inputFaces = streaming.getStats().inputFaces;
+    } else {
+        loadAndSimplify(input, options, simplifyThreads, result, simplified);
+        if (!result.error.empty()) return;
+    }
+    result.outputVertices = simplified.getVertexCount();
+    result.outputFaces = simplified.getFaceCount();
+
+    if (options.optimizeCache) {
+        VertexCacheOptimizer optimizer;
+        optimizer.optimize(simplified);
+        result.cacheStats = optimizer.getStats();
+        result.hasCacheStats = true;
+    }
+
+    start = Clock::now();
+    if (!FileIO::savePLY(result.output, simplified.getVertices(), simplified.getFaces(), options.format,
+                         result.normals.empty() ? nullptr : &result.normals)) {
+        result.error = "write failed";
+        return;
+    }
+    result.writeMs = millisecondsSince(start);
+
+    if (options.packBits > 0) {
+        std::vector<uint8_t> packed;
+        const std::string packPath = fs::path(result.output).replace_extension(".meshpack").string();
+        if (!MeshCodec::roundTrip(simplified.getVertices(), simplified.getFaces(), options.packBits,
+                                  result.pack, &packed) ||
+            !MeshCodec::writeFile(packPath, packed)) {
+            result.error = "pack failed";
+            return;
+        }
+        result.hasPack = true;
+    }
+}
+
+std::string jsonString(const std::string& text) {
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+std::string toJson(const FileResult& result, const char* algorithm) {
+    std::ostringstream line;
+    line << "{\"file\":" << jsonString(result.input)
+         << ",\"status\":" << (result.error.empty() ? "\"ok\"" : "\"error\"");
+    if (!result.error.empty()) line << ",\"error\":" << jsonString(result.error);
+    line << ",\"algorithm\":\"" << algorithm << "\""
+         << ",\"output\":" << jsonString(result.output)
+         << ",\"input_vertices\":" << result.inputVertices
+         << ",\"input_faces\":" << result.inputFaces
+         << ",\"output_vertices\":" << result.outputVertices
+         << ",\"output_faces\":" << result.outputFaces
+         << ",\"load_ms\":" << result.loadMs
+         << ",\"simplify_ms\":" << result.simplifyMs
+         << ",\"write_ms\":" << result.writeMs
+         << ",\"total_ms\":" << result.loadMs + result.simplifyMs + result.writeMs;
+    if (result.gridSize > 0) {
+        line << ",\"grid_size\":" << result.gridSize
+             << ",\"search_evaluations\":" << result.searchEvaluations;
+    }
+    if (result.hasCleanupStats) {
+        line << ",\"degenerate_faces\":" << result.cleanup.degenerateFaces
+             << ",\"duplicate_faces\":" << result.cleanup.duplicateFaces
+             << ",\"unreferenced_vertices\":" << result.cleanup.unreferencedVertices;
+    }
+    if (result.hasError) {
+        const MeshError::Result& d = result.distances;
+        line << ",\"hausdorff\":" << d.symmetric.max
+             << ",\"hausdorff_relative\":" << (d.diagonal > 0.0 ? d.symmetric.max / d.diagonal : 0.0)
+             << ",\"mean_error\":" << d.symmetric.mean
+             << ",\"rms_error\":" << d.symmetric.rms
+             << ",\"error_ms\":" << d.seconds * 1000.0;
+    }
+    if (result.poissonRadius > 0.0f) line << ",\"poisson_radius\":" << result.poissonRadius;
+    if (!result.normals.empty()) line << ",\"normals\":" << result.normals.size();
+    if (result.hasCacheStats) {
+        const VertexCacheOptimizer::Stats& c = result.cacheStats;
+        line << ",\"acmr_before\":" << c.before.acmr
+             << ",\"acmr_after\":" << c.after.acmr
+             << ",\"atvr_before\":" << c.before.atvr
+             << ",\"atvr_after\":" << c.after.atvr
+             << ",\"optimize_ms\":" << c.seconds * 1000.0;
+    }
+    if (result.hasPack) {
+        const MeshCodec::Report& p = result.pack;
+        line << ",\"pack_bytes\":" << p.encodedBytes
+             << ",\"pack_ratio\":" << p.ratio
+             << ",\"pack_encode_ms\":" << p.encodeSeconds * 1000.0
+             << ",\"decode_mb_s\":" << p.decodeMBps
+             << ",\"pack_max_error\":" << p.maxError
+             << ",\"pack_error_bound\":" << p.errorBound
+             << ",\"pack_ok\":" << (p.facesMatch && p.withinBound ? "true" : "false");
+    }
+    line << "}";
+    return line.str();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseArguments(argc, argv, options)) {
+        printUsage();
+        return 2;
+    }
+
+    std::vector<std::string> files;
+    for (const auto& input : options.inputs) expandInput(input, files);
+    if (files.empty()) return 1;
+
+    if (!options.outputDir.empty()) {
+        std::error_code error;
+        fs::create_directories(options.outputDir, error);
+        if (error) {
+            std::cerr << "Error: Could not create " << options.outputDir << std::endl;
+            return 1;
+        }
+    }
+
+    // stdout carries only the per-file records; timings of the individual
+    // phases go through Trace
+    if (options.verbose || !options.tracePath.empty()) Trace::enable();
+
+    const unsigned hardware = Parallel::resolveThreadCount(0);
+    const unsigned jobs = std::min<unsigned>(Parallel::resolveThreadCount(options.jobs),
+                                             static_cast<unsigned>(files.size()));
+    // Share the machine between concurrent files and clustering's own workers
+    const unsigned simplifyThreads = std::max(1u, hardware / jobs);
+    const char* algorithmName = options.algorithm == Algorithm::Clustering ? "clustering"
+                              : options.algorithm == Algorithm::Streaming ? "streaming"
+                              : options.algorithm == Algorithm::Points ? "points" : "quadric";
+
+    std::mutex outputMutex;
+    std::atomic<size_t> failures{0};
+    auto start = Clock::now();
+    {
+        ThreadPool pool(jobs);
+        for (const auto& file : files) {
+            pool.submit([&, file]() {
+                FileResult result;
+                processFile(file, options, simplifyThreads, result);
+                if (!result.error.empty()) failures++;
+
+                std::lock_guard<std::mutex> lock(outputMutex);
+                std::cout << toJson(result, algorithmName) << std::endl;
+            });
+        }
+        pool.wait();
+    }
+    double wallMs = millisecondsSince(start);
+
+    if (!options.tracePath.empty()) Trace::writeChromeTrace(options.tracePath);
+    if (options.verbose) Trace::printSummary(std::cerr);
+    std::cerr << files.size() << " file(s), " << failures.load() << " failed, " << jobs << " job(s), "
+              << wallMs << " ms wall" << std::endl;
+    return failures.load() == 0 ? 0 : 1;
+}